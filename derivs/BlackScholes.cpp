@@ -8,6 +8,7 @@
 #include "BlackScholes.hpp"
 #include <cmath>
 #include "normals.hpp"
+#include "fast_math.hpp"
 
 double bs_call(double spot, double strike, double r, double d, double vol, double ttx)
 {
@@ -42,3 +43,99 @@ double bs_vega(double spot, double strike, double r, double d, double vol, doubl
     double d1 = (lnm + (r-d)*ttx + 0.5*std*std) / std;
     return spot * std::exp(-d*ttx) * std::sqrt(ttx) * norm_density(d1);
 }
+
+namespace {
+// mean and variance of the log of the geometric average, discount factor to delivery
+void geometric_average_moments(double spot, const MJArray& times, double delivery_time,
+                               const Parameters& r, const Parameters& d, const Parameters& vol,
+                               double& mean, double& variance, double& discount)
+{
+    unsigned long n = times.size();
+    double sum_drift = 0.0, sum_var = 0.0;
+    for(unsigned long i=0; i<n; ++i){
+        double var_i = vol.integrate_square(0.0, times[i]);
+        sum_drift += r.integrate(0.0, times[i]) - d.integrate(0.0, times[i]) - 0.5 * var_i;
+        // cov(log S_i, log S_j) = var at the earlier time, times[i] is the earlier one of 2 (n - 1 - i) + 1 pairs
+        sum_var += var_i * (2.0 * (n - 1 - i) + 1.0);
+    }
+    mean = std::log(spot) + sum_drift / n;
+    variance = sum_var / (static_cast<double>(n) * n);
+    discount = std::exp(-r.integrate(0.0, delivery_time));
+}
+}
+
+double geometric_asian_call(double spot, double strike, const MJArray& times, double delivery_time,
+                            const Parameters& r, const Parameters& d, const Parameters& vol)
+{
+    double mean, variance, discount;
+    geometric_average_moments(spot, times, delivery_time, r, d, vol, mean, variance, discount);
+    double std = std::sqrt(variance);
+    double d1 = (mean - std::log(strike) + variance) / std;
+    double d2 = d1 - std;
+    return discount * (std::exp(mean + 0.5 * variance) * cum_norm(d1) - strike * cum_norm(d2));
+}
+
+double geometric_asian_put(double spot, double strike, const MJArray& times, double delivery_time,
+                           const Parameters& r, const Parameters& d, const Parameters& vol)
+{
+    double mean, variance, discount;
+    geometric_average_moments(spot, times, delivery_time, r, d, vol, mean, variance, discount);
+    double std = std::sqrt(variance);
+    double d1 = (mean - std::log(strike) + variance) / std;
+    double d2 = d1 - std;
+    return discount * (strike * (1.0 - cum_norm(d2)) - std::exp(mean + 0.5 * variance) * (1.0 - cum_norm(d1)));
+}
+
+namespace {
+const unsigned long BS_BATCH_TILE = 64;
+const double InvRoot2Pi = 0.398942280401433;
+}
+
+void bs_batch(const double* spot, const double* strike, const double* r, const double* d,
+              const double* vol, const double* ttx, const bool* is_call, unsigned long n,
+              const BSBatchOutputs& out, NormalAccuracy accuracy)
+{
+    double root_t[BS_BATCH_TILE], std_dev[BS_BATCH_TILE], d1[BS_BATCH_TILE], d2[BS_BATCH_TILE];
+    double disc_r[BS_BATCH_TILE], disc_d[BS_BATCH_TILE], density[BS_BATCH_TILE], n1[BS_BATCH_TILE], n2[BS_BATCH_TILE];
+    for(unsigned long i0=0; i0<n; i0+=BS_BATCH_TILE){
+        unsigned long m = n - i0 < BS_BATCH_TILE ? n - i0 : BS_BATCH_TILE;
+        const double *s = spot + i0, *k = strike + i0, *rr = r + i0, *dd = d + i0, *v = vol + i0, *t = ttx + i0;
+        
+        for(unsigned long j=0; j<m; ++j){
+            d1[j] = s[j] / k[j];
+            disc_r[j] = -rr[j] * t[j];
+            disc_d[j] = -dd[j] * t[j];
+        }
+        log_array(d1, d1, m);
+        exp_array(disc_r, disc_r, m);
+        exp_array(disc_d, disc_d, m);
+        for(unsigned long j=0; j<m; ++j){
+            root_t[j] = std::sqrt(t[j]);
+            std_dev[j] = v[j] * root_t[j];
+            d1[j] = (d1[j] + (rr[j] - dd[j]) * t[j] + 0.5 * std_dev[j] * std_dev[j]) / std_dev[j];
+            d2[j] = d1[j] - std_dev[j];
+            density[j] = -0.5 * d1[j] * d1[j];
+        }
+        exp_array(density, density, m);
+        cum_norm(d1, n1, m, accuracy);
+        cum_norm(d2, n2, m, accuracy);
+        
+        // a put is the call with N(d) replaced by N(d) - 1, and the signs of the N terms in theta follow
+        for(unsigned long j=0; j<m; ++j){
+            bool call = !is_call || is_call[i0 + j];
+            double nd1 = call ? n1[j] : n1[j] - 1.0;
+            double nd2 = call ? n2[j] : n2[j] - 1.0;
+            double fwd_disc = s[j] * disc_d[j]; // spot discounted by the dividend yield
+            double strike_disc = k[j] * disc_r[j];
+            double pdf = InvRoot2Pi * density[j];
+            unsigned long i = i0 + j;
+            if(out.price) out.price[i] = fwd_disc * nd1 - strike_disc * nd2;
+            if(out.delta) out.delta[i] = disc_d[j] * nd1;
+            if(out.gamma) out.gamma[i] = disc_d[j] * pdf / (s[j] * std_dev[j]);
+            if(out.vega) out.vega[i] = fwd_disc * pdf * root_t[j];
+            if(out.theta) out.theta[i] = -0.5 * fwd_disc * pdf * v[j] / root_t[j]
+                                         + dd[j] * fwd_disc * nd1 - rr[j] * strike_disc * nd2;
+            if(out.rho) out.rho[i] = t[j] * strike_disc * nd2;
+        }
+    }
+}
@@ -8,9 +8,39 @@
 #ifndef BlackScholes_hpp
 #define BlackScholes_hpp
 
+#include "normals.hpp"
+#include "mjarray.hpp"
+#include "parameters.hpp"
+
 double bs_call(double spot, double strike, double r, double d, double vol, double ttx);
 double bs_put(double spot, double strike, double r, double d, double vol, double ttx);
 double bs_digital_call(double spot, double strike, double r, double d, double vol, double ttx);
 double bs_vega(double spot, double strike, double r, double d, double vol, double ttx);
 
+// options on the geometric average of the spot at times (ascending), paid at delivery_time, under time-dependent r, d and vol:
+// the log of the average is normal, mean and variance follow from the integrals of the parameters
+double geometric_asian_call(double spot, double strike, const MJArray& times, double delivery_time,
+                            const Parameters& r, const Parameters& d, const Parameters& vol);
+double geometric_asian_put(double spot, double strike, const MJArray& times, double delivery_time,
+                           const Parameters& r, const Parameters& d, const Parameters& vol);
+
+/*batch pricing, structure of arrays: price and Greeks of n European options in one pass.
+ d1/d2, discount factors and the density at d1 are computed once per contract and shared by all outputs,
+ log, exp and cum_norm go through the array kernels of fast_math and normals.
+ is_call[i] picks a call or a put, nullptr means all calls. Outputs left as nullptr are skipped.
+ theta is the decay per year of calendar time, -dV/dttx; vega and rho are per unit of vol and rate.
+ the fast accuracy uses the same cum_norm approximation as the scalar functions.
+ */
+struct BSBatchOutputs{
+    double* price = nullptr;
+    double* delta = nullptr;
+    double* gamma = nullptr;
+    double* vega = nullptr;
+    double* theta = nullptr;
+    double* rho = nullptr;
+};
+void bs_batch(const double* spot, const double* strike, const double* r, const double* d,
+              const double* vol, const double* ttx, const bool* is_call, unsigned long n,
+              const BSBatchOutputs& out, NormalAccuracy accuracy=NormalAccuracy::fast);
+
 #endif /* BlackScholes_hpp */
@@ -0,0 +1,86 @@
+//
+//  aad.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/5/22.
+//
+
+#include "aad.hpp"
+
+Tape& Tape::get_tape()
+{
+    static thread_local Tape tape;
+    return tape;
+}
+
+unsigned long Tape::record(const unsigned long* arg_nodes, const double* partials, unsigned long n)
+{
+    unsigned long num_active = 0;
+    for(unsigned long i=0; i<n; ++i){
+        if(arg_nodes[i] != NO_NODE){
+            push_arg(arg_nodes[i], partials[i]);
+            ++num_active;
+        }
+    }
+    return num_active ? push_node() : NO_NODE;
+}
+
+void Tape::rewind(unsigned long mark)
+{
+    arg_ends.rewind(mark);
+    adjoints.rewind(mark);
+    args.rewind(mark ? arg_ends[mark - 1] : 0);
+}
+
+void Tape::scale_adjoints(unsigned long from, unsigned long to, double factor)
+{
+    for(unsigned long i=from; i<to; ++i)
+        adjoints[i] *= factor;
+}
+
+void Tape::propagate(unsigned long from, unsigned long to)
+{
+    if(from == NO_NODE) return;
+    for(unsigned long i=from+1; i-- > to;){
+        double adjoint = adjoints[i];
+        if(adjoint == 0.0) continue;
+        unsigned long end = arg_ends[i];
+        for(unsigned long a = i ? arg_ends[i - 1] : 0; a<end; ++a)
+            adjoints[args[a].node] += adjoint * args[a].partial;
+    }
+}
+
+Number record_number(double val, const Number* args, const double* partials, unsigned long n)
+{
+    Tape& tape = Tape::get_tape();
+    unsigned long num_args = 0;
+    for(unsigned long i=0; i<n; ++i)
+        num_args += args[i].is_active();
+    if(num_args == 0) return Number(val);
+    // node ids of the arguments in a small buffer, spilled to the heap only for many arguments
+    const unsigned long LOCAL_ARGS = 16;
+    unsigned long local[LOCAL_ARGS];
+    std::vector<unsigned long> heap;
+    unsigned long* nodes = local;
+    if(n > LOCAL_ARGS){
+        heap.resize(n);
+        nodes = heap.data();
+    }
+    for(unsigned long i=0; i<n; ++i)
+        nodes[i] = args[i].get_node();
+    return Number(val, tape.record(nodes, partials, n));
+}
+
+void make_leaves(const std::vector<double>& values, std::vector<Number>& leaves)
+{
+    leaves.resize(values.size());
+    for(unsigned long i=0; i<values.size(); ++i)
+        leaves[i] = Number::leaf(values[i]);
+}
+
+void get_adjoints(const std::vector<Number>& leaves, std::vector<double>& adjoints)
+{
+    adjoints.resize(leaves.size());
+    for(unsigned long i=0; i<leaves.size(); ++i)
+        adjoints[i] = leaves[i].get_adjoint();
+}
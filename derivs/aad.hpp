@@ -0,0 +1,202 @@
+//
+//  aad.hpp
+//  derivs
+//
+//  Created by Xin Li on 4/5/22.
+//
+
+#ifndef aad_hpp
+#define aad_hpp
+
+/*adjoint algorithmic differentiation (AAD)
+ Number is an active double: every operation on Numbers is recorded on the tape of the thread, together with the
+ partial derivatives of its result in its arguments. One backward sweep over the tape (propagate) then gives the
+ derivatives of a result in all the leaves it was computed from, at a small constant multiple of the cost of the result.
+ Numbers built from a double are constants, they are not recorded and operations on constants only are not recorded either.
+ The tape lives in blocks that are kept when it is rewound, so recording again after a rewind does not allocate:
+ a pricer records its setup once, then rewinds to the mark after the setup for every path.
+ */
+#include <vector>
+#include <memory>
+#include <cmath>
+
+// blocks of BLOCK_SIZE elements, never moved once allocated
+template<typename T>
+class TapeArena{
+public:
+    TapeArena(): sz(0){}
+    T& operator[](unsigned long i) {return blocks[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];}
+    const T& operator[](unsigned long i) const {return blocks[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];}
+    void push_back(const T& val){
+        if(sz == blocks.size() * BLOCK_SIZE)
+            blocks.emplace_back(new T[BLOCK_SIZE]);
+        (*this)[sz++] = val;
+    }
+    unsigned long size() const {return sz;}
+    void rewind(unsigned long new_size){sz = new_size;} // blocks are kept for the next recording
+
+    static const unsigned long BLOCK_BITS = 14;
+    static const unsigned long BLOCK_SIZE = 1ul << BLOCK_BITS;
+private:
+    std::vector<std::unique_ptr<T[]>> blocks;
+    unsigned long sz;
+};
+
+class Tape{
+public:
+    static const unsigned long NO_NODE = ~0ul; // node of a constant
+
+    Tape(){}
+    Tape(const Tape&) = delete;
+    Tape& operator=(const Tape&) = delete;
+
+    // the tape Numbers of the calling thread record on
+    static Tape& get_tape();
+
+    // a node with n arguments, arguments without a node are skipped, NO_NODE if none is left
+    unsigned long record(const unsigned long* args, const double* partials, unsigned long n);
+    unsigned long record(unsigned long arg, double partial){
+        if(arg == NO_NODE) return NO_NODE;
+        push_arg(arg, partial);
+        return push_node();
+    }
+    unsigned long record(unsigned long arg1, double partial1, unsigned long arg2, double partial2){
+        if(arg1 == NO_NODE) return record(arg2, partial2);
+        if(arg2 == NO_NODE) return record(arg1, partial1);
+        push_arg(arg1, partial1);
+        push_arg(arg2, partial2);
+        return push_node();
+    }
+    unsigned long record(unsigned long arg1, double partial1, unsigned long arg2, double partial2, unsigned long arg3, double partial3){
+        if(arg1 == NO_NODE) return record(arg2, partial2, arg3, partial3);
+        if(arg2 == NO_NODE) return record(arg1, partial1, arg3, partial3);
+        if(arg3 == NO_NODE) return record(arg1, partial1, arg2, partial2);
+        push_arg(arg1, partial1);
+        push_arg(arg2, partial2);
+        push_arg(arg3, partial3);
+        return push_node();
+    }
+    unsigned long new_leaf(){return push_node();}
+
+    unsigned long size() const {return arg_ends.size();}
+    // drops the nodes from mark on, the nodes before keep their adjoints
+    void rewind(unsigned long mark=0);
+
+    double get_adjoint(unsigned long node) const {return node == NO_NODE ? 0.0 : adjoints[node];}
+    void add_adjoint(unsigned long node, double adjoint){if(node != NO_NODE) adjoints[node] += adjoint;}
+    void scale_adjoints(unsigned long from, unsigned long to, double factor); // nodes [from, to)
+    // sweeps the nodes from, from-1, ..., to (to <= from), adding the adjoint of each node to its arguments
+    void propagate(unsigned long from, unsigned long to=0);
+
+private:
+    struct TapeArg{
+        unsigned long node;
+        double partial;
+    };
+    void push_arg(unsigned long node, double partial){args.push_back(TapeArg{node, partial});}
+    unsigned long push_node(){
+        arg_ends.push_back(args.size());
+        adjoints.push_back(0.0);
+        return arg_ends.size() - 1;
+    }
+
+    TapeArena<unsigned long> arg_ends; // the arguments of node i are args[arg_ends[i-1]], ..., args[arg_ends[i]-1]
+    TapeArena<TapeArg> args;
+    TapeArena<double> adjoints;
+};
+
+
+class Number{
+public:
+    Number(double _val=0.0): val(_val), node(Tape::NO_NODE){} // a constant
+    Number(double _val, unsigned long _node): val(_val), node(_node){}
+    // an input to differentiate in
+    static Number leaf(double val){return Number(val, Tape::get_tape().new_leaf());}
+
+    double value() const {return val;}
+    unsigned long get_node() const {return node;}
+    bool is_active() const {return node != Tape::NO_NODE;}
+    double get_adjoint() const {return Tape::get_tape().get_adjoint(node);}
+
+    Number& operator+=(const Number& rhs);
+    Number& operator-=(const Number& rhs);
+    Number& operator*=(const Number& rhs);
+    Number& operator/=(const Number& rhs);
+
+private:
+    double val;
+    unsigned long node;
+};
+
+// a result with known partial derivatives in n arguments, e.g. an integral of a parameter in its knots
+Number record_number(double val, const Number* args, const double* partials, unsigned long n);
+
+inline Number unary(double val, const Number& x, double partial){
+    return x.is_active() ? Number(val, Tape::get_tape().record(x.get_node(), partial)) : Number(val);
+}
+inline Number binary(double val, const Number& x, double partial_x, const Number& y, double partial_y){
+    if(!x.is_active() && !y.is_active()) return Number(val);
+    return Number(val, Tape::get_tape().record(x.get_node(), partial_x, y.get_node(), partial_y));
+}
+
+inline Number operator+(const Number& x, const Number& y){return binary(x.value() + y.value(), x, 1.0, y, 1.0);}
+inline Number operator-(const Number& x, const Number& y){return binary(x.value() - y.value(), x, 1.0, y, -1.0);}
+inline Number operator*(const Number& x, const Number& y){return binary(x.value() * y.value(), x, y.value(), y, x.value());}
+inline Number operator/(const Number& x, const Number& y){
+    double inv = 1.0 / y.value();
+    double res = x.value() * inv;
+    return binary(res, x, inv, y, -res * inv);
+}
+inline Number operator-(const Number& x){return unary(-x.value(), x, -1.0);}
+
+inline Number operator+(const Number& x, double y){return unary(x.value() + y, x, 1.0);}
+inline Number operator+(double x, const Number& y){return unary(x + y.value(), y, 1.0);}
+inline Number operator-(const Number& x, double y){return unary(x.value() - y, x, 1.0);}
+inline Number operator-(double x, const Number& y){return unary(x - y.value(), y, -1.0);}
+inline Number operator*(const Number& x, double y){return unary(x.value() * y, x, y);}
+inline Number operator*(double x, const Number& y){return unary(x * y.value(), y, x);}
+inline Number operator/(const Number& x, double y){return unary(x.value() / y, x, 1.0 / y);}
+inline Number operator/(double x, const Number& y){
+    double res = x / y.value();
+    return unary(res, y, -res / y.value());
+}
+
+inline Number& Number::operator+=(const Number& rhs){return *this = *this + rhs;}
+inline Number& Number::operator-=(const Number& rhs){return *this = *this - rhs;}
+inline Number& Number::operator*=(const Number& rhs){return *this = *this * rhs;}
+inline Number& Number::operator/=(const Number& rhs){return *this = *this / rhs;}
+
+inline Number exp(const Number& x){
+    double res = std::exp(x.value());
+    return unary(res, x, res);
+}
+inline Number log(const Number& x){return unary(std::log(x.value()), x, 1.0 / x.value());}
+// the derivative at 0 is taken as 0, so a zero variance does not turn adjoints into NaN
+inline Number sqrt(const Number& x){
+    double res = std::sqrt(x.value());
+    return unary(res, x, res > 0.0 ? 0.5 / res : 0.0);
+}
+// derivative of the larger argument, of x on a tie
+inline Number fmax(const Number& x, const Number& y){return x.value() >= y.value() ? x : y;}
+
+// comparisons on values, for branches of payoffs
+inline bool operator<(const Number& x, const Number& y){return x.value() < y.value();}
+inline bool operator>(const Number& x, const Number& y){return x.value() > y.value();}
+
+
+// price and its derivatives in the inputs of a pricer
+struct PriceGradient{
+    double price = 0.0;
+    double spot = 0.0;
+    std::vector<double> r;   // one per knot of the Parameters (ParametersInner::num_knots)
+    std::vector<double> d;
+    std::vector<double> vol;
+    std::vector<double> payoff; // one per parameter of the product, e.g. strikes
+};
+
+// leaves for the values, in order
+void make_leaves(const std::vector<double>& values, std::vector<Number>& leaves);
+// adjoints of the leaves, in order
+void get_adjoints(const std::vector<Number>& leaves, std::vector<double>& adjoints);
+
+#endif /* aad_hpp */
@@ -0,0 +1,69 @@
+//
+//  alloc_audit.cpp
+//  derivs
+//
+//  Created by Xin Li on 3/30/22.
+//
+
+#include "alloc_audit.hpp"
+
+#ifdef ALLOC_AUDIT
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+namespace {
+std::atomic<unsigned long> num_allocations(0);
+
+void* counted_malloc(std::size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+
+// over-allocate from malloc and keep the malloc'ed address just before the aligned block
+void* counted_aligned_malloc(std::size_t size, std::size_t alignment)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* raw = std::malloc(size + alignment + sizeof(void*));
+    if(!raw) throw std::bad_alloc();
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+    std::uintptr_t aligned = (start + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void aligned_free(void* p)
+{
+    if(p) std::free(static_cast<void**>(p)[-1]);
+}
+}
+
+bool alloc_audit_enabled() {return true;}
+unsigned long allocation_count() {return num_allocations.load(std::memory_order_relaxed);}
+
+// the nothrow and array forms of the standard library call these
+void* operator new(std::size_t size) {return counted_malloc(size);}
+void* operator new[](std::size_t size) {return counted_malloc(size);}
+void* operator new(std::size_t size, std::align_val_t alignment) {return counted_aligned_malloc(size, static_cast<std::size_t>(alignment));}
+void* operator new[](std::size_t size, std::align_val_t alignment) {return counted_aligned_malloc(size, static_cast<std::size_t>(alignment));}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {aligned_free(p);}
+void operator delete[](void* p, std::align_val_t) noexcept {aligned_free(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {aligned_free(p);}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {aligned_free(p);}
+
+#else
+
+bool alloc_audit_enabled() {return false;}
+unsigned long allocation_count() {return 0;}
+
+#endif /* ALLOC_AUDIT */
@@ -0,0 +1,29 @@
+//
+//  alloc_audit.hpp
+//  derivs
+//
+//  Created by Xin Li on 3/30/22.
+//
+
+#ifndef alloc_audit_hpp
+#define alloc_audit_hpp
+
+/*count heap allocations, to check that the pricing loops do not allocate once they are warmed up.
+ Compile with ALLOC_AUDIT defined to replace the global operator new/delete by counting versions (alloc_audit.cpp),
+ without it the count stays at 0 and alloc_audit_enabled() returns false.
+ The count covers all threads.
+ */
+
+bool alloc_audit_enabled();
+unsigned long allocation_count(); // number of calls to operator new so far
+
+// counts the allocations made during its lifetime
+class AllocationCounter{
+public:
+    AllocationCounter(): start(allocation_count()){}
+    unsigned long count() const {return allocation_count() - start;}
+private:
+    unsigned long start;
+};
+
+#endif /* alloc_audit_hpp */
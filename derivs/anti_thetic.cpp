@@ -31,23 +31,24 @@ void AntiThetic::get_uniforms(MJArray& variates)
     
 }
 
-// gen_next = true:
-// even paths -> skip even / 2 - 1 seeds, update next_variates;
-// odd paths -> skip (odd-1) / 2 seeds, use next_variates (???)
-// gen_next = false:
-// even paths -> skip even / 2 seeds, use next_variates;
-// odd paths -> skip (odd-1) / seeds, update next_variates, use next_variates
+// skipping k paths must leave the generator as if k paths were drawn:
+// gen_next = false: the first skipped path is the pending anti-thetic one;
+// then every two paths consume one draw of inner_generator,
+// an odd path left draws once more from inner_generator and keeps its anti-thetic pair pending
 void AntiThetic::skip(unsigned long num_of_paths)
 {
     if(num_of_paths==0) return;
-    if(gen_next){
-        gen_next = false;
+    if(!gen_next){
+        gen_next = true;
         num_of_paths--;
     }
     inner_generator->skip(num_of_paths/2);
     if(num_of_paths % 2){
-        MJArray tmp(get_dim());
-        get_uniforms(tmp);
+        // the skipped path is a fresh draw, only its anti-thetic pair is kept
+        inner_generator->get_uniforms(next_variates);
+        for(unsigned long i=0; i<get_dim(); ++i)
+            next_variates[i] = 1.0 - next_variates[i];
+        gen_next = false;
     }
 }
 
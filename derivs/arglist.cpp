@@ -146,13 +146,10 @@ ArgumentList::ArgumentList(xlw::CellMatrix cells, std::string error_id)
                         bool non_numeric = false;
                         xlw::CellMatrix extracted(extract_cells(cells, row+2, column, error_id, name, non_numeric));
                         if(str_val == "list"){
-                            ArgumentList value(extracted, error_id + ":" + name);
-                            add_list(name, extracted);
-                        }
-                        if(str_val == "cells"){
+                            add(name, ArgumentList(extracted, error_id + ":" + name));
+                        }else if(str_val == "cells"){
                             add(name, extracted);
-                        }
-                        if(str_val == "matrix"){
+                        }else{
                             if(non_numeric)
                                 throw("Non numerical value in matrix argument: " + name + " " + error_id);
                             xlw::MyMatrix value(extracted.RowsInStructure(),
@@ -160,36 +157,34 @@ ArgumentList::ArgumentList(xlw::CellMatrix cells, std::string error_id)
                             for(unsigned long i=0; i<extracted.RowsInStructure(); ++i)
                                 for(unsigned long j=0; j<extracted.ColumnsInStructure(); ++j)
                                     value(i, j) = extracted(i, j);
-                            add(name, value);
-                            cell_below = empty;
-                            rows_down = std::max(rows_down, extracted.RowsInStructure() + 2);
-                            column += extracted.ColumnsInStructure();
-                        }else{
-                            // it is an array or boring string
-                            if((str_val == "array")||(str_val == "vector")){
-                                cell_below.clear();
-                                if(row + 2 >= rows)
-                                    throw(error_id + " data expected below array " + name);
-                                unsigned long size = cells(row+2, column);
-                                cells(row+2, column).clear();
-                                if(row+2+size>=rows)
-                                    throw(error_id + " more data expected below array " + name);
-                                xlw::MyArray arr(size);
-                                for(unsigned long i=0; i<size; ++i){
-                                    arr[i] = cells(row+3+i, column);
-                                    cells(row+3+i, column).clear();
-                                }
-                                add(name, arr);
-                                rows_down = std::max(rows_down, size+2);
-                                column += 1;
-                            }else{
-                                // a plain string
-                                std::string val = cell_below.StringValue();
-                                to_lower_case(val);
-                                add(name, val);
-                                column++;
-                                cell_below=empty;
+                            add(name, std::move(value));
+                        }
+                        cell_below = empty;
+                        rows_down = std::max(rows_down, extracted.RowsInStructure() + 2);
+                        column += std::max(extracted.ColumnsInStructure(), 2ul); // the sizes take two columns
+                    }else{
+                        // it is an array or boring string
+                        if((str_val == "array")||(str_val == "vector")){
+                            cell_below.clear();
+                            if(row + 2 >= rows)
+                                throw(error_id + " data expected below array " + name);
+                            unsigned long size = cells(row+2, column);
+                            cells(row+2, column).clear();
+                            if(row+2+size>=rows)
+                                throw(error_id + " more data expected below array " + name);
+                            xlw::MyArray arr(size);
+                            for(unsigned long i=0; i<size; ++i){
+                                arr[i] = cells(row+3+i, column);
+                                cells(row+3+i, column).clear();
                             }
+                            add(name, std::move(arr));
+                            rows_down = std::max(rows_down, size+2);
+                            column += 1;
+                        }else{
+                            // a plain string
+                            add(name, std::move(str_val));
+                            column++;
+                            cell_below=empty;
                         }
                     }
                 }
@@ -209,207 +204,160 @@ ArgumentList::ArgumentList(xlw::CellMatrix cells, std::string error_id)
 
 
 // add data and register argument names
-void ArgumentList::add(const std::string& arg_name, const std::string& value)
+void ArgumentList::add(std::string_view arg_name, std::string value)
 {
-    ArgumentType type = string;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    str_args.insert(std::pair<std::string, std::string>{arg_name, value});
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, string).index = str_args.size();
+    str_args.push_back(std::move(value));
 }
 
-void ArgumentList::add(const std::string& arg_name, double value)
+void ArgumentList::add(std::string_view arg_name, double value)
 {
-    ArgumentType type = number;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    double_args.insert(std::pair<std::string, double>{arg_name, value});
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, number).number = value;
 }
 
-void ArgumentList::add(const std::string& arg_name, const xlw::MyArray& value)
+void ArgumentList::add(std::string_view arg_name, xlw::MyArray value)
 {
-    ArgumentType type = vector;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    array_args.insert(std::make_pair(arg_name, value));
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, vector).index = array_args.size();
+    array_args.push_back(std::move(value));
 }
 
-void ArgumentList::add(const std::string& arg_name, const xlw::MyMatrix& value)
+void ArgumentList::add(std::string_view arg_name, xlw::MyMatrix value)
 {
-    ArgumentType type = matrix;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    matrix_args.insert(std::make_pair(arg_name, value));
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, matrix).index = matrix_args.size();
+    matrix_args.push_back(std::move(value));
 }
 
-void ArgumentList::add(const std::string& arg_name, bool value)
+void ArgumentList::add(std::string_view arg_name, bool value)
 {
-    ArgumentType type = boolean;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    bool_args.insert(std::pair<std::string, bool>{arg_name, value});
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, boolean).number = value ? 1.0 : 0.0;
 }
 
-void ArgumentList::add(const std::string& arg_name, const xlw::CellMatrix& values)
+void ArgumentList::add(std::string_view arg_name, xlw::CellMatrix values)
 {
-    ArgumentType type = cells;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    cell_args.insert(std::make_pair(arg_name, values));
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, cells).index = cell_args.size();
+    cell_args.push_back(std::move(values));
 }
 
-void ArgumentList::add_list(const std::string& arg_name, const xlw::CellMatrix& values)
+void ArgumentList::add(std::string_view arg_name, ArgumentList values)
 {
-    ArgumentType type = list;
-    // record arg_name -> type
-    // arg_names.push_back(std::pair<std::string, ArgumentType>{arg_name, type});
-    // record arg_name -> value
-    list_args.insert(std::make_pair(arg_name, values));
-    // resigter name
-    register_name(arg_name, type);
+    register_name(arg_name, list).index = list_args.size();
+    list_args.push_back(std::move(values));
 }
 
-void ArgumentList::add(const std::string& arg_name, const ArgumentList& values)
+void ArgumentList::add_list(std::string_view arg_name, const xlw::CellMatrix& values)
 {
-    xlw::CellMatrix cell_values(values.all_data());
-    add_list(arg_name, cell_values);
+    add(arg_name, ArgumentList(values, std::string(arg_name)));
+}
+
+namespace {
+// compares a stored lower case name with a key of any case
+int compare_name(const std::string& name, std::string_view key)
+{
+    std::size_t n = std::min(name.size(), key.size());
+    for(std::size_t i=0; i<n; ++i){
+        unsigned char c = static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(key[i])));
+        unsigned char a = static_cast<unsigned char>(name[i]);
+        if(a != c)
+            return a < c ? -1 : 1;
+    }
+    return name.size() == key.size() ? 0 : (name.size() < key.size() ? -1 : 1);
+}
 }
 
-void ArgumentList::register_name(const std::string &arg_name, ArgumentType type)
+ArgumentList::Argument& ArgumentList::register_name(std::string_view arg_name, ArgumentType type)
 {
-    arg_names.push_back(std::make_pair(arg_name, type));
-    if(!(names.insert(*arg_names.rbegin()).second)) // insert returns a pair (iterator, bool)
-        throw("Same argument name used twice " + arg_name);
-    args_used.insert(std::pair<std::string, bool>{arg_name, false});
+    std::vector<Argument>::iterator it = std::lower_bound(args.begin(), args.end(), arg_name,
+        [](const Argument& arg, std::string_view key){return compare_name(arg.name, key) < 0;});
+    std::string name(arg_name);
+    to_lower_case(name);
+    if(it != args.end() && it->name == name)
+        throw("Same argument name used twice " + name);
+    unsigned long order = args.size();
+    return *args.insert(it, Argument{std::move(name), type, false, order, 0.0, 0});
 }
 
-void ArgumentList::use_arg_name(const std::string& arg_name)
+const ArgumentList::Argument* ArgumentList::find(std::string_view arg_name) const
 {
-    std::map<std::string, bool>::iterator it = args_used.find(arg_name);
-    it->second = true;
+    std::vector<Argument>::const_iterator it = std::lower_bound(args.begin(), args.end(), arg_name,
+        [](const Argument& arg, std::string_view key){return compare_name(arg.name, key) < 0;});
+    if(it == args.end() || compare_name(it->name, arg_name) != 0)
+        return nullptr;
+    return &*it;
+}
+
+ArgumentList::Argument& ArgumentList::use_arg(std::string_view arg_name, ArgumentType type, const char* type_name)
+{
+    Argument* arg = const_cast<Argument*>(find(arg_name));
+    if(arg == nullptr || arg->type != type){
+        std::string name(arg_name);
+        to_lower_case(name);
+        throw(struct_name + " unknown " + type_name + " argument asked for: " + name);
+    }
+    arg->used = true;
+    return *arg;
+}
+
+std::vector<std::pair<std::string, ArgumentList::ArgumentType>> ArgumentList::get_arg_names_types() const
+{
+    std::vector<std::pair<std::string, ArgumentType>> result(args.size());
+    for(const Argument& arg: args)
+        result[arg.order] = std::make_pair(arg.name, arg.type);
+    return result;
 }
 
 // get argument values
-std::string ArgumentList::get_str_arg_val(const std::string& arg_name_)
+const std::string& ArgumentList::get_str_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, std::string>::const_iterator it = str_args.find(arg_name);
-    if(it == str_args.end())
-        throw(struct_name + std::string(" unknown string argument asked for: ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return str_args[use_arg(arg_name, string, "string").index];
 }
 
-unsigned long ArgumentList::get_ul_arg_val(const std::string& arg_name_)
+unsigned long ArgumentList::get_ul_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, double>::const_iterator it = double_args.find(arg_name);
-    if(it == double_args.end())
-        throw(struct_name + std::string(" unknown unsigned long argument asked for: ") + arg_name);
-    use_arg_name(arg_name);
-    return static_cast<unsigned long>(it->second);
+    return static_cast<unsigned long>(use_arg(arg_name, number, "unsigned long").number);
 }
 
-double ArgumentList::get_double_arg_val(const std::string& arg_name_)
+double ArgumentList::get_double_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, double>::const_iterator it = double_args.find(arg_name);
-    if(it == double_args.end())
-        throw(struct_name + std::string(" unknown double argument asked for: ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return use_arg(arg_name, number, "double").number;
 }
 
-xlw::MyArray ArgumentList::get_array_arg_val(const std::string &arg_name_)
+const xlw::MyArray& ArgumentList::get_array_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, xlw::MyArray>::const_iterator it = array_args.find(arg_name);
-    if(it == array_args.end())
-        throw(struct_name + std::string(" unknown array argument asked for : ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return array_args[use_arg(arg_name, vector, "array").index];
 }
 
-xlw::MyMatrix ArgumentList::get_matrix_arg_val(const std::string &arg_name_)
+const xlw::MyMatrix& ArgumentList::get_matrix_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, xlw::MyMatrix>::const_iterator it = matrix_args.find(arg_name);
-    if(it == matrix_args.end())
-        throw(struct_name + std::string(" unknown matrix argument asked for : ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return matrix_args[use_arg(arg_name, matrix, "matrix").index];
 }
 
-bool ArgumentList::get_bool_arg_val(const std::string &arg_name_)
+bool ArgumentList::get_bool_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, bool>::const_iterator it = bool_args.find(arg_name);
-    if(it == bool_args.end())
-        throw(struct_name + std::string(" unknown bool argument asked for : ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return use_arg(arg_name, boolean, "bool").number != 0.0;
 }
 
-xlw::CellMatrix ArgumentList::get_cells_arg_val(const std::string &arg_name_)
+const xlw::CellMatrix& ArgumentList::get_cells_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, xlw::CellMatrix>::const_iterator it = cell_args.find(arg_name);
-    if(it == cell_args.end())
-        throw(struct_name + std::string(" unknown cells argument asked for : ") + arg_name);
-    use_arg_name(arg_name);
-    return it->second;
+    return cell_args[use_arg(arg_name, cells, "cells").index];
 }
 
-ArgumentList ArgumentList::get_arglist_arg_val(const std::string &arg_name_)
+ArgumentList ArgumentList::get_arglist_arg_val(std::string_view arg_name)
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    std::map<std::string, xlw::CellMatrix>::const_iterator it = list_args.find(arg_name);
-    if(it == list_args.end())
-        throw(struct_name + std::string(" unknown arglist argument asked for : ") + arg_name);
-    use_arg_name(arg_name);
-    return ArgumentList(it->second, arg_name);
+    return list_args[use_arg(arg_name, list, "arglist").index];
 }
 
 // check arguments
-bool ArgumentList::is_arg_present(const std::string &arg_name_) const
+bool ArgumentList::is_arg_present(std::string_view arg_name) const
 {
-    std::string arg_name(arg_name_);
-    to_lower_case(arg_name);
-    return names.find(arg_name) != names.end();
+    return find(arg_name) != nullptr;
 }
 
 void ArgumentList::check_all_used(const std::string& error_id) const
 {
     std::string unused_list;
-    for(std::map<std::string, bool>::const_iterator it = args_used.begin();
-        it != args_used.end(); ++it){
-        if(!it->second)
-            unused_list += it->first + std::string(", ");
+    for(const Argument& arg: args){
+        if(!arg.used)
+            unused_list += arg.name + std::string(", ");
     }
     if(unused_list != "")
         throw("Unused arguments in " + error_id + " " + struct_name + " " + unused_list);
@@ -422,7 +370,7 @@ void ArgumentList::generate_throw(std::string msg, unsigned long row, unsigned l
 }
 
 // get optional arguments
-bool ArgumentList::get_if_present(const std::string &arg_name, unsigned long &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, unsigned long &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -430,7 +378,7 @@ bool ArgumentList::get_if_present(const std::string &arg_name, unsigned long &ar
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, double &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, double &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -438,7 +386,7 @@ bool ArgumentList::get_if_present(const std::string &arg_name, double &arg_value
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, xlw::MyArray &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, xlw::MyArray &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -446,7 +394,7 @@ bool ArgumentList::get_if_present(const std::string &arg_name, xlw::MyArray &arg
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, xlw::MyMatrix &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, xlw::MyMatrix &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -454,7 +402,7 @@ bool ArgumentList::get_if_present(const std::string &arg_name, xlw::MyMatrix &ar
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, bool &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, bool &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -462,7 +410,7 @@ bool ArgumentList::get_if_present(const std::string &arg_name, bool &arg_value)
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, xlw::CellMatrix &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, xlw::CellMatrix &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
@@ -470,12 +418,10 @@ bool ArgumentList::get_if_present(const std::string &arg_name, xlw::CellMatrix &
     return true;
 }
 
-bool ArgumentList::get_if_present(const std::string &arg_name, ArgumentList &arg_value)
+bool ArgumentList::get_if_present(std::string_view arg_name, ArgumentList &arg_value)
 {
     if(!is_arg_present(arg_name))
         return false;
     arg_value = get_arglist_arg_val(arg_name);
     return true;
 }
-
-
@@ -15,43 +15,48 @@
 
 #include "xlw/MyContainers.h"
 #include <xlw/CellMatrix.h>
-#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
 void to_lower_case(std::string& input);
 
+/*arguments live in one small vector sorted by name, names are lower cased once when added
+ and lookups compare case insensitively against a string_view, so reading an argument neither allocates nor
+ walks a map. numbers and bools are stored in the entry, other values in one vector per type.
+ nested lists are parsed once, when the outer list is.
+ */
 class ArgumentList{
 public:
     ArgumentList(xlw::CellMatrix cells, std::string error_id);
-    ArgumentList(std::string name):struct_name(name){}
+    ArgumentList(std::string name):struct_name(std::move(name)){}
     
     enum ArgumentType{string, number, vector, matrix, boolean, list, cells};
     
-    std::string get_struct_name() const {return struct_name;}
-    const std::vector<std::pair<std::string, ArgumentType>>& get_arg_names_types() const {return arg_names;}
+    const std::string& get_struct_name() const {return struct_name;}
+    std::vector<std::pair<std::string, ArgumentType>> get_arg_names_types() const; // in the order added
     
     // argument data retrieved using a string key
-    std::string get_str_arg_val(const std::string& arg_name);
-    unsigned long get_ul_arg_val(const std::string& arg_name);
-    double get_double_arg_val(const std::string& arg_name);
-    xlw::MyArray get_array_arg_val(const std::string& arg_name);
-    xlw::MyMatrix get_matrix_arg_val(const std::string& arg_name);
-    bool get_bool_arg_val(const std::string& arg_name);
-    xlw::CellMatrix get_cells_arg_val(const std::string& arg_name);
-    ArgumentList get_arglist_arg_val(const std::string& arg_name);
+    const std::string& get_str_arg_val(std::string_view arg_name);
+    unsigned long get_ul_arg_val(std::string_view arg_name);
+    double get_double_arg_val(std::string_view arg_name);
+    const xlw::MyArray& get_array_arg_val(std::string_view arg_name);
+    const xlw::MyMatrix& get_matrix_arg_val(std::string_view arg_name);
+    bool get_bool_arg_val(std::string_view arg_name);
+    const xlw::CellMatrix& get_cells_arg_val(std::string_view arg_name);
+    ArgumentList get_arglist_arg_val(std::string_view arg_name);
     
     // bool indicates whether the argument was found, deal with optional arguments
     // arg_value get overridden if present
-    bool get_if_present(const std::string& arg_name, unsigned long& arg_value);
-    bool get_if_present(const std::string& arg_name, double& arg_value);
-    bool get_if_present(const std::string& arg_name, xlw::MyArray& arg_value);
-    bool get_if_present(const std::string& arg_name, xlw::MyMatrix& arg_value);
-    bool get_if_present(const std::string& arg_name, bool& arg_value);
-    bool get_if_present(const std::string& arg_name, xlw::CellMatrix& arg_value);
-    bool get_if_present(const std::string& arg_name, ArgumentList& arg_value);
+    bool get_if_present(std::string_view arg_name, unsigned long& arg_value);
+    bool get_if_present(std::string_view arg_name, double& arg_value);
+    bool get_if_present(std::string_view arg_name, xlw::MyArray& arg_value);
+    bool get_if_present(std::string_view arg_name, xlw::MyMatrix& arg_value);
+    bool get_if_present(std::string_view arg_name, bool& arg_value);
+    bool get_if_present(std::string_view arg_name, xlw::CellMatrix& arg_value);
+    bool get_if_present(std::string_view arg_name, ArgumentList& arg_value);
     
-    bool is_arg_present(const std::string& arg_name) const;
+    bool is_arg_present(std::string_view arg_name) const;
     void check_all_used(const std::string& error_id) const; // all args needed to be used to avoid miss-spelled optional arguments
     
     xlw::CellMatrix all_data() const {//a stub will not be used
@@ -59,32 +64,40 @@ public:
     };
     
     // data insertions
-    void add(const std::string& arg_name, const std::string& value);
-    void add(const std::string& arg_name, double value);
-    void add(const std::string& arg_name, const xlw::MyArray& value);
-    void add(const std::string& arg_name, const xlw::MyMatrix& value);
-    void add(const std::string& arg_name, bool value);
-    void add(const std::string& arg_name, const xlw::CellMatrix& values);
-    void add(const std::string& arg_name, const ArgumentList& values);
-    void add_list(const std::string& arg_name, const xlw::CellMatrix& values);
+    void add(std::string_view arg_name, std::string value);
+    void add(std::string_view arg_name, const char* value){add(arg_name, std::string(value));}
+    void add(std::string_view arg_name, double value);
+    void add(std::string_view arg_name, xlw::MyArray value);
+    void add(std::string_view arg_name, xlw::MyMatrix value);
+    void add(std::string_view arg_name, bool value);
+    void add(std::string_view arg_name, xlw::CellMatrix values);
+    void add(std::string_view arg_name, ArgumentList values);
+    void add_list(std::string_view arg_name, const xlw::CellMatrix& values);
     
 private:
+    struct Argument{
+        std::string name;       // lower case
+        ArgumentType type;
+        bool used;
+        unsigned long order;    // position in which it was added
+        double number;          // value of numbers and bools
+        unsigned long index;    // position in the vector of its type for other values
+    };
+    
     std::string struct_name;  //base class name
     // store argument data
-    std::vector<std::pair<std::string, ArgumentType>> arg_names;
-    std::map<std::string, double> double_args;
-    std::map<std::string, xlw::MyArray> array_args;
-    std::map<std::string, xlw::MyMatrix> matrix_args;
-    std::map<std::string, std::string> str_args; // should contain "name"
-    std::map<std::string, xlw::CellMatrix> list_args;
-    std::map<std::string, xlw::CellMatrix> cell_args;
-    std::map<std::string, bool> bool_args;
-    std::map<std::string, ArgumentType> names;
-    std::map<std::string, bool> args_used;
+    std::vector<Argument> args; // sorted by name
+    std::vector<std::string> str_args; // should contain "name"
+    std::vector<xlw::MyArray> array_args;
+    std::vector<xlw::MyMatrix> matrix_args;
+    std::vector<xlw::CellMatrix> cell_args;
+    std::vector<ArgumentList> list_args;
     
-    void generate_throw(std::string msg, unsigned long row, unsigned long column);
-    void use_arg_name(const std::string& arg_name);
-    void register_name(const std::string& arg_name, ArgumentType type);
+    [[noreturn]] void generate_throw(std::string msg, unsigned long row, unsigned long column);
+    const Argument* find(std::string_view arg_name) const;
+    // marks the argument used, throws unless it is present with the type
+    Argument& use_arg(std::string_view arg_name, ArgumentType type, const char* type_name);
+    Argument& register_name(std::string_view arg_name, ArgumentType type);
 };
 
 
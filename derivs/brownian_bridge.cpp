@@ -0,0 +1,97 @@
+//
+//  brownian_bridge.cpp
+//  derivs
+//
+//  Created by Xin Li on 3/28/22.
+//
+
+#include "brownian_bridge.hpp"
+#include <cmath>
+#include "normals.hpp"
+
+BrownianBridge::BrownianBridge(const Wrapper<RandomBase>& _inner, const MJArray& _times)
+: RandomBase(_times.size()), inner_generator(_inner), times(_times)
+{
+    unsigned long n = times.size();
+    if(n == 0)
+        throw("BrownianBridge: empty time grid");
+    inner_generator->reset_dim(n);
+    
+    sqrt_dt.resize(n);
+    for(unsigned long j=0; j<n; ++j){
+        double dt = times[j] - (j ? times[j-1] : 0.0);
+        if(dt <= 0.0)
+            throw("BrownianBridge: times must be positive and increasing");
+        sqrt_dt[j] = std::sqrt(dt);
+    }
+    
+    // construction order: last point first, then bisect the unfilled gaps from left to right
+    bridge_index.assign(n, 0);
+    left_index.assign(n, 0);
+    right_index.assign(n, 0);
+    left_weight.resize(n);
+    right_weight.resize(n);
+    std_dev.resize(n);
+    std::vector<bool> filled(n, false);
+    
+    bridge_index[0] = n - 1;
+    left_weight[0] = right_weight[0] = 0.0;
+    std_dev[0] = std::sqrt(times[n-1]);
+    filled[n-1] = true;
+    
+    unsigned long j = 0;
+    for(unsigned long i=1; i<n; ++i){
+        while(filled[j]) ++j;          // first point of the next gap
+        unsigned long k = j;
+        while(!filled[k]) ++k;         // the filled point closing it
+        unsigned long l = j + ((k - 1 - j) >> 1);
+        filled[l] = true;
+        bridge_index[i] = l;
+        left_index[i] = j;             // left neighbour is j-1, or time 0 when j == 0
+        right_index[i] = k;
+        double t_left = j ? times[j-1] : 0.0;
+        double span = times[k] - t_left;
+        left_weight[i] = (times[k] - times[l]) / span;
+        right_weight[i] = (times[l] - t_left) / span;
+        std_dev[i] = std::sqrt((times[l] - t_left) * (times[k] - times[l]) / span);
+        j = k + 1;
+        if(j >= n) j = 0;
+    }
+    
+    draws.resize(n);
+    path.resize(n);
+}
+
+void BrownianBridge::get_gaussians(MJArray& variates)
+{
+    unsigned long n = get_dim();
+    inner_generator->get_gaussians(draws);
+    
+    path[n-1] = std_dev[0] * draws[0];
+    for(unsigned long i=1; i<n; ++i){
+        unsigned long j = left_index[i];
+        unsigned long l = bridge_index[i];
+        double w = right_weight[i] * path[right_index[i]] + std_dev[i] * draws[i];
+        if(j) w += left_weight[i] * path[j-1];
+        path[l] = w;
+    }
+    
+    variates[0] = path[0] / sqrt_dt[0];
+    for(unsigned long i=1; i<n; ++i)
+        variates[i] = (path[i] - path[i-1]) / sqrt_dt[i];
+}
+
+void BrownianBridge::get_uniforms(MJArray& variates)
+{
+    get_gaussians(variates);
+    cum_norm(&variates[0], &variates[0], get_dim(), get_normal_accuracy());
+}
+
+void BrownianBridge::reset_dim(unsigned long new_dim)
+{
+    // the construction is tied to the time grid
+    if(new_dim != times.size())
+        throw("BrownianBridge: dimension must match the number of times");
+    RandomBase::reset_dim(new_dim);
+    inner_generator->reset_dim(new_dim);
+}
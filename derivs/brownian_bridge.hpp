@@ -0,0 +1,48 @@
+//
+//  brownian_bridge.hpp
+//  derivs
+//
+//  Created by Xin Li on 3/28/22.
+//
+
+#ifndef brownian_bridge_hpp
+#define brownian_bridge_hpp
+
+/*Brownian bridge construction on top of any random number generator, decorator pattern.
+ The first variate of the inner generator builds the Brownian motion at the last time, the next ones fill in
+ the mid points by bisection, the output variates are the normalized increments over the time grid,
+ so the generator still feeds ExoticBSEngine (or anything expecting independent gaussians per step) unchanged.
+ With a low-discrepancy inner generator (RandomSobol), the best dimensions go to the coarse shape of the path.
+ Pass the look-at times of the product, or the cumulative variances when the vol is time dependent.
+ */
+
+#include <vector>
+#include "random.hpp"
+#include "wrapper.hpp"
+
+class BrownianBridge: public RandomBase{
+public:
+    BrownianBridge(const Wrapper<RandomBase>& _inner, const MJArray& _times);
+    RandomBase* clone() const override {return new BrownianBridge(*this);}
+    void get_uniforms(MJArray& variates) override;
+    void get_gaussians(MJArray& variates) override;
+    void skip(unsigned long num_of_paths) override {inner_generator->skip(num_of_paths);}
+    void set_seed(unsigned long _seed) override {inner_generator->set_seed(_seed);}
+    void reset() override {inner_generator->reset();}
+    void reset_dim(unsigned long new_dim) override;
+    void set_normal_accuracy(NormalAccuracy _accuracy) override {
+        RandomBase::set_normal_accuracy(_accuracy);
+        inner_generator->set_normal_accuracy(_accuracy);  // the gaussians come from the inner generator
+    }
+    
+private:
+    Wrapper<RandomBase> inner_generator;
+    MJArray times;
+    MJArray sqrt_dt;  // square roots of the steps, to normalize increments
+    std::vector<unsigned long> bridge_index, left_index, right_index;
+    MJArray left_weight, right_weight, std_dev;
+    MJArray draws;    // workspaces
+    MJArray path;
+};
+
+#endif /* brownian_bridge_hpp */
@@ -0,0 +1,50 @@
+//
+//  control_variate.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/3/22.
+//
+
+#include "control_variate.hpp"
+#include <algorithm>
+
+ControlVariateEngine::ControlVariateEngine(const Wrapper<ExoticEngine>& _engine,
+                                           const Wrapper<PathDependent>& _control,
+                                           const Parameters& _r)
+: engine(_engine), control(_control), discounts(_control->all_possible_times())
+{
+    const MJArray& times = engine->get_product().get_lookat_times();
+    const MJArray& control_times = control->get_lookat_times();
+    if(times.size() != control_times.size())
+        throw("Control product must look at the same times as the engine's product");
+    for(unsigned long i=0; i<times.size(); ++i)
+        if(times[i] != control_times[i])
+            throw("Control product must look at the same times as the engine's product");
+    for(unsigned long i=0; i<discounts.size(); ++i)
+        discounts[i] = std::exp(-_r.integrate(0.0, discounts[i]));
+}
+
+unsigned long ControlVariateEngine::run_simulation(StatsMC& result_gatherer, unsigned long num_paths)
+{
+    path_values.resize(control->get_lookat_times().size());
+    cash_flows.resize(control->max_num_cashflows());
+    unsigned long interval = result_gatherer.check_interval();
+    unsigned long block = interval ? interval : num_paths;
+    unsigned long paths_done = 0;
+    while(paths_done < num_paths){
+        unsigned long n = std::min(block, num_paths - paths_done);
+        for(unsigned long i=0; i<n; ++i){
+            engine->get_one_path(path_values);
+            double val = engine->do_one_path(path_values);
+            unsigned long num_flows = control->CashFlows(path_values, cash_flows);
+            double control_val = 0.0;
+            for(unsigned long k=0; k<num_flows; ++k)
+                control_val += cash_flows[k].amount * discounts[cash_flows[k].time_idx];
+            result_gatherer.dump_controlled_result(val, control_val);
+        }
+        paths_done += n;
+        if(interval && result_gatherer.converged())
+            break;
+    }
+    return paths_done;
+}
@@ -0,0 +1,42 @@
+//
+//  control_variate.hpp
+//  derivs
+//
+//  Created by Xin Li on 4/3/22.
+//
+
+#ifndef control_variate_hpp
+#define control_variate_hpp
+
+/*control variates for ExoticEngine: a control product with a known price is valued on every path of the engine,
+ next to the engine's own product, and both values go to the gatherer through dump_controlled_result.
+ Use StatsControlVariate (mcstats.hpp) with the analytic price of the control to get the adjusted estimate,
+ e.g. PathDependentGeometricAsian with geometric_asian_call as the control of PathDependentAsian.
+ */
+
+#include <vector>
+#include "wrapper.hpp"
+#include "exotic_engine.hpp"
+#include "path_dependent.hpp"
+#include "parameters.hpp"
+#include "mcstats.hpp"
+
+class ControlVariateEngine{
+public:
+    // the control must look at the same times as the engine's product
+    ControlVariateEngine(const Wrapper<ExoticEngine>& _engine,
+                         const Wrapper<PathDependent>& _control,
+                         const Parameters& _r
+                         );
+    // same paths as engine->run_simulation, stops early as it does, returns the number of paths run
+    unsigned long run_simulation(StatsMC& result_gatherer, unsigned long num_paths);
+    
+private:
+    Wrapper<ExoticEngine> engine;
+    Wrapper<PathDependent> control;
+    MJArray discounts; // control's discount factors
+    MJArray path_values; // workspaces
+    std::vector<CashFlow> cash_flows;
+};
+
+#endif /* control_variate_hpp */
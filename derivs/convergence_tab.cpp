@@ -6,6 +6,7 @@
 //
 
 #include "convergence_tab.hpp"
+#include <cmath>
 
 ConvergenceTable::ConvergenceTable(const Wrapper<StatsMC>& _inner)
 :inner(_inner), results_sofar(0){
@@ -45,5 +46,140 @@ std::vector<std::vector<double>> ConvergenceTable::get_results_sofar() const {
     return tmp;
 }
 
+void ConvergenceTable::reset() {
+    inner->reset();
+    results_sofar.clear();
+    paths_done = 0;
+    stop_point = 2;
+}
+
+// the snapshots of the first part merged into an empty table are exactly the snapshots of a single run,
+// the snapshots of later parts are not, only the merged stats at a power of 2 is recorded for them
+void ConvergenceTable::merge(const StatsMC& other) {
+    const ConvergenceTable* rhs = dynamic_cast<const ConvergenceTable*>(&other);
+    if(rhs == nullptr)
+        throw("ConvergenceTable can only merge with another ConvergenceTable");
+    inner->merge(*(rhs->inner));
+    if(paths_done == 0){
+        results_sofar = rhs->results_sofar;
+        stop_point = rhs->stop_point;
+    }
+    paths_done += rhs->paths_done;
+    while(stop_point <= paths_done){
+        if(paths_done == stop_point){
+            std::vector<std::vector<double>> res(inner->get_results_sofar());
+            for(unsigned long i = 0; i < res.size(); ++i){
+                res[i].push_back(paths_done);
+                results_sofar.push_back(res[i]);
+            }
+        }
+        stop_point *= 2;
+    }
+    return;
+}
+
+// layout: paths_done, stop_point, number of rows, each row as (row size, row values), then the inner state
+std::vector<double> ConvergenceTable::get_state() const {
+    std::vector<double> state{static_cast<double>(paths_done),
+                              static_cast<double>(stop_point),
+                              static_cast<double>(results_sofar.size())};
+    for(const auto& row: results_sofar){
+        state.push_back(row.size());
+        state.insert(state.end(), row.begin(), row.end());
+    }
+    std::vector<double> inner_state(inner->get_state());
+    state.insert(state.end(), inner_state.begin(), inner_state.end());
+    return state;
+}
+
+void ConvergenceTable::set_state(const std::vector<double>& state) {
+    if(state.size() < 3)
+        throw("ConvergenceTable state is too short");
+    unsigned long pos = 3;
+    if(!(state[2] >= 0.0 && state[2] <= state.size()))
+        throw("ConvergenceTable state has a bad number of rows");
+    unsigned long num_rows = static_cast<unsigned long>(state[2]);
+    std::vector<std::vector<double>> rows(num_rows);
+    for(unsigned long i = 0; i < num_rows; ++i){
+        if(pos >= state.size() || !(state[pos] >= 0.0 && pos + 1 + state[pos] <= state.size()))
+            throw("ConvergenceTable state is too short");
+        unsigned long row_size = static_cast<unsigned long>(state[pos]);
+        rows[i].assign(state.begin() + pos + 1, state.begin() + pos + 1 + row_size);
+        pos += 1 + row_size;
+    }
+    inner->set_state(std::vector<double>(state.begin() + pos, state.end()));
+    paths_done = static_cast<unsigned long>(state[0]);
+    stop_point = static_cast<unsigned long>(state[1]);
+    results_sofar = rows;
+}
+
+ConvergenceStop::ConvergenceStop(const Wrapper<StatsMC>& _inner,
+                                 double _target_error,
+                                 double _target_relative_error,
+                                 unsigned long _interval,
+                                 unsigned long _min_paths)
+:inner(_inner), target_error(_target_error), target_relative_error(_target_relative_error),
+interval(_interval), min_paths(_min_paths), num_shares(1){
+    if(interval == 0)
+        throw("ConvergenceStop needs a positive check interval");
+}
 
+StatsMC* ConvergenceStop::clone() const {
+    return new ConvergenceStop(*this);
+}
+
+void ConvergenceStop::dump_one_result(double result) {
+    inner->dump_one_result(result);
+    variance.dump_one_result(result);
+}
+
+std::vector<std::vector<double>> ConvergenceStop::get_results_sofar() const {
+    std::vector<std::vector<double>> res(inner->get_results_sofar());
+    for(unsigned long i = 0; i < res.size(); ++i){
+        res[i].push_back(variance.get_standard_error());
+        res[i].push_back(variance.get_paths_done());
+    }
+    return res;
+}
+
+void ConvergenceStop::reset() {
+    inner->reset();
+    variance.reset();
+}
 
+void ConvergenceStop::merge(const StatsMC& other) {
+    const ConvergenceStop* rhs = dynamic_cast<const ConvergenceStop*>(&other);
+    if(rhs == nullptr)
+        throw("ConvergenceStop can only merge with another ConvergenceStop");
+    inner->merge(*(rhs->inner));
+    variance.merge(rhs->variance);
+}
+
+void ConvergenceStop::set_num_shares(unsigned long _num_shares) {
+    if(_num_shares == 0)
+        throw("ConvergenceStop needs a positive number of shares");
+    num_shares = _num_shares;
+}
+
+bool ConvergenceStop::converged() const {
+    if(variance.get_paths_done() * num_shares < min_paths || variance.get_paths_done() < 2)
+        return false;
+    double error = variance.get_standard_error() / std::sqrt(static_cast<double>(num_shares));
+    return (target_error > 0.0 && error <= target_error)
+        || (target_relative_error > 0.0 && error <= target_relative_error * std::fabs(variance.get_mean()));
+}
+
+// layout: the running variance state (3 values), then the inner state
+std::vector<double> ConvergenceStop::get_state() const {
+    std::vector<double> state(variance.get_state());
+    std::vector<double> inner_state(inner->get_state());
+    state.insert(state.end(), inner_state.begin(), inner_state.end());
+    return state;
+}
+
+void ConvergenceStop::set_state(const std::vector<double>& state) {
+    if(state.size() < 3)
+        throw("ConvergenceStop state is too short");
+    inner->set_state(std::vector<double>(state.begin() + 3, state.end()));
+    variance.set_state(std::vector<double>(state.begin(), state.begin() + 3));
+}
@@ -20,6 +20,13 @@ public:
     
     void dump_one_result(double result) override;
     std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    unsigned long check_interval() const override {return inner->check_interval();}
+    bool converged() const override {return inner->converged();}
+    void set_num_shares(unsigned long num_shares) override {inner->set_num_shares(num_shares);}
     
 private:
     Wrapper<StatsMC> inner; // a specific stats to check for convergence
@@ -29,5 +36,43 @@ private:
 };
 
 
+// stop a simulation once the standard error of the mean is within target_error,
+// or within target_relative_error of the absolute mean; a target <= 0 is not used.
+// The error is tracked by a running variance and tested every interval paths, from min_paths on.
+// results: the rows of inner, each with the standard error and the paths done appended
+// with run_simulation_parallel every worker stops on its own share: with T shares a share's standard error is sqrt(T)
+// times the merged one, so the share is held to sqrt(T) times the targets and min_paths / T paths
+class ConvergenceStop: public StatsMC{
+public:
+    ConvergenceStop(const Wrapper<StatsMC>& _inner,
+                    double _target_error,
+                    double _target_relative_error=0.0,
+                    unsigned long _interval=1000,
+                    unsigned long _min_paths=1000);
+    StatsMC* clone() const override;
+    
+    void dump_one_result(double result) override;
+    std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    unsigned long check_interval() const override {return interval;}
+    bool converged() const override;
+    void set_num_shares(unsigned long _num_shares) override;
+    
+    unsigned long get_paths_done() const {return variance.get_paths_done();}
+    double get_standard_error() const {return variance.get_standard_error();}
+    
+private:
+    Wrapper<StatsMC> inner;
+    StatsVariance variance;
+    double target_error;
+    double target_relative_error;
+    unsigned long interval;
+    unsigned long min_paths;
+    unsigned long num_shares;
+};
+
 
 #endif /* convergence_tab_hpp */
@@ -6,6 +6,166 @@
 //
 
 #include "exotic_engine.hpp"
+#include "fast_math.hpp"
+#include <algorithm>
+#include <thread>
+#include <exception>
+
+unsigned long ExoticEngine::run_simulation_parallel(StatsMC& result_gatherer, unsigned long num_paths, unsigned long num_threads)
+{
+    if(num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if(num_threads > num_paths)
+        num_threads = std::max(1ul, num_paths);
+    
+    // contiguous share of paths for each worker, the first (num_paths % num_threads) workers take one extra path
+    std::vector<unsigned long> first_path(num_threads), paths(num_threads);
+    unsigned long start = 0;
+    for(unsigned long t=0; t<num_threads; ++t){
+        first_path[t] = start;
+        paths[t] = num_paths / num_threads + (t < num_paths % num_threads ? 1 : 0);
+        start += paths[t];
+    }
+    
+    // all copies are taken before any worker starts, the last share runs on this engine,
+    // so its generator ends where the last worker stopped
+    std::vector<Wrapper<ExoticEngine>> engines(num_threads - 1);
+    std::vector<Wrapper<StatsMC>> gatherers(num_threads);
+    for(unsigned long t=0; t<num_threads; ++t){
+        if(t + 1 < num_threads)
+            engines[t] = Wrapper<ExoticEngine>(clone());
+        gatherers[t] = Wrapper<StatsMC>(result_gatherer);
+        gatherers[t]->reset();
+        gatherers[t]->set_num_shares(num_threads);
+    }
+    
+    std::vector<std::exception_ptr> errors(num_threads);
+    std::vector<unsigned long> paths_done(num_threads, 0);
+    auto work = [&](unsigned long t){
+        try{
+            ExoticEngine& engine = t + 1 < num_threads ? *engines[t] : *this;
+            engine.skip_paths(first_path[t]);
+            paths_done[t] = engine.run_simulation(*gatherers[t], paths[t]);
+        }catch(...){
+            errors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned long t=0; t+1<num_threads; ++t)
+        workers.emplace_back(work, t);
+    work(num_threads - 1);
+    for(auto& w: workers)
+        w.join();
+    for(const auto& e: errors)
+        if(e) std::rethrow_exception(e);
+    
+    unsigned long total = 0;
+    for(unsigned long t=0; t<num_threads; ++t){
+        result_gatherer.merge(*gatherers[t]);
+        total += paths_done[t];
+    }
+    return total;
+}
+
+unsigned long ExoticEngine::run_simulation_batch(StatsMC& result_gatherer, unsigned long num_paths, unsigned long batch_size)
+{
+    if(batch_size == 0)
+        throw("run_simulation_batch needs a positive batch_size");
+    unsigned long max_flows = product->max_num_cashflows();
+    unsigned long interval = result_gatherer.check_interval();
+    unsigned long next_check = interval;
+    unsigned long paths_done = 0;
+    while(paths_done < num_paths){
+        unsigned long n = std::min(batch_size, num_paths - paths_done);
+        get_paths(spot_block, n);
+        product->CashFlowsBatch(spot_block, n, batch_flows, batch_num_flows);
+        for(unsigned long p=0; p<n; ++p){
+            double val = 0.0;
+            const CashFlow* flows = &batch_flows[p * max_flows];
+            for(unsigned long i=0; i<batch_num_flows[p]; ++i)
+                val += flows[i].amount * discounts[flows[i].time_idx];
+            result_gatherer.dump_one_result(val);
+        }
+        paths_done += n;
+        if(interval && paths_done >= next_check){
+            if(result_gatherer.converged())
+                break;
+            next_check = (paths_done / interval + 1) * interval;
+        }
+    }
+    return paths_done;
+}
+
+unsigned long ExoticEngine::run_simulation_greeks(StatsMC& result_gatherer, unsigned long num_paths)
+{
+    MJArray times(product->all_possible_times());
+    unsigned long num_times = product->get_lookat_times().size();
+    unsigned long max_flows = product->max_num_cashflows();
+    bool pathwise = product->has_cash_flow_gradients();
+    path_values.resize(num_times);
+    cash_flows.resize(max_flows);
+    tangents.resize(NUM_GREEKS * num_times);
+    scores.resize(NUM_GREEKS);
+    gradients.resize(max_flows * num_times);
+    greek_results.resize(NUM_GREEKS + 1);
+    unsigned long interval = result_gatherer.check_interval();
+    unsigned long block = interval ? interval : num_paths;
+    unsigned long paths_done = 0;
+    while(paths_done < num_paths){
+        unsigned long n = std::min(block, num_paths - paths_done);
+        for(unsigned long p=0; p<n; ++p){
+            get_one_path_sensitivities(path_values, tangents, scores);
+            unsigned long num_cashflows = product->CashFlows(path_values, cash_flows);
+            double val = 0.0, rate_term = 0.0;
+            for(unsigned long i=0; i<num_cashflows; ++i){
+                double flow = cash_flows[i].amount * discounts[cash_flows[i].time_idx];
+                val += flow;
+                rate_term -= flow * times[cash_flows[i].time_idx]; // the discount factors move with r too
+            }
+            greek_results[0] = val;
+            if(pathwise){
+                // d value / d theta_g = sum over flows i and times j of discount_i * d amount_i / d spot_j * spot_j * tangent_gj
+                product->CashFlowGradients(path_values, gradients);
+                for(unsigned long g=0; g<NUM_GREEKS; ++g)
+                    greek_results[g + 1] = 0.0;
+                for(unsigned long i=0; i<num_cashflows; ++i){
+                    double df = discounts[cash_flows[i].time_idx];
+                    for(unsigned long j=0; j<num_times; ++j){
+                        double ds = df * gradients[i * num_times + j] * path_values[j];
+                        for(unsigned long g=0; g<NUM_GREEKS; ++g)
+                            greek_results[g + 1] += ds * tangents[g * num_times + j];
+                    }
+                }
+            }else{
+                for(unsigned long g=0; g<NUM_GREEKS; ++g)
+                    greek_results[g + 1] = val * scores[g];
+            }
+            greek_results[NUM_GREEKS] += rate_term;
+            result_gatherer.dump_results(greek_results.data(), NUM_GREEKS + 1);
+        }
+        paths_done += n;
+        if(interval && result_gatherer.converged())
+            break;
+    }
+    return paths_done;
+}
+
+void ExoticEngine::get_one_path_sensitivities(MJArray&, MJArray&, MJArray&)
+{
+    throw("get_one_path_sensitivities not provided by the engine");
+}
+
+void ExoticEngine::get_paths(MJArray& spot_block, unsigned long num_paths)
+{
+    unsigned long num_times = product->get_lookat_times().size();
+    spot_block.resize(num_times * num_paths);
+    path_values.resize(num_times);
+    for(unsigned long p=0; p<num_paths; ++p){
+        get_one_path(path_values);
+        for(unsigned long j=0; j<num_times; ++j)
+            spot_block[j * num_paths + p] = path_values[j];
+    }
+}
 
 /*Black-Scholes engine: dS(t) = (r(t) - d(t)) * S(t) * dt + vol(t) * S(t) * dWt
  can be solved or integrated out analytically
@@ -16,21 +176,24 @@ ExoticBSEngine::ExoticBSEngine
   const Parameters& _d,  // dividends
   const Parameters& _vol,
   const Wrapper<RandomBase>& _generator,
-  double _spot0):ExoticEngine(_product, _r), generator(_generator)
+  double _spot0):ExoticEngine(_product, _r), generator(_generator), d(_d), vol(_vol)
 {
     MJArray times(product->get_lookat_times());
     num_times = times.size();
     generator->reset_dim(num_times);
     drifts.resize(num_times);
     stds.resize(num_times);
+    vol_integrals.resize(num_times);
     
-    double var = _vol.integrate_square(0.0, times[0]);
-    drifts[0] = _r.integrate(0.0, times[0]) - _d.integrate(0.0, times[0]) - 0.5 * var;
-    stds[0] = std::sqrt(var);
-    for(unsigned long j=1; j<num_times; ++j){
-        double dvar = _vol.integrate_square(times[j-1], times[j]);
-        drifts[j] = _r.integrate(times[j-1], times[j]) -_d.integrate(times[j-1], times[j]) - 0.5 * dvar;
-        stds[j] = std::sqrt(dvar);
+    // integrals over the steps between lookat times, one pass over the knots of each parameter
+    MJArray dividends(num_times);
+    _vol.integrate_grid(0.0, times.data(), num_times, vol_integrals.data());
+    _vol.integrate_square_grid(0.0, times.data(), num_times, stds.data());
+    _r.integrate_grid(0.0, times.data(), num_times, drifts.data());
+    _d.integrate_grid(0.0, times.data(), num_times, dividends.data());
+    for(unsigned long j=0; j<num_times; ++j){
+        drifts[j] = drifts[j] - dividends[j] - 0.5 * stds[j];
+        stds[j] = std::sqrt(stds[j]);
     }
     
     log_spot = std::log(_spot0);
@@ -48,3 +211,137 @@ void ExoticBSEngine::get_one_path(MJArray& spot_values)
     }
     return;
 }
+
+/*sensitivities of a path, step j adds drift_j + std_j * Z_j to the log spot, with v_j = std_j^2:
+ spot0: d log spot_j = 1 / spot0, score Z_k / (spot0 * std_k) for k the first step with variance
+ vol + eps: d drift_j = -s_j, d std_j = s_j / std_j for s_j the integral of vol over step j,
+     d log spot_j = sum over steps k <= j of s_k * (Z_k / std_k - 1), score sum of s_k / v_k * (Z_k^2 - 1) - s_k * Z_k / std_k
+ r + eps: d drift_j = dt_j, d log spot_j = t_j, score sum of Z_k * dt_k / std_k
+ a step without variance carries no density, its score terms are left out
+ */
+void ExoticBSEngine::get_one_path_sensitivities(MJArray& spot_values, MJArray& tangents, MJArray& scores)
+{
+    generator->get_gaussians(variates);
+    const MJArray& times = product->get_lookat_times();
+    double spot0 = std::exp(log_spot);
+    double current_log_spot = log_spot;
+    double vol_tangent = 0.0;
+    bool spot_scored = false;
+    scores = 0.0;
+    for(unsigned long j=0; j<num_times; ++j){
+        double z = variates[j];
+        current_log_spot += drifts[j];
+        current_log_spot += stds[j] * z;
+        spot_values[j] = std::exp(current_log_spot);
+        double s = vol_integrals[j];
+        double dt = times[j] - (j ? times[j-1] : 0.0);
+        if(stds[j] > 0.0){
+            if(!spot_scored){
+                scores[0] = z / (spot0 * stds[j]);
+                spot_scored = true;
+            }
+            vol_tangent += s * (z / stds[j] - 1.0);
+            scores[1] += s / (stds[j] * stds[j]) * (z * z - 1.0) - s * z / stds[j];
+            scores[2] += z * dt / stds[j];
+        }else{
+            vol_tangent -= s;
+        }
+        tangents[j] = 1.0 / spot0;
+        tangents[num_times + j] = vol_tangent;
+        tangents[2 * num_times + j] = times[j];
+    }
+    return;
+}
+
+double ExoticBSEngine::run_simulation_aad(unsigned long num_paths, PriceGradient& gradient)
+{
+    Tape& tape = Tape::get_tape();
+    tape.rewind();
+    const MJArray& times = product->get_lookat_times();
+    MJArray flow_times(product->all_possible_times());
+    unsigned long max_flows = product->max_num_cashflows();
+    
+    // inputs
+    std::vector<Number> r_knots, d_knots, vol_knots, parameters;
+    Number spot0 = Number::leaf(std::exp(log_spot));
+    make_leaves(get_r().get_knots(), r_knots);
+    make_leaves(d.get_knots(), d_knots);
+    make_leaves(vol.get_knots(), vol_knots);
+    std::vector<double> parameter_values(product->num_parameters());
+    product->get_parameters(parameter_values.data());
+    make_leaves(parameter_values, parameters);
+    
+    // setup, as in the constructor
+    std::vector<Number> step_drifts(num_times), step_stds(num_times), discount_numbers(flow_times.size());
+    for(unsigned long j=0; j<num_times; ++j){
+        double t0 = j ? times[j-1] : 0.0;
+        Number var = vol.integrate_square(t0, times[j], vol_knots);
+        step_drifts[j] = get_r().integrate(t0, times[j], r_knots) - d.integrate(t0, times[j], d_knots) - 0.5 * var;
+        step_stds[j] = sqrt(var);
+    }
+    for(unsigned long i=0; i<flow_times.size(); ++i)
+        discount_numbers[i] = exp(-get_r().integrate(0.0, flow_times[i], r_knots));
+    Number log_spot0 = log(spot0);
+    unsigned long mark = tape.size();
+    
+    // paths, the adjoints of the setup add up over paths
+    std::vector<Number> spots(num_times), amounts(max_flows);
+    std::vector<unsigned long> time_idx(max_flows);
+    double sum = 0.0;
+    for(unsigned long p=0; p<num_paths; ++p){
+        tape.rewind(mark);
+        generator->get_gaussians(variates);
+        Number current_log_spot = log_spot0;
+        for(unsigned long j=0; j<num_times; ++j){
+            current_log_spot = current_log_spot + step_drifts[j] + step_stds[j] * variates[j];
+            spots[j] = exp(current_log_spot);
+        }
+        unsigned long num_cashflows = product->CashFlows(spots.data(), parameters.data(), amounts.data(), time_idx.data());
+        Number val(0.0);
+        for(unsigned long i=0; i<num_cashflows; ++i)
+            val += amounts[i] * discount_numbers[time_idx[i]];
+        sum += val.value();
+        if(val.is_active()){
+            tape.add_adjoint(val.get_node(), 1.0);
+            tape.propagate(val.get_node(), mark);
+        }
+    }
+    tape.rewind(mark);
+    
+    // average over paths and sweep the setup
+    if(num_paths && mark){
+        tape.scale_adjoints(0, mark, 1.0 / num_paths);
+        tape.propagate(mark - 1);
+    }
+    gradient.price = num_paths ? sum / num_paths : 0.0;
+    gradient.spot = spot0.get_adjoint();
+    get_adjoints(r_knots, gradient.r);
+    get_adjoints(d_knots, gradient.d);
+    get_adjoints(vol_knots, gradient.vol);
+    get_adjoints(parameters, gradient.payoff);
+    return gradient.price;
+}
+
+// the block version of get_one_path, same variates and same log-spot arithmetic for each path,
+// but every inner loop runs across paths on contiguous memory so that it can be vectorized,
+// spots agree with get_one_path to rounding of the vectorized exp
+void ExoticBSEngine::get_paths(MJArray& spot_block, unsigned long num_paths)
+{
+    generator->get_gaussian_block(variate_block, num_paths);
+    spot_block.resize(num_times * num_paths);
+    log_spots.resize(num_paths);
+    log_spots = log_spot;
+    for(unsigned long j=0; j<num_times; ++j){
+        unsigned long offset = j * num_paths;
+        double drift = drifts[j];
+        double sd = stds[j];
+        for(unsigned long p=0; p<num_paths; ++p){
+            double x = log_spots[p] + drift;
+            x += sd * variate_block[offset + p];
+            log_spots[p] = x;
+            spot_block[offset + p] = x;
+        }
+        exp_array(&spot_block[offset], &spot_block[offset], num_paths);
+    }
+    return;
+}
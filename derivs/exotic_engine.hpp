@@ -21,27 +21,55 @@
 #include "mcstats.hpp"
 
 #include "random.hpp"
+#include "aad.hpp"
+#include <algorithm>
 
 class ExoticEngine{
 public:
     ExoticEngine(const Wrapper<PathDependent>& product_, const Parameters& r_)
-    :product(product_), r(r_), discounts(product_->all_possible_times()){
+    :product(product_), r(r_), discounts(product_->all_possible_times()), cash_flows(product_->max_num_cashflows()){
         for(unsigned long i=0; i < discounts.size(); ++i)
             discounts[i] = std::exp(-r.integrate(0.0, discounts[i]));
     }
     
-    void run_simulation(StatsMC& result_gatherer, unsigned long num_paths){
-        MJArray spot_values(product->get_lookat_times().size());
+    // runs num_paths paths, or fewer if result_gatherer reports convergence, returns the number of paths run
+    unsigned long run_simulation(StatsMC& result_gatherer, unsigned long num_paths){
+        path_values.resize(product->get_lookat_times().size());
         cash_flows.resize(product->max_num_cashflows());
-        // run simulation and collect results
+        unsigned long interval = result_gatherer.check_interval();
+        unsigned long block = interval ? interval : num_paths;
+        // run simulation and collect results, asking the gatherer whether to go on after each block
         double val;
-        for(unsigned long i=0; i<num_paths; ++i){
-            get_one_path(spot_values);
-            val = do_one_path(spot_values);
-            result_gatherer.dump_one_result(val);
+        unsigned long paths_done = 0;
+        while(paths_done < num_paths){
+            unsigned long n = std::min(block, num_paths - paths_done);
+            for(unsigned long i=0; i<n; ++i){
+                get_one_path(path_values);
+                val = do_one_path(path_values);
+                result_gatherer.dump_one_result(val);
+            }
+            paths_done += n;
+            if(interval && result_gatherer.converged())
+                break;
         }
-        return;
+        return paths_done;
     }
+    // split num_paths across num_threads workers (0: use all hardware threads), each worker runs a cloned engine
+    // with its own product, generator skipped to the start of its share of paths and a reset copy of result_gatherer.
+    // the workers' gatherers are merged into result_gatherer in path order, so for a given seed and num_threads
+    // the result is reproducible, and every path sees exactly the variates it would see in a serial run.
+    // a worker's gatherer is told it holds one of num_threads shares, so an early stop targets the merged result.
+    // returns the number of paths done over all workers, fewer than num_paths when a worker's gatherer converged on its share.
+    // this engine runs the last share, so its generator ends where that worker stopped
+    unsigned long run_simulation_parallel(StatsMC& result_gatherer, unsigned long num_paths, unsigned long num_threads=0);
+    // same paths as run_simulation, generated and valued batch_size paths at a time through get_paths and PathDependent::CashFlowsBatch,
+    // convergence is checked after the batch that crosses each check_interval of the gatherer
+    unsigned long run_simulation_batch(StatsMC& result_gatherer, unsigned long num_paths, unsigned long batch_size=256);
+    // price and first-order Greeks in one pass: every path dumps NUM_GREEKS + 1 results through dump_results,
+    // price, delta (spot0), vega (parallel shift of vol), rho (parallel shift of r), e.g. into a StatsMultiVariance.
+    // pathwise when the product has cash flow gradients, likelihood ratio otherwise (jumps in the payoff)
+    unsigned long run_simulation_greeks(StatsMC& result_gatherer, unsigned long num_paths);
+    static const unsigned long NUM_GREEKS = 3;
     double do_one_path(const MJArray& spot_values) const{
         // accounting along one path
         unsigned long num_cashflows = product->CashFlows(spot_values, cash_flows);
@@ -52,14 +80,34 @@ public:
         return val;
     }
     
+    const PathDependent& get_product() const {return *product;}
+    
     virtual void get_one_path(MJArray& spot_values) = 0; // generate spot_values by a stochastic process
+    // generate num_paths paths, time-major: spot_block[j * num_paths + p] is the spot of path p at lookat time j
+    // default calls get_one_path for each path
+    virtual void get_paths(MJArray& spot_block, unsigned long num_paths);
+    virtual void skip_paths(unsigned long num_paths) = 0; // move the stochastic process forward as if num_paths were generated
+    // get_one_path with the sensitivities of the path to the parameters g of the Greeks (order as in run_simulation_greeks),
+    // tangents[g * num_times + j] = d log spot_j / d theta_g, scores[g] = d log density of the path / d theta_g
+    // default throws, engines supporting run_simulation_greeks override it
+    virtual void get_one_path_sensitivities(MJArray& spot_values, MJArray& tangents, MJArray& scores);
+    virtual ExoticEngine* clone() const = 0;
     virtual ~ExoticEngine(){}
     
 protected:
     Wrapper<PathDependent> product;
+    const Parameters& get_r() const {return r;} // interest rate, for engines recording the discounts (AAD)
 private:
     Parameters r; // interest rate
     MJArray discounts;
+    std::vector<CashFlow> batch_flows;  // workspaces for run_simulation_batch
+    std::vector<unsigned long> batch_num_flows;
+    MJArray spot_block;
+    MJArray path_values; // workspace for run_simulation and get_paths, allocated once
+    MJArray tangents;  // workspaces for run_simulation_greeks
+    MJArray scores;
+    MJArray gradients;
+    MJArray greek_results;
     mutable std::vector<CashFlow> cash_flows;  // can be modified in a const member function, not really a data member but it is a workspace which is created onece and for all (inherited classes) at the beginning,
 };
 
@@ -75,14 +123,27 @@ public:
                    double _spot0
                    );
     void get_one_path(MJArray& spot_values) override;
+    void get_paths(MJArray& spot_block, unsigned long num_paths) override;
+    void skip_paths(unsigned long num_paths) override {generator->skip(num_paths);}
+    void get_one_path_sensitivities(MJArray& spot_values, MJArray& tangents, MJArray& scores) override;
+    ExoticEngine* clone() const override {return new ExoticBSEngine(*this);}
+    // price and its gradient in spot0, the knots of r, d and vol and the parameters of the product (strikes) by AAD,
+    // on the paths run_simulation would draw, returns the price. The setup is recorded once, each path is recorded
+    // after it, swept back into the setup and rewound; a final sweep takes the averaged adjoints to the inputs
+    double run_simulation_aad(unsigned long num_paths, PriceGradient& gradient);
 
 private:
     Wrapper<RandomBase> generator;
+    Parameters d;
+    Parameters vol;
     MJArray drifts;
     MJArray stds;
+    MJArray vol_integrals; // integral of vol over each step, for vega
     double log_spot;
     unsigned long num_times;
     MJArray variates;
+    MJArray variate_block; // workspaces for get_paths
+    MJArray log_spots;
 };
 
 
@@ -16,6 +16,8 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <functional>
+#include <utility>
 
 #include "arglist.hpp"
 
@@ -47,14 +49,15 @@ class ArgListFactory{
 public:
     friend ArgListFactory<T>& FactoryInstance<>();
     
-    typedef T* (*create_T_func)(const ArgumentList&);
+    // the argument list is moved into the object created, it is never copied on the way
+    typedef T* (*create_T_func)(ArgumentList&&);
     void register_class(std::string class_id, create_T_func);
-    T* create_T(ArgumentList args);
+    T* create_T(ArgumentList&& args);
     ~ArgListFactory(){};
     
     std::string get_known_types() const {return known_types;}
 private:
-    std::map<std::string, create_T_func> creator_funcs;
+    std::map<std::string, create_T_func, std::less<>> creator_funcs;
     std::string known_types;
     // avoid create ArgListFactory by itself, created only by FactoryInstance function
     ArgListFactory(){}
@@ -70,17 +73,18 @@ void ArgListFactory<T>::register_class(std::string class_id, create_T_func creat
 }
 
 template<typename T>
-T* ArgListFactory<T>::create_T(ArgumentList args){
-    std::string id = args.get_str_arg_val("name");
-    if(creator_funcs.find(id) == creator_funcs.end())
+T* ArgListFactory<T>::create_T(ArgumentList&& args){
+    const std::string& id = args.get_str_arg_val("name");
+    typename std::map<std::string, create_T_func, std::less<>>::const_iterator it = creator_funcs.find(id);
+    if(it == creator_funcs.end())
         throw(id + " is an unknown class, Known types are : " + known_types);
-    return (creator_funcs.find(id)->second)(args);
+    return (it->second)(std::move(args));
 }
 
-// easy access function
+// easy access function, pass an lvalue with std::move, or a copy if it is still needed
 template<class T>
-T* get_from_factory(const ArgumentList& args){
-    return FactoryInstance<T>().create_T(args);
+T* get_from_factory(ArgumentList&& args){
+    return FactoryInstance<T>().create_T(std::move(args));
 }
 
 
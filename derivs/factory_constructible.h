@@ -17,7 +17,7 @@ template<class TBase, class TDerived>
 class FactoryHelper{
 public:
     FactoryHelper(std::string);
-    static TBase* create(const ArgumentList&);
+    static TBase* create(ArgumentList&&);
     ~FactoryHelper(){}
 };
 
@@ -28,8 +28,8 @@ FactoryHelper<TBase, TDerived>::FactoryHelper(std::string id){
 }
 
 template<class TBase, class TDerived>
-TBase* FactoryHelper<TBase, TDerived>::create(const ArgumentList& input){
-    return new TDerived(input);
+TBase* FactoryHelper<TBase, TDerived>::create(ArgumentList&& input){
+    return new TDerived(std::move(input));
 }
 
 
@@ -0,0 +1,88 @@
+//
+//  fast_math.cpp
+//  derivs
+//
+//  Created by Xin Li on 3/26/22.
+//
+
+#include "fast_math.hpp"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr double LOG2E = 1.4426950408889634;
+constexpr double LN2_HI = 0.693147180369123816490;  // ln2 split in two parts, LN2_HI * k is exact for |k| < 2^11
+constexpr double LN2_LO = 1.90821492927058770002e-10;
+constexpr double ROUND_MAGIC = 6755399441055744.0;   // 1.5 * 2^52, adding it rounds to an integer kept in the low mantissa bits
+constexpr std::uint64_t MANTISSA_MASK = (std::uint64_t(1) << 52) - 1;
+constexpr double EXP_MAX = 709.782712893384;
+constexpr double EXP_MIN = -708.3964185322641;
+constexpr std::uint64_t ONE_BITS = std::uint64_t(1023) << 52;
+constexpr double SQRT2 = 1.4142135623730951;
+constexpr double TWO52 = 4503599627370496.0;         // subnormals are scaled by 2^52 to normalize them
+constexpr double MIN_NORMAL = 2.2250738585072014e-308;
+}
+
+// exp(x) = 2^k * exp(r), k = round(x / ln2), |r| <= ln2 / 2
+// exp(r) by its Taylor series up to r^12, truncation error < 2e-16 relative
+// 2^k is built directly from the exponent bits
+void exp_array(const double* in, double* out, unsigned long n)
+{
+    for(unsigned long i=0; i<n; ++i){
+        double x = in[i];
+        double xc = x < EXP_MIN ? EXP_MIN : x;  // NaN passes through both clamps and propagates
+        xc = xc > EXP_MAX ? EXP_MAX : xc;
+        double kd = xc * LOG2E + ROUND_MAGIC;
+        std::uint64_t kbits;
+        std::memcpy(&kbits, &kd, sizeof(kd));
+        kd -= ROUND_MAGIC;
+        double r = (xc - kd * LN2_HI) - kd * LN2_LO;
+        double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120
+                   + r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880
+                   + r * (1.0 / 3628800 + r * (1.0 / 39916800 + r * (1.0 / 479001600))))))))))));
+        // k + 2^51 sits in the mantissa bits of kbits, k + 1023 shifted into the exponent field gives 2^k;
+        // 2^k alone overflows at the top of the range, so scale in two halves
+        std::int64_t k = static_cast<std::int64_t>(kbits & MANTISSA_MASK) - (std::int64_t(1) << 51);
+        std::int64_t k1 = k >> 1;
+        std::int64_t k2 = k - k1;
+        std::uint64_t b1 = static_cast<std::uint64_t>(k1 + 1023) << 52;
+        std::uint64_t b2 = static_cast<std::uint64_t>(k2 + 1023) << 52;
+        double s1, s2;
+        std::memcpy(&s1, &b1, sizeof(s1));
+        std::memcpy(&s2, &b2, sizeof(s2));
+        double y = p * s1 * s2;
+        y = x > EXP_MAX ? std::numeric_limits<double>::infinity() : y;
+        out[i] = x < EXP_MIN ? 0.0 : y;
+    }
+}
+
+// log(x) = k * ln2 + log(m), x = 2^k * m, sqrt(1/2) <= m < sqrt(2)
+// log(m) = 2 atanh(f), f = (m - 1) / (m + 1), |f| < 0.172, odd series up to f^23, truncation error < 1e-17
+// k and m are read directly from the exponent and mantissa bits
+void log_array(const double* in, double* out, unsigned long n)
+{
+    for(unsigned long i=0; i<n; ++i){
+        double x = in[i];
+        bool subnormal = x < MIN_NORMAL;
+        double xs = subnormal ? x * TWO52 : x;
+        std::uint64_t bits;
+        std::memcpy(&bits, &xs, sizeof(xs));
+        std::int64_t k = static_cast<std::int64_t>(bits >> 52) - 1023;
+        std::uint64_t mbits = (bits & MANTISSA_MASK) | ONE_BITS;
+        double m;
+        std::memcpy(&m, &mbits, sizeof(m));
+        bool high = m > SQRT2;
+        m = high ? 0.5 * m : m;
+        double kd = static_cast<double>(k) + (high ? 1.0 : 0.0) - (subnormal ? 52.0 : 0.0);
+        double f = (m - 1.0) / (m + 1.0);
+        double f2 = f * f;
+        double p = 1.0 + f2 * (1.0 / 3 + f2 * (1.0 / 5 + f2 * (1.0 / 7 + f2 * (1.0 / 9 + f2 * (1.0 / 11
+                   + f2 * (1.0 / 13 + f2 * (1.0 / 15 + f2 * (1.0 / 17 + f2 * (1.0 / 19 + f2 * (1.0 / 21
+                   + f2 * (1.0 / 23)))))))))));
+        double y = kd * LN2_HI + (2.0 * f * p + kd * LN2_LO);
+        y = x == std::numeric_limits<double>::infinity() ? x : y;
+        y = x == 0.0 ? -std::numeric_limits<double>::infinity() : y;
+        out[i] = x < 0.0 || x != x ? std::numeric_limits<double>::quiet_NaN() : y;
+    }
+}
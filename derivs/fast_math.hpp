@@ -0,0 +1,23 @@
+//
+//  fast_math.hpp
+//  derivs
+//
+//  Created by Xin Li on 3/26/22.
+//
+
+#ifndef fast_math_hpp
+#define fast_math_hpp
+
+/*element-wise transcendental functions over arrays, written as plain branch-free loops so that compilers can vectorize them,
+ scalar std:: functions called in a loop cannot be vectorized without special compiler flags and vector math libraries.
+ Results agree with the std:: functions to a couple of ulps, but are not bit-identical.
+ in and out may point to the same array.
+ clang vectorizes the loops as they are; gcc only with -fno-trapping-math (it keeps the range selects as branches otherwise)
+ */
+
+// out[i] = exp(in[i]), underflows to 0 below about -708, overflows to inf above about 709.8
+void exp_array(const double* in, double* out, unsigned long n);
+// out[i] = log(in[i]), -inf at 0, NaN below 0
+void log_array(const double* in, double* out, unsigned long n);
+
+#endif /* fast_math_hpp */
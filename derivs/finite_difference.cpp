@@ -0,0 +1,136 @@
+//
+//  finite_difference.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/8/22.
+//
+
+#include "finite_difference.hpp"
+#include <cmath>
+
+namespace {
+const double SOR_TOLERANCE = 1e-12;
+}
+
+FiniteDifferenceCN::FiniteDifferenceCN(double _spot,
+                                       const Parameters& _r,
+                                       const Parameters& _d,
+                                       double _vol,
+                                       unsigned long _steps,
+                                       unsigned long _space_steps,
+                                       double _time,
+                                       double _num_sds
+                                       )
+: spot(_spot), r(_r), d(_d), vol(_vol), steps(_steps), space_steps(_space_steps + _space_steps % 2), time(_time), num_sds(_num_sds)
+{
+    if(steps < 2 || space_steps < 4)
+        throw("FiniteDifferenceCN needs at least 2 time steps and 4 space steps");
+    // spot sits on the middle node
+    dx = 2.0 * num_sds * vol * std::sqrt(time) / space_steps;
+    spots.resize(space_steps + 1);
+    double up = std::exp(dx);
+    spots[space_steps / 2] = spot;
+    for(unsigned long k=space_steps/2; k<space_steps; ++k)
+        spots[k+1] = spots[k] * up;
+    for(unsigned long k=space_steps/2; k>0; --k)
+        spots[k-1] = spots[k] / up;
+    values.resize(space_steps + 1);
+    lower.resize(space_steps - 1);
+    diag.resize(space_steps - 1);
+    upper.resize(space_steps - 1);
+    rhs.resize(space_steps - 1);
+    scratch.resize(space_steps - 1);
+}
+
+double FiniteDifferenceCN::get_price(const TreeProduct& product)
+{
+    if(product.get_final_time() != time)
+        throw("Mismatched product and finite difference time!");
+    for(unsigned long k=0; k<=space_steps; ++k)
+        values[k] = cell_average_payoff(product, std::log(spots[k]), dx);
+    for(unsigned long i=steps; i>0; --i){
+        double t0 = (i - 1) * time / steps, t1 = i * time / steps;
+        if(i + 2 > steps){
+            double mid = 0.5 * (t0 + t1);
+            step(product, mid, t1, 1.0);
+            step(product, t0, mid, 1.0);
+        }else{
+            step(product, t0, t1, 0.5);
+        }
+    }
+    return values[space_steps / 2];
+}
+
+double FiniteDifferenceCN::get_price_extrapolated(const TreeProduct& product)
+{
+    FiniteDifferenceCN fine(spot, r, d, vol, 2 * steps, 2 * space_steps, time, num_sds);
+    return (4.0 * fine.get_price(product) - get_price(product)) / 3.0;
+}
+
+/*interior nodes 1..M-1 are unknowns, an edge value is linear in spot from its two neighbours:
+ V_0 = (1 + e^-dx) V_1 - e^-dx V_2, V_M = (1 + e^dx) V_M-1 - e^dx V_M-2,
+ substituted into the first and last rows, which keeps the system tridiagonal
+ */
+void FiniteDifferenceCN::step(const TreeProduct& product, double from_time, double to_time, double theta)
+{
+    unsigned long m = space_steps;
+    double var = vol * vol * (to_time - from_time);
+    double rdt = r.integrate(from_time, to_time);
+    double mean = rdt - d.integrate(from_time, to_time) - 0.5 * var;
+    // dt times the operator: a V_k-1 + b V_k + c V_k+1
+    double a = 0.5 * var / (dx * dx) - 0.5 * mean / dx;
+    double c = 0.5 * var / (dx * dx) + 0.5 * mean / dx;
+    double b = -var / (dx * dx) - rdt;
+    double e_down = std::exp(-dx), e_up = std::exp(dx);
+    
+    for(unsigned long k=1; k<m; ++k){
+        unsigned long row = k - 1;
+        rhs[row] = values[k] + (1.0 - theta) * (a * values[k-1] + b * values[k] + c * values[k+1]);
+        lower[row] = -theta * a;
+        diag[row] = 1.0 - theta * b;
+        upper[row] = -theta * c;
+    }
+    unsigned long n = m - 1;
+    diag[0] += lower[0] * (1.0 + e_down);
+    upper[0] += lower[0] * -e_down;
+    lower[0] = 0.0;
+    diag[n-1] += upper[n-1] * (1.0 + e_up);
+    lower[n-1] += upper[n-1] * -e_up;
+    upper[n-1] = 0.0;
+    
+    // Thomas algorithm, the solution goes to values[1..m-1]
+    scratch[0] = upper[0] / diag[0];
+    values[1] = rhs[0] / diag[0];
+    for(unsigned long row=1; row<n; ++row){
+        double denom = diag[row] - lower[row] * scratch[row-1];
+        scratch[row] = upper[row] / denom;
+        values[row+1] = (rhs[row] - lower[row] * values[row]) / denom;
+    }
+    for(unsigned long row=n-1; row>0; --row)
+        values[row] -= scratch[row-1] * values[row+1];
+    
+    // projection by the product, then projected SOR until a sweep changes nothing.
+    // relaxation 2 / (1 + sqrt(1 - rho^2)) for rho the spectral radius of Jacobi on the system (bounded by the interior rows)
+    double rho = (std::fabs(theta * a) + std::fabs(theta * c)) / (1.0 - theta * b);
+    double omega = 2.0 / (1.0 + std::sqrt(std::fmax(1.0 - rho * rho, 0.0)));
+    bool changed = false;
+    for(unsigned long k=1; k<m; ++k){
+        double projected = product.pre_final_value(spots[k], from_time, values[k]);
+        changed = changed || projected != values[k];
+        values[k] = projected;
+    }
+    for(unsigned long sweep=0; changed && sweep<MAX_SWEEPS; ++sweep){
+        double change = 0.0;
+        for(unsigned long k=1; k<m; ++k){
+            unsigned long row = k - 1;
+            double off = (row ? lower[row] * values[k-1] : 0.0) + (row + 1 < n ? upper[row] * values[k+1] : 0.0);
+            double gauss_seidel = (rhs[row] - off) / diag[row];
+            double next = product.pre_final_value(spots[k], from_time, values[k] + omega * (gauss_seidel - values[k]));
+            change += (next - values[k]) * (next - values[k]);
+            values[k] = next;
+        }
+        changed = change > SOR_TOLERANCE * SOR_TOLERANCE;
+    }
+    values[0] = (1.0 + e_down) * values[1] - e_down * values[2];
+    values[m] = (1.0 + e_up) * values[m-1] - e_up * values[m-2];
+}
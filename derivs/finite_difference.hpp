@@ -0,0 +1,67 @@
+//
+//  finite_difference.hpp
+//  derivs
+//
+//  Created by Xin Li on 4/8/22.
+//
+
+#ifndef finite_difference_hpp
+#define finite_difference_hpp
+
+/*Crank-Nicolson finite differences for the Black-Scholes PDE in log spot, V_t + nu V_x + vol^2/2 V_xx - r V = 0,
+ on a uniform grid of space_steps intervals centred on log spot and num_sds standard deviations wide each side.
+ It prices the TreeProduct of the lattices: final_payoff gives the terminal values (averaged over the cell of each node)
+ and pre_final_value is applied as the projection of each time step, solved by projected SOR starting from the
+ unconstrained solution, so a European product costs one tridiagonal solve per step and an American one a few sweeps more.
+ The first two steps are replaced by four implicit half steps (Rannacher) to damp the kink of the payoff.
+ At the edges the values are linear in spot. Error is of order 1 / steps^2 for steps and space_steps growing together
+ on a European product, the exercise boundary of an American one lowers it (order 1.5 to 1.7 on the put of test_lattices,
+ where the extrapolated price is left with an error of order 1 / steps);
+ get_price_extrapolated combines the prices on a grid and on the grid refined twice in both directions.
+ */
+#include "mjarray.hpp"
+#include "parameters.hpp"
+#include "tree_product.hpp"
+
+class FiniteDifferenceCN{
+public:
+    FiniteDifferenceCN(double _spot,
+                       const Parameters& _r,
+                       const Parameters& _d,
+                       double _vol, // constant vol
+                       unsigned long _steps,
+                       unsigned long _space_steps,
+                       double _time,
+                       double _num_sds=5.0
+                       );
+    double get_price(const TreeProduct& product);
+    // (4 * price on the refined grid - price) / 3
+    double get_price_extrapolated(const TreeProduct& product);
+    
+    // projected SOR sweeps per step at most
+    static const unsigned long MAX_SWEEPS = 200;
+    
+private:
+    // from the values at to_time to the values at from_time, theta = 0.5 Crank-Nicolson, 1 implicit
+    void step(const TreeProduct& product, double from_time, double to_time, double theta);
+    
+    double spot;
+    Parameters r;
+    Parameters d;
+    double vol;
+    unsigned long steps;
+    unsigned long space_steps;
+    double time;
+    double num_sds;
+    
+    double dx;
+    MJArray spots;  // spot at each node
+    MJArray values;
+    MJArray lower;  // workspaces of a step, interior nodes only
+    MJArray diag;
+    MJArray upper;
+    MJArray rhs;
+    MJArray scratch;
+};
+
+#endif /* finite_difference_hpp */
@@ -15,11 +15,35 @@
 int main(int argc, const char * argv[]) {
     
     //test_date();
+    //test_observer();
+    //test_interpolation();
+    //test_yieldtermstructure();
+    //test_calendar();
+    //test_biz252();
+    //test_date_parse();
     //test_simpleMC();
     //test_exoticEngine();
+    //test_exoticEngine_parallel();
+    //test_convergence_stop();
+    //test_control_variate();
+    //test_greeks();
+    //test_aad();
+    //test_parameters_piecewise();
+    //test_lattices();
+    //test_stats_merge();
+    //test_random_streams();
+    //test_sobol();
+    //test_normals();
+    //test_mjarray();
+    //test_alloc_audit();
+    //test_vanilla_mc();
     //test_tree();
+    //test_tree_batch();
     //test_solver();
+    //test_implied_vol_batch();
+    //test_bs_batch();
     //test_factory();
+    //test_factory_throughput();
     //std::cout << boost::math::erf(0.5) << std::endl;
     
     double tmp;
@@ -6,3 +6,342 @@
 //
 
 #include "mcstats.hpp"
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "wrapper.hpp"
+
+void StatsVariance::dump_one_result(double result)
+{
+    paths_done++;
+    double delta = result - mean;
+    mean += delta / paths_done;
+    m2 += delta * (result - mean);
+}
+
+std::vector<std::vector<double>> StatsVariance::get_results_sofar() const
+{
+    std::vector<std::vector<double>> ret(1);
+    ret[0].resize(3);
+    if(paths_done != 0){
+        ret[0][0] = mean;
+        ret[0][1] = get_variance();
+        ret[0][2] = get_standard_error();
+    }
+    return ret;
+}
+
+double StatsVariance::get_standard_error() const
+{
+    return paths_done > 1 ? std::sqrt(get_variance() / paths_done) : 0.0;
+}
+
+void StatsVariance::reset()
+{
+    paths_done = 0ul;
+    mean = m2 = 0.0;
+}
+
+void StatsVariance::merge(const StatsMC& other)
+{
+    const StatsVariance* rhs = dynamic_cast<const StatsVariance*>(&other);
+    if(rhs == nullptr)
+        throw("StatsVariance can only merge with another StatsVariance");
+    if(rhs->paths_done == 0) return;
+    double na = paths_done, nb = rhs->paths_done, n = na + nb;
+    double delta = rhs->mean - mean;
+    mean += delta * nb / n;
+    m2 += rhs->m2 + delta * delta * na * nb / n;
+    paths_done += rhs->paths_done;
+}
+
+std::vector<double> StatsVariance::get_state() const
+{
+    return std::vector<double>{static_cast<double>(paths_done), mean, m2};
+}
+
+void StatsVariance::set_state(const std::vector<double>& state)
+{
+    if(state.size() != 3)
+        throw("StatsVariance expects a state of size 3");
+    paths_done = static_cast<unsigned long>(state[0]);
+    mean = state[1];
+    m2 = state[2];
+}
+
+void StatsMoments::dump_one_result(double result)
+{
+    double n1 = paths_done;
+    paths_done++;
+    double n = paths_done;
+    double delta = result - mean;
+    double delta_n = delta / n;
+    double delta_n2 = delta_n * delta_n;
+    double term1 = delta * delta_n * n1;
+    mean += delta_n;
+    m4 += term1 * delta_n2 * (n*n - 3*n + 3) + 6 * delta_n2 * m2 - 4 * delta_n * m3;
+    m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m2;
+    m2 += term1;
+}
+
+std::vector<std::vector<double>> StatsMoments::get_results_sofar() const
+{
+    std::vector<std::vector<double>> ret(1);
+    ret[0].resize(4);
+    if(paths_done != 0){
+        double n = paths_done;
+        ret[0][0] = mean;
+        ret[0][1] = paths_done > 1 ? m2 / (n - 1) : 0.0;
+        if(m2 > 0.0){
+            ret[0][2] = std::sqrt(n) * m3 / std::pow(m2, 1.5);
+            ret[0][3] = n * m4 / (m2 * m2) - 3.0;
+        }
+    }
+    return ret;
+}
+
+void StatsMoments::reset()
+{
+    paths_done = 0ul;
+    mean = m2 = m3 = m4 = 0.0;
+}
+
+void StatsMoments::merge(const StatsMC& other)
+{
+    const StatsMoments* rhs = dynamic_cast<const StatsMoments*>(&other);
+    if(rhs == nullptr)
+        throw("StatsMoments can only merge with another StatsMoments");
+    if(rhs->paths_done == 0) return;
+    double na = paths_done, nb = rhs->paths_done, n = na + nb;
+    double delta = rhs->mean - mean;
+    double delta2 = delta * delta;
+    double delta3 = delta2 * delta;
+    double delta4 = delta2 * delta2;
+    
+    double new_m4 = m4 + rhs->m4
+    + delta4 * na * nb * (na*na - na*nb + nb*nb) / (n*n*n)
+    + 6.0 * delta2 * (na*na * rhs->m2 + nb*nb * m2) / (n*n)
+    + 4.0 * delta * (na * rhs->m3 - nb * m3) / n;
+    double new_m3 = m3 + rhs->m3
+    + delta3 * na * nb * (na - nb) / (n*n)
+    + 3.0 * delta * (na * rhs->m2 - nb * m2) / n;
+    double new_m2 = m2 + rhs->m2 + delta2 * na * nb / n;
+    
+    mean += delta * nb / n;
+    m2 = new_m2;
+    m3 = new_m3;
+    m4 = new_m4;
+    paths_done += rhs->paths_done;
+}
+
+std::vector<double> StatsMoments::get_state() const
+{
+    return std::vector<double>{static_cast<double>(paths_done), mean, m2, m3, m4};
+}
+
+void StatsMoments::set_state(const std::vector<double>& state)
+{
+    if(state.size() != 5)
+        throw("StatsMoments expects a state of size 5");
+    paths_done = static_cast<unsigned long>(state[0]);
+    mean = state[1];
+    m2 = state[2];
+    m3 = state[3];
+    m4 = state[4];
+}
+
+void StatsControlVariate::dump_one_result(double)
+{
+    throw("StatsControlVariate needs the control of each path, use dump_controlled_result");
+}
+
+void StatsControlVariate::dump_results(const double* results, unsigned long num_results)
+{
+    if(num_results != 2)
+        throw("StatsControlVariate needs exactly the result and the control of a path");
+    dump_controlled_result(results[0], results[1]);
+}
+
+void StatsControlVariate::dump_controlled_result(double result, double control)
+{
+    paths_done++;
+    double delta_y = result - mean_y;
+    double delta_c = control - mean_c;
+    mean_y += delta_y / paths_done;
+    mean_c += delta_c / paths_done;
+    m2_y += delta_y * (result - mean_y);
+    m2_c += delta_c * (control - mean_c);
+    c_yc += delta_y * (control - mean_c);
+}
+
+// the residual variance loses two degrees of freedom, one to the mean and one to beta
+double StatsControlVariate::get_standard_error() const
+{
+    if(paths_done < 3) return 0.0;
+    double residual = m2_c > 0.0 ? m2_y - c_yc * c_yc / m2_c : m2_y;
+    return std::sqrt(std::fmax(residual, 0.0) / (paths_done - 2) / paths_done);
+}
+
+std::vector<std::vector<double>> StatsControlVariate::get_results_sofar() const
+{
+    std::vector<std::vector<double>> ret(1);
+    ret[0].resize(5);
+    if(paths_done != 0){
+        ret[0][0] = get_adjusted_mean();
+        ret[0][1] = get_standard_error();
+        ret[0][2] = get_beta();
+        ret[0][3] = mean_y;
+        ret[0][4] = paths_done > 1 ? std::sqrt(m2_y / (paths_done - 1) / paths_done) : 0.0;
+    }
+    return ret;
+}
+
+void StatsControlVariate::reset()
+{
+    paths_done = 0ul;
+    mean_y = mean_c = m2_y = m2_c = c_yc = 0.0;
+}
+
+void StatsControlVariate::merge(const StatsMC& other)
+{
+    const StatsControlVariate* rhs = dynamic_cast<const StatsControlVariate*>(&other);
+    if(rhs == nullptr)
+        throw("StatsControlVariate can only merge with another StatsControlVariate");
+    if(rhs->paths_done == 0) return;
+    double na = paths_done, nb = rhs->paths_done, n = na + nb;
+    double delta_y = rhs->mean_y - mean_y;
+    double delta_c = rhs->mean_c - mean_c;
+    mean_y += delta_y * nb / n;
+    mean_c += delta_c * nb / n;
+    m2_y += rhs->m2_y + delta_y * delta_y * na * nb / n;
+    m2_c += rhs->m2_c + delta_c * delta_c * na * nb / n;
+    c_yc += rhs->c_yc + delta_y * delta_c * na * nb / n;
+    paths_done += rhs->paths_done;
+}
+
+// the control mean is set up by the constructor, it is not part of the state
+std::vector<double> StatsControlVariate::get_state() const
+{
+    return std::vector<double>{static_cast<double>(paths_done), mean_y, mean_c, m2_y, m2_c, c_yc};
+}
+
+void StatsControlVariate::set_state(const std::vector<double>& state)
+{
+    if(state.size() != 6)
+        throw("StatsControlVariate expects a state of size 6");
+    paths_done = static_cast<unsigned long>(state[0]);
+    mean_y = state[1];
+    mean_c = state[2];
+    m2_y = state[3];
+    m2_c = state[4];
+    c_yc = state[5];
+}
+
+void StatsMultiVariance::dump_one_result(double result)
+{
+    if(num_outputs != 1)
+        throw("StatsMultiVariance with several outputs needs all results of a path, use dump_results");
+    dump_results(&result, 1);
+}
+
+void StatsMultiVariance::dump_results(const double* results, unsigned long num_results)
+{
+    if(num_results != num_outputs)
+        throw("StatsMultiVariance: number of results does not match its outputs");
+    paths_done++;
+    for(unsigned long k=0; k<num_outputs; ++k){
+        double delta = results[k] - mean[k];
+        mean[k] += delta / paths_done;
+        m2[k] += delta * (results[k] - mean[k]);
+    }
+}
+
+double StatsMultiVariance::get_standard_error(unsigned long output) const
+{
+    return paths_done > 1 ? std::sqrt(m2[output] / (paths_done - 1) / paths_done) : 0.0;
+}
+
+std::vector<std::vector<double>> StatsMultiVariance::get_results_sofar() const
+{
+    std::vector<std::vector<double>> ret(num_outputs, std::vector<double>(3));
+    if(paths_done != 0){
+        for(unsigned long k=0; k<num_outputs; ++k){
+            ret[k][0] = mean[k];
+            ret[k][1] = paths_done > 1 ? m2[k] / (paths_done - 1) : 0.0;
+            ret[k][2] = get_standard_error(k);
+        }
+    }
+    return ret;
+}
+
+void StatsMultiVariance::reset()
+{
+    paths_done = 0ul;
+    std::fill(mean.begin(), mean.end(), 0.0);
+    std::fill(m2.begin(), m2.end(), 0.0);
+}
+
+void StatsMultiVariance::merge(const StatsMC& other)
+{
+    const StatsMultiVariance* rhs = dynamic_cast<const StatsMultiVariance*>(&other);
+    if(rhs == nullptr || rhs->num_outputs != num_outputs)
+        throw("StatsMultiVariance can only merge with another StatsMultiVariance of the same outputs");
+    if(rhs->paths_done == 0) return;
+    double na = paths_done, nb = rhs->paths_done, n = na + nb;
+    for(unsigned long k=0; k<num_outputs; ++k){
+        double delta = rhs->mean[k] - mean[k];
+        mean[k] += delta * nb / n;
+        m2[k] += rhs->m2[k] + delta * delta * na * nb / n;
+    }
+    paths_done += rhs->paths_done;
+}
+
+// paths done, then the means and the sums of squared deviations of all outputs
+std::vector<double> StatsMultiVariance::get_state() const
+{
+    std::vector<double> state(1, static_cast<double>(paths_done));
+    state.insert(state.end(), mean.begin(), mean.end());
+    state.insert(state.end(), m2.begin(), m2.end());
+    return state;
+}
+
+void StatsMultiVariance::set_state(const std::vector<double>& state)
+{
+    if(state.size() != 1 + 2 * num_outputs)
+        throw("StatsMultiVariance expects a state of size 1 + 2 * number of outputs");
+    paths_done = static_cast<unsigned long>(state[0]);
+    std::copy(state.begin() + 1, state.begin() + 1 + num_outputs, mean.begin());
+    std::copy(state.begin() + 1 + num_outputs, state.end(), m2.begin());
+}
+
+// layout: number of doubles (64 bits unsigned) followed by the state doubles in native byte order
+void write_state(std::ostream& out, const StatsMC& gatherer)
+{
+    std::vector<double> state(gatherer.get_state());
+    std::uint64_t size = state.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(state.data()), size * sizeof(double));
+    if(!out)
+        throw("write_state: failed to write gatherer state");
+}
+
+// the size is checked against what the stream holds before the state grows to it, a corrupt size fails instead of allocating
+void merge_state(std::istream& in, StatsMC& gatherer)
+{
+    const std::uint64_t block = 4096;
+    std::uint64_t size = 0;
+    in.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if(!in)
+        throw("merge_state: failed to read gatherer state size");
+    std::vector<double> state;
+    while(state.size() < size){
+        std::size_t done = state.size();
+        state.resize(done + std::min(block, size - done));
+        in.read(reinterpret_cast<char*>(state.data() + done), (state.size() - done) * sizeof(double));
+        if(!in)
+            throw("merge_state: gatherer state shorter than its size");
+    }
+    Wrapper<StatsMC> partial(gatherer);
+    partial->set_state(state);
+    gatherer.merge(*partial);
+}
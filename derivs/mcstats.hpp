@@ -10,6 +10,7 @@
 
 /*class that deals with various statistics from MC simulations*/
 #include <vector>
+#include <iostream>
 
 //base class, define interface, collect one result
 class StatsMC{
@@ -22,6 +23,22 @@ public:
     // base-interfaces
     virtual void dump_one_result(double result) = 0;
     virtual std::vector<std::vector<double>> get_results_sofar() const = 0;
+    // support splitting a simulation into parts, each part collects its own stats and then merged
+    virtual void reset() = 0;  // back to the state of no results collected
+    virtual void merge(const StatsMC& other) = 0;  // fold in results of other (same concrete type) as if dumped after ours
+    // compact state (counts and running sums), set_state(get_state()) on a clone gives back the same gatherer
+    virtual std::vector<double> get_state() const = 0;
+    virtual void set_state(const std::vector<double>& state) = 0;
+    // a result together with the value of a control variate on the same path, gatherers without a control drop it
+    virtual void dump_controlled_result(double result, double) {dump_one_result(result);}
+    // several results of one path (e.g. price and Greeks), gatherers of a single result keep the first
+    virtual void dump_results(const double* results, unsigned long) {dump_one_result(results[0]);}
+    // early stopping: engines call converged() every check_interval() paths and stop once it is true, 0 never checks
+    virtual unsigned long check_interval() const {return 0;}
+    virtual bool converged() const {return false;}
+    // the gatherer collects one of num_shares equal shares of a run, converged() then tells whether the whole run
+    // would have converged once every share gets as far as this one
+    virtual void set_num_shares(unsigned long) {}
     
 private:
     // no data members, define interfaces
@@ -32,7 +49,7 @@ public:
     StatsMean(): running_sum(0), paths_done(0ul){}
     StatsMC* clone() const override {return new StatsMean(*this);}
     
-    void dump_one_result(double result) override {
+    void dump_one_result(double result) final {
         running_sum += result;
         paths_done += 1;
     }
@@ -43,6 +60,26 @@ public:
             ret[0][0] = running_sum / paths_done;
         return ret;
     }
+    void reset() override {
+        running_sum = 0.0;
+        paths_done = 0ul;
+    }
+    void merge(const StatsMC& other) override {
+        const StatsMean* rhs = dynamic_cast<const StatsMean*>(&other);
+        if(rhs == nullptr)
+            throw("StatsMean can only merge with another StatsMean");
+        running_sum += rhs->running_sum;
+        paths_done += rhs->paths_done;
+    }
+    std::vector<double> get_state() const override {
+        return std::vector<double>{running_sum, static_cast<double>(paths_done)};
+    }
+    void set_state(const std::vector<double>& state) override {
+        if(state.size() != 2)
+            throw("StatsMean expects a state of size 2");
+        running_sum = state[0];
+        paths_done = static_cast<unsigned long>(state[1]);
+    }
 
 private:
     double running_sum;
@@ -50,5 +87,117 @@ private:
 };
 
 
+// running mean and variance by Welford's update, merged by Chan's pairwise formula,
+// results: mean, (unbiased) variance, standard error of the mean
+class StatsVariance: public StatsMC{
+public:
+    StatsVariance(): paths_done(0ul), mean(0.0), m2(0.0){}
+    StatsMC* clone() const override {return new StatsVariance(*this);}
+    
+    void dump_one_result(double result) final;
+    std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    
+    unsigned long get_paths_done() const {return paths_done;}
+    double get_mean() const {return mean;}
+    double get_variance() const {return paths_done > 1 ? m2 / (paths_done - 1) : 0.0;}
+    double get_standard_error() const;
+    
+private:
+    unsigned long paths_done;
+    double mean;
+    double m2;  // sum of squared deviations from mean
+};
+
+// running central moments up to the 4th (Pebay's one-pass and pairwise updates),
+// results: mean, (unbiased) variance, skewness, excess kurtosis
+class StatsMoments: public StatsMC{
+public:
+    StatsMoments(): paths_done(0ul), mean(0.0), m2(0.0), m3(0.0), m4(0.0){}
+    StatsMC* clone() const override {return new StatsMoments(*this);}
+    
+    void dump_one_result(double result) final;
+    std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    
+private:
+    unsigned long paths_done;
+    double mean;
+    double m2;  // sums of powers of deviations from mean
+    double m3;
+    double m4;
+};
+
+// control variate estimate: results come with a control of known mean, Y - beta * (C - control_mean) is averaged,
+// beta = cov(Y, C) / var(C) is estimated from the same paths by running co-moments (merged pairwise as StatsVariance).
+// results: adjusted mean, its standard error, beta, plain mean of Y, its standard error
+// a path is dumped by dump_controlled_result or as the pair (result, control) by dump_results, dump_one_result throws
+class StatsControlVariate: public StatsMC{
+public:
+    StatsControlVariate(double _control_mean)
+    : control_mean(_control_mean), paths_done(0ul), mean_y(0.0), mean_c(0.0), m2_y(0.0), m2_c(0.0), c_yc(0.0){}
+    StatsMC* clone() const override {return new StatsControlVariate(*this);}
+    
+    void dump_one_result(double result) override; // throws, every path needs its control
+    void dump_controlled_result(double result, double control) final;
+    void dump_results(const double* results, unsigned long num_results) override; // results[0] and its control results[1]
+    std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    
+    double get_beta() const {return m2_c > 0.0 ? c_yc / m2_c : 0.0;}
+    double get_adjusted_mean() const {return mean_y - get_beta() * (mean_c - control_mean);}
+    double get_standard_error() const;
+    
+private:
+    double control_mean;
+    unsigned long paths_done;
+    double mean_y;
+    double mean_c;
+    double m2_y;  // sums of squared deviations and the cross co-moment
+    double m2_c;
+    double c_yc;
+};
+
+// StatsVariance for each of num_outputs results of a path, dumped together by dump_results,
+// results: one row per output of mean, (unbiased) variance, standard error of the mean
+class StatsMultiVariance: public StatsMC{
+public:
+    StatsMultiVariance(unsigned long _num_outputs)
+    : num_outputs(_num_outputs), paths_done(0ul), mean(_num_outputs, 0.0), m2(_num_outputs, 0.0){}
+    StatsMC* clone() const override {return new StatsMultiVariance(*this);}
+    
+    void dump_one_result(double result) override; // only for a single output
+    void dump_results(const double* results, unsigned long num_results) final;
+    std::vector<std::vector<double>> get_results_sofar() const override;
+    void reset() override;
+    void merge(const StatsMC& other) override;
+    std::vector<double> get_state() const override;
+    void set_state(const std::vector<double>& state) override;
+    
+    unsigned long get_num_outputs() const {return num_outputs;}
+    unsigned long get_paths_done() const {return paths_done;}
+    double get_mean(unsigned long output) const {return mean[output];}
+    double get_standard_error(unsigned long output) const;
+    
+private:
+    unsigned long num_outputs;
+    unsigned long paths_done;
+    std::vector<double> mean;
+    std::vector<double> m2;
+};
+
+// a compact binary form of a gatherer's state, so partial gatherers from separate processes can be reduced by a driver:
+// each worker writes its state, the driver merges them in order into a gatherer of the same concrete type
+void write_state(std::ostream& out, const StatsMC& gatherer);
+void merge_state(std::istream& in, StatsMC& gatherer);
 
 #endif /* mcstats_hpp */
@@ -7,40 +7,57 @@
 
 #include <algorithm>
 #include <numeric>
+#include <new>
 #include "mjarray.hpp"
 
-// invariance to keep: sz <= capacity && sz == endptr - valptr;
-MJArray::MJArray(unsigned long size): sz(size), capacity(size)
+#ifndef USE_VAL_ARRAY
+
+// storage: arrays up to SMALL_SIZE use the local buffer, larger ones a heap block aligned to ALIGNMENT
+namespace {
+double* allocate_aligned(unsigned long n)
 {
-    if(sz > 0){
-        valptr = new double[size];
-        endptr = valptr + size;
-    }else{
-        valptr = endptr = nullptr;
-    }
+    return static_cast<double*>(::operator new[](n * sizeof(double), std::align_val_t(MJArray::ALIGNMENT)));
 }
 
-MJArray::MJArray(const MJArray& rhs): sz(rhs.sz), capacity(rhs.capacity)
+void free_aligned(double* p)
 {
-    if(sz > 0){
-        valptr = new double[sz];
-        endptr = valptr + sz;
-        // copy contents over
-        std::copy(rhs.valptr, rhs.endptr, valptr);
+    ::operator delete[](p, std::align_val_t(MJArray::ALIGNMENT));
+}
+}
+
+void MJArray::allocate(unsigned long new_capacity)
+{
+    if(on_heap())
+        free_aligned(valptr);
+    if(new_capacity > SMALL_SIZE){
+        valptr = allocate_aligned(new_capacity);
+        capacity = new_capacity;
     }else{
-        valptr = endptr = nullptr;
+        valptr = local;
+        capacity = SMALL_SIZE;
     }
 }
 
+// invariance to keep: sz <= capacity && sz == endptr - valptr;
+MJArray::MJArray(unsigned long size): valptr(local), sz(size), capacity(SMALL_SIZE)
+{
+    allocate(size);
+    endptr = valptr + sz;
+}
+
+MJArray::MJArray(const MJArray& rhs): valptr(local), sz(rhs.sz), capacity(SMALL_SIZE)
+{
+    allocate(sz);
+    endptr = valptr + sz;
+    // copy contents over
+    std::copy(rhs.valptr, rhs.endptr, valptr);
+}
+
 MJArray& MJArray::operator=(const MJArray& rhs)
 {
     if(this == &rhs) return *this;
-    if(rhs.sz > capacity){
-        if(capacity > 0)
-            delete[] valptr; // not actually needed if nullptr is used
-        valptr = new double[rhs.sz];
-        capacity = rhs.sz;
-    }
+    if(rhs.sz > capacity)
+        allocate(rhs.sz);
     // copy contents over
     sz = rhs.sz;
     endptr = valptr + sz;
@@ -48,34 +65,51 @@ MJArray& MJArray::operator=(const MJArray& rhs)
     return *this;
 }
 
-MJArray::MJArray(MJArray&& rhs):sz(rhs.sz), capacity(rhs.capacity)
+MJArray::MJArray(MJArray&& rhs) noexcept: valptr(local), sz(rhs.sz), capacity(SMALL_SIZE)
 {
-    // copy pointers, no copy of contents happened, no need to check sz>0
-    valptr = rhs.valptr;
-    endptr = rhs.endptr;
-    rhs.sz = rhs.capacity = 0;
-    rhs.valptr = rhs.endptr = nullptr;
+    if(rhs.on_heap()){
+        // take over the heap block, no copy of contents
+        valptr = rhs.valptr;
+        capacity = rhs.capacity;
+    }else{
+        std::copy(rhs.valptr, rhs.endptr, valptr);
+    }
+    endptr = valptr + sz;
+    rhs.valptr = rhs.endptr = rhs.local;
+    rhs.sz = 0;
+    rhs.capacity = SMALL_SIZE;
 }
 
-MJArray& MJArray::operator=(MJArray&& rhs)
+MJArray& MJArray::operator=(MJArray&& rhs) noexcept
 {
+    if(this == &rhs) return *this;
+    if(rhs.on_heap()){
+        if(on_heap())
+            free_aligned(valptr);
+        valptr = rhs.valptr;
+        capacity = rhs.capacity;
+    }else{
+        // a short array fits in any storage, keep ours
+        std::copy(rhs.valptr, rhs.endptr, valptr);
+    }
     sz = rhs.sz;
-    capacity = rhs.capacity;
-    delete[] valptr;
-    valptr = rhs.valptr;
     endptr = valptr + sz;
-    rhs.sz = rhs.capacity = 0;
-    rhs.valptr = rhs.endptr = nullptr;
+    rhs.valptr = rhs.endptr = rhs.local;
+    rhs.sz = 0;
+    rhs.capacity = SMALL_SIZE;
     return *this;
 }
 
+MJArray::~MJArray()
+{
+    if(on_heap())
+        free_aligned(valptr);
+}
+
 void MJArray::resize(unsigned long new_size)
 {
-    if(new_size > capacity){
-        delete[] valptr;
-        valptr = new double[new_size];
-        capacity = new_size;
-    }
+    if(new_size > capacity)
+        allocate(new_size);
     sz = new_size;
     endptr = valptr + sz;
 }
@@ -193,3 +227,4 @@ MJArray MJArray::apply(double f(double)) const
     return result;
 }
 
+#endif /*USE_VAL_ARRAY*/
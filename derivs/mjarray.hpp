@@ -17,7 +17,69 @@ typedef std::valarray<double> MJArray;
 
 #else
 // use custom MJArray
-class MJArray{
+#include <utility>
+
+/*element-wise expressions, expression templates (CRTP):
+ a = b * c + d builds a light-weight tree of nodes at compile time and is evaluated in one loop on assignment,
+ no temporary arrays. Array operands are held by reference, so an expression must be assigned within
+ the full-expression that builds it (do not keep it in an auto variable beyond the statement).
+ */
+template<typename E>
+class ArrayExpr{
+public:
+    const E& self() const {return static_cast<const E&>(*this);}
+};
+
+class MJArray;
+
+// how a node holds its operands: arrays by reference, nested expressions and scalars by value
+template<typename E>
+struct ArrayOperand{typedef const E type;};
+template<>
+struct ArrayOperand<MJArray>{typedef const MJArray& type;};
+
+class ArrayScalar: public ArrayExpr<ArrayScalar>{
+public:
+    explicit ArrayScalar(double _val): val(_val){}
+    double operator[](unsigned long) const {return val;}
+    unsigned long size() const {return 0;} // conforms to any size
+private:
+    double val;
+};
+
+template<typename L, typename R, typename Op>
+class ArrayBinary: public ArrayExpr<ArrayBinary<L, R, Op>>{
+public:
+    ArrayBinary(const L& _left, const R& _right): left(_left), right(_right){
+#ifdef RANGE_CHECKING
+        if(left.size() && right.size() && left.size() != right.size())
+            throw("array expression on arrays of different sizes");
+#endif
+    }
+    double operator[](unsigned long i) const {return Op::apply(left[i], right[i]);}
+    unsigned long size() const {return left.size() ? left.size() : right.size();}
+private:
+    typename ArrayOperand<L>::type left;
+    typename ArrayOperand<R>::type right;
+};
+
+template<typename E>
+class ArrayNegate: public ArrayExpr<ArrayNegate<E>>{
+public:
+    explicit ArrayNegate(const E& _operand): operand(_operand){}
+    double operator[](unsigned long i) const {return -operand[i];}
+    unsigned long size() const {return operand.size();}
+private:
+    typename ArrayOperand<E>::type operand;
+};
+
+struct ArrayAdd{static double apply(double a, double b){return a + b;}};
+struct ArraySubtract{static double apply(double a, double b){return a - b;}};
+struct ArrayMultiply{static double apply(double a, double b){return a * b;}};
+struct ArrayDivide{static double apply(double a, double b){return a / b;}};
+
+
+class MJArray: public ArrayExpr<MJArray>{
 public:
     explicit MJArray(unsigned long size=0);
     // copy
@@ -25,11 +87,17 @@ public:
     MJArray& operator=(const MJArray& rhs);
     
     // move
-    MJArray(MJArray&& rhs);
-    MJArray& operator=(MJArray&& rhs);
+    MJArray(MJArray&& rhs) noexcept;
+    MJArray& operator=(MJArray&& rhs) noexcept;
+    
+    // evaluate an expression
+    template<typename E>
+    MJArray(const ArrayExpr<E>& expr);
+    template<typename E>
+    MJArray& operator=(const ArrayExpr<E>& expr);
     
     // destructor
-    ~MJArray(){delete[] valptr;}
+    ~MJArray();
     
     MJArray& operator=(const double& val); // assign equal value for each element
     // arithmetic operations
@@ -43,27 +111,44 @@ public:
     MJArray& operator/=(const double& operand);
     MJArray& operator*=(const double& operand);
     
+    template<typename E> MJArray& operator+=(const ArrayExpr<E>& expr){return compound<ArrayAdd>(expr.self());}
+    template<typename E> MJArray& operator-=(const ArrayExpr<E>& expr){return compound<ArraySubtract>(expr.self());}
+    template<typename E> MJArray& operator*=(const ArrayExpr<E>& expr){return compound<ArrayMultiply>(expr.self());}
+    template<typename E> MJArray& operator/=(const ArrayExpr<E>& expr){return compound<ArrayDivide>(expr.self());}
+    
     // element-wise operation
     MJArray apply(double f(double)) const;
     
     // accessors
     inline double operator[](unsigned long i) const;
     inline double& operator[](unsigned long i);
+    double* data() {return valptr;}
+    const double* data() const {return valptr;}
     
     unsigned long size() const {return sz;}
-    void resize(unsigned long new_size);
+    void resize(unsigned long new_size); // contents are not kept when the array grows
     
     // common functions on array
     double sum() const;
     double min() const;
     double max() const;
     
+    // arrays up to SMALL_SIZE live in the object itself, larger ones on the heap aligned to ALIGNMENT bytes
+    static const unsigned long SMALL_SIZE = 8;
+    static const unsigned long ALIGNMENT = 64;
+    
 private:
+    bool on_heap() const {return valptr != local;}
+    void allocate(unsigned long new_capacity); // drops the current contents
+    template<typename Op, typename E>
+    MJArray& compound(const E& expr);
+    
     // invariance to keep: sz <= capacity && sz == endptr - valptr;
     double* valptr;
     double* endptr;
     unsigned long sz;
     unsigned long capacity;
+    double local[SMALL_SIZE];
 };
 
 inline double MJArray::operator[](unsigned long i) const
@@ -82,5 +167,65 @@ inline double& MJArray::operator[](unsigned long i)
     return valptr[i];
 }
 
+template<typename E>
+MJArray::MJArray(const ArrayExpr<E>& expr): MJArray(expr.self().size())
+{
+    const E& e = expr.self();
+    for(unsigned long i=0; i<sz; ++i)
+        valptr[i] = e[i];
+}
+
+template<typename E>
+MJArray& MJArray::operator=(const ArrayExpr<E>& expr)
+{
+    const E& e = expr.self();
+    unsigned long n = e.size();
+    if(n > capacity){
+        // the expression may refer to this array, evaluate before giving up the storage
+        MJArray tmp(expr);
+        return *this = std::move(tmp);
+    }
+    // element i of the expression only reads element i of its arrays, this array may appear on the right
+    for(unsigned long i=0; i<n; ++i)
+        valptr[i] = e[i];
+    sz = n;
+    endptr = valptr + sz;
+    return *this;
+}
+
+template<typename Op, typename E>
+MJArray& MJArray::compound(const E& expr)
+{
+#ifdef RANGE_CHECKING
+    if(expr.size() && sz != expr.size())
+        throw("to apply compound assignment the array and expression must be of same size");
+#endif
+    for(unsigned long i=0; i<sz; ++i)
+        valptr[i] = Op::apply(valptr[i], expr[i]);
+    return *this;
+}
+
+// operators building expressions, between two expressions/arrays, or an expression/array and a scalar
+#define MJARRAY_BINARY_OPERATOR(OP, NODE) \
+template<typename L, typename R> \
+inline ArrayBinary<L, R, NODE> operator OP(const ArrayExpr<L>& l, const ArrayExpr<R>& r) \
+{return ArrayBinary<L, R, NODE>(l.self(), r.self());} \
+template<typename L> \
+inline ArrayBinary<L, ArrayScalar, NODE> operator OP(const ArrayExpr<L>& l, double r) \
+{return ArrayBinary<L, ArrayScalar, NODE>(l.self(), ArrayScalar(r));} \
+template<typename R> \
+inline ArrayBinary<ArrayScalar, R, NODE> operator OP(double l, const ArrayExpr<R>& r) \
+{return ArrayBinary<ArrayScalar, R, NODE>(ArrayScalar(l), r.self());}
+
+MJARRAY_BINARY_OPERATOR(+, ArrayAdd)
+MJARRAY_BINARY_OPERATOR(-, ArraySubtract)
+MJARRAY_BINARY_OPERATOR(*, ArrayMultiply)
+MJARRAY_BINARY_OPERATOR(/, ArrayDivide)
+
+#undef MJARRAY_BINARY_OPERATOR
+
+template<typename E>
+inline ArrayNegate<E> operator-(const ArrayExpr<E>& e) {return ArrayNegate<E>(e.self());}
+
 #endif /*USE_VAL_ARRAY*/
 #endif /* mjarray_hpp */
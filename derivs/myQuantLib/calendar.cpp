@@ -6,6 +6,7 @@
 //
 
 #include "calendar.hpp"
+#include <algorithm>
 
 namespace myQuantLib {
 
@@ -60,25 +61,61 @@ std::ostream& operator<<(std::ostream& out, DateGeneration::Rule r) {
 
 
 
-void Calendar::add_holiday(const Date& d) {
-    myQL_REQUIRE(_impl, "no calendar implementation provided");
-    
-    const Date& _d = d;
+Calendar::BizDayTable::BizDayTable(const Impl& impl)
+: _first(Date::min_date().serial_number()) {
+    Date::serial_type days = Date::max_date().serial_number() - _first + 1;
+    std::size_t words = days / 64 + 1;
+    _bits.assign(words, 0);
+    _counts.assign(words + 1, 0);
+    for(Date::serial_type i=0; i<days; ++i)
+        if(impl.is_biz_day_with_holidays(Date(_first + i)))
+            _bits[i >> 6] |= std::uint64_t(1) << (i & 63);
+    for(std::size_t w=0; w<words; ++w)
+        _counts[w+1] = _counts[w] + __builtin_popcountll(_bits[w]);
+}
+
+Date::serial_type Calendar::BizDayTable::select(Date::serial_type r) const {
+    // last word with fewer than r + 1 business days before it
+    std::size_t w = std::upper_bound(_counts.begin(), _counts.end(), r) - _counts.begin() - 1;
+    std::uint64_t word = _bits[w];
+    for(Date::serial_type k = r - _counts[w]; k > 0; --k)
+        word &= word - 1; // clear the lowest business day
+    return _first + Date::serial_type(w * 64) + __builtin_ctzll(word);
+}
+
+bool Calendar::Impl::is_biz_day_locked(const Date& d) const {
+    std::lock_guard<std::mutex> lock(_table_mutex);
+    return is_biz_day_with_holidays(d);
+}
+
+void Calendar::Impl::add_holiday(const Date& d) {
+    std::lock_guard<std::mutex> lock(_table_mutex);
     // if d was a genuine holiday previously removed, revert the change
-    _impl->removed_holidays.erase(_d);
+    removed_holidays.erase(d);
     // if it's already a holiday, leave the calendar alone.
     // Otherwise, add it
-    if(_impl->is_biz_day(_d))
-        _impl->added_holidays.insert(_d);
+    if(is_biz_day(d))
+        added_holidays.insert(d);
+    std::atomic_store(&_table, std::shared_ptr<const BizDayTable>());
+}
+
+void Calendar::Impl::remove_holiday(const Date& d) {
+    std::lock_guard<std::mutex> lock(_table_mutex);
+    added_holidays.erase(d);
+    if(!is_biz_day(d))
+        removed_holidays.insert(d);
+    std::atomic_store(&_table, std::shared_ptr<const BizDayTable>());
+}
+
+
+void Calendar::add_holiday(const Date& d) {
+    myQL_REQUIRE(_impl, "no calendar implementation provided");
+    _impl->add_holiday(d);
 }
 
 void Calendar::remove_holiday(const Date& d){
     myQL_REQUIRE(_impl, "no calendar implementation provided");
-    
-    const Date& _d = d;
-    _impl->added_holidays.erase(_d);
-    if(!_impl->is_biz_day(_d))
-        _impl->removed_holidays.insert(_d);
+    _impl->remove_holiday(d);
 }
 
 Date Calendar::adjust(const Date& d,
@@ -133,23 +170,15 @@ Date Calendar::advance(const Date& d, int n, TimeUnit unit,
     if (n==0){
         return adjust(d, c);
     } else if (unit == Days){
-        Date d1 = d;
-        if(n>0){
-            while(n>0){
-                ++d1;
-                while(is_holiday(d1))
-                    ++d1;
-                --n;
-            }
-        } else {
-            while(n<0){
-                --d1;
-                while(is_holiday(d1))
-                    --d1;
-                ++n;
-            }
-        }
-        return d1;
+        // the n-th business day after (before) d from the business days up to d (before d)
+        myQL_REQUIRE(_impl, "no calendar implementation provided");
+        myQL_REQUIRE(BizDayTable::covers(d.serial_number()), d << " outside the date range");
+        std::shared_ptr<const BizDayTable> table = _impl->table();
+        Date::serial_type r = n > 0 ? table->rank(d.serial_number() + 1) + n - 1
+                                    : table->rank(d.serial_number()) + n;
+        myQL_REQUIRE(r >= 0 && r < table->total(),
+                     "advancing " << d << " by " << n << " business days leaves the date range");
+        return Date(table->select(r));
     } else if (unit == Weeks){
         Date d1 = d + n * unit;
         return adjust(d1, c);
@@ -172,20 +201,15 @@ Date::serial_type Calendar::bizdays_between(const Date& from, const Date& to,
                                             bool include_first, bool include_last) const {
     Date::serial_type wd = 0;
     if(from != to){
-        if(from < to){
-            // the last one is treated separately to avoid incrementing Date::max_date()
-            for (Date d = from; d < to ; ++d){
-                if (is_biz_day(d)) ++wd;
-            }
-            if(is_biz_day(to)) ++wd;
-        } else if (from > to){
-            for (Date d = to; d<from; ++d){
-                if(is_biz_day(d)) ++wd;
-            }
-            if(is_biz_day(from)) ++wd;
-        }
-        if(is_biz_day(from) && !include_first) --wd;
-        if(is_biz_day(to) && !include_last) --wd;
+        // business days in [min(from, to), max(from, to)]
+        myQL_REQUIRE(_impl, "no calendar implementation provided");
+        Date::serial_type lo = std::min(from, to).serial_number(), hi = std::max(from, to).serial_number();
+        myQL_REQUIRE(BizDayTable::covers(lo) && BizDayTable::covers(hi),
+                     "counting business days from " << from << " to " << to << " outside the date range");
+        std::shared_ptr<const BizDayTable> table = _impl->table();
+        wd = table->rank(hi + 1) - table->rank(lo);
+        if(table->is_biz_day(from.serial_number()) && !include_first) --wd;
+        if(table->is_biz_day(to.serial_number()) && !include_last) --wd;
         
         if(from > to) wd = -wd;
     }else if (include_first && include_last && is_biz_day(from)){
@@ -283,10 +307,15 @@ std::vector<Date> Calendar::holiday_list(const Date& from, const Date& to,
     myQL_REQUIRE(to>=from,
                  "'from' date (" << from << ") must be equal to or earlier than 'to' date ("
                  << to << ")");
+    myQL_REQUIRE(_impl, "no calendar implementation provided");
+    myQL_REQUIRE(BizDayTable::covers(from.serial_number()) && BizDayTable::covers(to.serial_number()),
+                 "listing from " << from << " to " << to << " outside the date range");
+    std::shared_ptr<const BizDayTable> table = _impl->table();
     std::vector<Date> result;
-    for(Date d = from; d <= to; ++d){
-        if(is_holiday(d) && (include_weekends || !is_weekend(d.weekday())))
-            result.push_back(d);
+    result.reserve((to - from + 1) - (table->rank(to.serial_number() + 1) - table->rank(from.serial_number())));
+    for(Date::serial_type s = from.serial_number(); s <= to.serial_number(); ++s){
+        if(!table->is_biz_day(s) && (include_weekends || !is_weekend(Date(s).weekday())))
+            result.push_back(Date(s));
     }
     return result;
 }
@@ -295,10 +324,15 @@ std::vector<Date> Calendar::bizday_list(const Date& from, const Date& to) const
     myQL_REQUIRE(to>=from,
                  "'from' date (" << from << ") must be equal to or earlier than 'to' date ("
                  << to << ")");
+    myQL_REQUIRE(_impl, "no calendar implementation provided");
+    myQL_REQUIRE(BizDayTable::covers(from.serial_number()) && BizDayTable::covers(to.serial_number()),
+                 "listing from " << from << " to " << to << " outside the date range");
+    std::shared_ptr<const BizDayTable> table = _impl->table();
     std::vector<Date> result;
-    for(Date d = from; d <= to; ++d){
-        if(is_biz_day(d))
-            result.push_back(d);
+    result.reserve(table->rank(to.serial_number() + 1) - table->rank(from.serial_number()));
+    for(Date::serial_type s = from.serial_number(); s <= to.serial_number(); ++s){
+        if(table->is_biz_day(s))
+            result.push_back(Date(s));
     }
     return result;
 }
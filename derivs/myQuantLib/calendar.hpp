@@ -14,6 +14,8 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <mutex>
+#include <cstdint>
 
 namespace myQuantLib {
 
@@ -99,6 +101,38 @@ class Period;
 
 class Calendar {
 protected:
+    class Impl;
+    
+    /*business days of the whole Date range as a bitmap, and the number of business days before each 64-day word:
+     is_biz_day is a bit test, counting business days (rank) is a lookup and a popcount,
+     finding the n-th business day (select) is a binary search over the 1707 words and a scan of one word.
+     it is immutable once built, so any thread can read it
+     */
+    class BizDayTable {
+    public:
+        explicit BizDayTable(const Impl& impl);
+        static bool covers(Date::serial_type s) {
+            return s >= Date::min_date().serial_number() && s <= Date::max_date().serial_number();
+        }
+        bool is_biz_day(Date::serial_type s) const {
+            s -= _first;
+            return (_bits[s >> 6] >> (s & 63)) & 1;
+        }
+        // number of business days from min_date up to s, s excluded, s may be max_date + 1
+        Date::serial_type rank(Date::serial_type s) const {
+            s -= _first;
+            std::uint64_t word = _bits[s >> 6] & ((std::uint64_t(1) << (s & 63)) - 1);
+            return _counts[s >> 6] + __builtin_popcountll(word);
+        }
+        // the business day with r business days before it, r < total()
+        Date::serial_type select(Date::serial_type r) const;
+        Date::serial_type total() const {return _counts.back();}
+    private:
+        Date::serial_type _first;
+        std::vector<std::uint64_t> _bits;       // one more word than needed, so rank(max_date + 1) reads inside
+        std::vector<Date::serial_type> _counts; // business days before each word, one more entry for the total
+    };
+    
     class Impl {
         // core function of Calendar impl is to identify holiday and business day
     public:
@@ -107,6 +141,20 @@ protected:
         virtual bool is_biz_day(const Date&) const = 0;
         virtual bool is_weekend(Weekday) const=0;
         std::set<Date> added_holidays, removed_holidays;
+        
+        // the rules with the added and removed holidays, what the table records
+        bool is_biz_day_with_holidays(const Date& d) const;
+        // as above, under the lock of the holiday changes, for the dates the table does not cover
+        bool is_biz_day_locked(const Date& d) const;
+        // built on first use by any Calendar sharing this Impl, a reader keeps its table alive,
+        // a table replaced by a holiday change goes when its last reader drops it
+        std::shared_ptr<const BizDayTable> table() const;
+        // change the added and removed holidays under the lock that builds the table, and drop the table
+        void add_holiday(const Date& d);
+        void remove_holiday(const Date& d);
+    private:
+        mutable std::shared_ptr<const BizDayTable> _table; // accessed with std::atomic_load and std::atomic_store
+        mutable std::mutex _table_mutex;
     };
     std::shared_ptr<Impl> _impl;
 public:
@@ -182,17 +230,35 @@ inline const std::set<Date>& Calendar::removed_holidays() const {
     return _impl->removed_holidays;
 }
 
-inline bool Calendar::is_biz_day(const Date& d) const {
-    myQL_REQUIRE(_impl, "no calendar implementation provided");
-    const Date& _d = d;
-    if(!_impl->added_holidays.empty() &&
-       _impl->added_holidays.find(_d) != _impl->added_holidays.end())
+inline bool Calendar::Impl::is_biz_day_with_holidays(const Date& d) const {
+    if(!added_holidays.empty() &&
+       added_holidays.find(d) != added_holidays.end())
         return false; // find d in holidays
-    if(!_impl->removed_holidays.empty() &&
-       _impl->removed_holidays.find(_d) != _impl->removed_holidays.end())
+    if(!removed_holidays.empty() &&
+       removed_holidays.find(d) != removed_holidays.end())
         return true; // find d in removed holidays, it was a holiday, but it is not now
     
-    return _impl->is_biz_day(_d);
+    return is_biz_day(d);
+}
+
+inline std::shared_ptr<const Calendar::BizDayTable> Calendar::Impl::table() const {
+    std::shared_ptr<const BizDayTable> t = std::atomic_load(&_table);
+    if(t)
+        return t;
+    std::lock_guard<std::mutex> lock(_table_mutex);
+    t = std::atomic_load(&_table);
+    if(!t){
+        t = std::make_shared<const BizDayTable>(*this);
+        std::atomic_store(&_table, t);
+    }
+    return t;
+}
+
+inline bool Calendar::is_biz_day(const Date& d) const {
+    myQL_REQUIRE(_impl, "no calendar implementation provided");
+    if(!BizDayTable::covers(d.serial_number()))
+        return _impl->is_biz_day_locked(d); // null date
+    return _impl->table()->is_biz_day(d.serial_number());
 }
 
 inline bool Calendar::is_end_of_month(const Date& d) const {
@@ -8,73 +8,14 @@
 #include "date.hpp"
 #include "errors.hpp"
 #include <ctime>
+#include <cstring>
 #include <boost/functional/hash.hpp>
 
 namespace myQuantLib {
 // _serial_number = 1 -> Jan 1st 1900, keep a total number of days starting Jan 1st 1900
 // constructors
-Date::Date(Date::serial_type serial_number): _serial_number(serial_number){
-    check_serial_number(serial_number);
-}
+Date::Date(const std::string& date_str): _serial_number(parse(date_str).serial_number()) {}
 
-Date::Date(Day d, Month m, Year y){
-    // check year
-    myQL_REQUIRE(y > 1900 && y < 2200,
-                 "year " << y << " out of bound. It must be in [1901, 2199]");
-    // check month
-    myQL_REQUIRE(int(m) > 0 && int(m) < 13,
-                 "month " << int(m) << " outside Jan-Dec range [1, 12]");
-    // check day
-    bool leap = is_leap(y);
-    Day len = month_len(m, leap), offset = month_offset(m, leap);
-    myQL_REQUIRE(d <= len && d > 0,
-                 "day outside month (" << int(m) << ") day-range "
-                 << "[1," << len << "]");
-    // serial_number = day + month_offset + year_offset
-    _serial_number = d + offset + year_offset(y);
-}
-
-Date::Date(const std::string& date_str) {
-    // assume format yyyy-m-d
-    std::string delimiter = "-";
-    std::size_t beg_pos = 0, end_pos=0;
-    // find year
-    end_pos = date_str.find(delimiter, beg_pos);
-    Year y = std::stoi(date_str.substr(beg_pos, end_pos-beg_pos));
-    // find month
-    beg_pos = end_pos + 1;
-    end_pos = date_str.find(delimiter, beg_pos);
-    Month m = Month(std::stoi(date_str.substr(beg_pos, end_pos-beg_pos)));
-    // find day
-    beg_pos = end_pos + 1;
-    Day d = std::stoi(date_str.substr(beg_pos));
-    // create an instance, checking and use its _serial_number
-    Date tmp(d, m, y);
-    _serial_number = tmp.serial_number();
-}
-
-
-// inspectors
-Month Date::month() const {
-    Day d = day_of_year();
-    // find m that month_offset(m) < d <= month_offset(m+1)
-    int m = d/30 + 1; // initial guess
-    // correct for m
-    bool leap = is_leap(year());
-    while (d <= month_offset(Month(m), leap))
-        --m;
-    while (d > month_offset(Month(m+1), leap))
-        ++m;
-    return Month(m);
-}
-
-Year Date::year() const {
-    Year y = (_serial_number / 365) + 1900;
-    // if it is in current year y, then _serial_number > year_offset(y)
-    if (_serial_number <= year_offset(y))
-        --y;
-    return y;
-}
 
 Date& Date::operator+=(Date::serial_type days){
     Date::serial_type serial = _serial_number + days;
@@ -268,6 +209,20 @@ std::ostream& operator<<(std::ostream& out, const Weekday& wd) {
 
 
 // helper functions
+void Date::check_day_month_year(Day d, Month m, Year y){
+    // check year
+    myQL_REQUIRE(y > 1900 && y < 2200,
+                 "year " << y << " out of bound. It must be in [1901, 2199]");
+    // check month
+    myQL_REQUIRE(int(m) > 0 && int(m) < 13,
+                 "month " << int(m) << " outside Jan-Dec range [1, 12]");
+    // check day
+    Day len = month_len(m, leap(y));
+    myQL_REQUIRE(d <= len && d > 0,
+                 "day outside month (" << int(m) << ") day-range "
+                 << "[1," << len << "]");
+}
+
 void Date::check_serial_number(Date::serial_type serial_number){
     myQL_REQUIRE(serial_number >= min_serial_number() &&
                  serial_number <= max_serial_number(),
@@ -276,168 +231,95 @@ void Date::check_serial_number(Date::serial_type serial_number){
                  );
 }
 
-// compute once and store the result
 bool Date::is_leap(Year y) {
-    static const bool year_is_leap[] = {
-        // 1900 - 1909
-        false,false,false,false,true,false,false,false,true,false,
-        // 1910-1919
-        false,false, true,false,false,false, true,false,false,false,
-        // 1920-1929
-         true,false,false,false, true,false,false,false, true,false,
-        // 1930-1939
-        false,false, true,false,false,false, true,false,false,false,
-        // 1940-1949
-         true,false,false,false, true,false,false,false, true,false,
-        // 1950-1959
-        false,false, true,false,false,false, true,false,false,false,
-        // 1960-1969
-         true,false,false,false, true,false,false,false, true,false,
-        // 1970-1979
-        false,false, true,false,false,false, true,false,false,false,
-        // 1980-1989
-         true,false,false,false, true,false,false,false, true,false,
-        // 1990-1999
-        false,false, true,false,false,false, true,false,false,false,
-        // 2000-2009
-         true,false,false,false, true,false,false,false, true,false,
-        // 2010-2019
-        false,false, true,false,false,false, true,false,false,false,
-        // 2020-2029
-         true,false,false,false, true,false,false,false, true,false,
-        // 2030-2039
-        false,false, true,false,false,false, true,false,false,false,
-        // 2040-2049
-         true,false,false,false, true,false,false,false, true,false,
-        // 2050-2059
-        false,false, true,false,false,false, true,false,false,false,
-        // 2060-2069
-         true,false,false,false, true,false,false,false, true,false,
-        // 2070-2079
-        false,false, true,false,false,false, true,false,false,false,
-        // 2080-2089
-         true,false,false,false, true,false,false,false, true,false,
-        // 2090-2099
-        false,false, true,false,false,false, true,false,false,false,
-        // 2100-2109
-        false,false,false,false, true,false,false,false, true,false,
-        // 2110-2119
-        false,false, true,false,false,false, true,false,false,false,
-        // 2120-2129
-         true,false,false,false, true,false,false,false, true,false,
-        // 2130-2139
-        false,false, true,false,false,false, true,false,false,false,
-        // 2140-2149
-         true,false,false,false, true,false,false,false, true,false,
-        // 2150-2159
-        false,false, true,false,false,false, true,false,false,false,
-        // 2160-2169
-         true,false,false,false, true,false,false,false, true,false,
-        // 2170-2179
-        false,false, true,false,false,false, true,false,false,false,
-        // 2180-2189
-         true,false,false,false, true,false,false,false, true,false,
-        // 2190-2199
-        false,false, true,false,false,false, true,false,false,false,
-        // 2200
-        false
-    };
     myQL_REQUIRE(y>=1900 && y<=2200, "year outside valid range");
-    return year_is_leap[y-1900];
+    return leap(y);
+}
+
+
+namespace {
+
+// blanks around [p, last), and the carriage return of a windows line end, are dropped
+void trim(const char*& p, const char*& last) {
+    while(p != last && (*p == ' ' || *p == '\t'))
+        ++p;
+    while(last != p && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+        --last;
+}
+
+// the fields of a trimmed numeric date in the given order, false if it is not one;
+// the year has 4 digits, the month and the day 1 or 2, or exactly 2 without separators
+bool parse_fields(const char* p, const char* last, DateOrder order, Day& d, Month& m, Year& y) {
+    const int year_pos = order == YMD ? 0 : 2;
+    int fields[3] = {0, 0, 0};
+    // the separator follows the first field, none for yyyymmdd and the like
+    const char* after_first = last - p > 4 ? p + (year_pos == 0 ? 4 : 1) : last;
+    while(after_first < last && (unsigned)(*after_first - '0') < 10u)
+        ++after_first;
+    char sep = after_first < last ? *after_first : 0;
+    if(sep != 0 && sep != '-' && sep != '/' && sep != '.')
+        return false;
+    for(int i=0; i<3; ++i){
+        if(i > 0 && sep != 0){
+            if(p == last || *p != sep)
+                return false;
+            ++p;
+        }
+        int max_digits = i == year_pos ? 4 : 2;
+        const char* first = p;
+        for(; p != last && p - first < max_digits && (unsigned)(*p - '0') < 10u; ++p)
+            fields[i] = fields[i] * 10 + (*p - '0');
+        long digits = p - first;
+        if(digits == 0 || (i == year_pos && digits != 4) || (sep == 0 && digits != max_digits))
+            return false;
+    }
+    if(p != last)
+        return false;
+    y = fields[year_pos];
+    m = Month(fields[order == MDY ? 0 : 1]);
+    d = fields[order == DMY ? 0 : (order == MDY ? 1 : 2)];
+    return true;
 }
 
-int Date::month_len(Month m, bool leap_year){
-    static const int month_len[] = {
-        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
-    };
-    static const int month_leap_len[] = {
-        31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
-    };
-    return leap_year? month_leap_len[m-1] : month_len[m-1];
 }
 
-int Date::month_offset(Month m, bool leap_year){
-    static const int month_offset[] = {
-        0,  31,  59,  90, 120, 151, // Jan - Jun
-      181, 212, 243, 273, 304, 334, // Jun - Dec
-      365   // used in day_of_month to bracket day
-    };
-    static const int month_leap_offset[] = {
-        0,  31,  60,  91, 121, 152, // Jan - Jun
-      182, 213, 244, 274, 305, 335, // Jun - Dec
-      366   // used in day_of_month to bracket day
-    };
-    return leap_year? month_leap_offset[m-1] : month_offset[m-1];
+Date Date::parse(std::string_view date_str, DateOrder order) {
+    const char* p = date_str.data();
+    const char* last = p + date_str.size();
+    trim(p, last);
+    Day d = 0;
+    Month m = January;
+    Year y = 0;
+    myQL_REQUIRE(parse_fields(p, last, order, d, m, y),
+                 "cannot parse \"" << date_str << "\" as a date");
+    return Date(d, m, y);
 }
 
-Date::serial_type Date::year_offset(Year y){
-    // the list of all December 31st in the preceding year
-    // year_offset(1901) = year_offset[1] = 365, Dec 31 1900
-    static const Date::serial_type year_offset[] = {
-        // 1900-1909
-            0,   365,   730,  1095,  1460,  1826,  2191,  2556,  2921,  3287,
-        // 1910-1919
-          3652,  4017,  4382,  4748,  5113,  5478,  5843,  6209,  6574,  6939,
-        // 1920-1929
-          7304,  7670,  8035,  8400,  8765,  9131,  9496,  9861, 10226, 10592,
-        // 1930-1939
-         10957, 11322, 11687, 12053, 12418, 12783, 13148, 13514, 13879, 14244,
-        // 1940-1949
-         14609, 14975, 15340, 15705, 16070, 16436, 16801, 17166, 17531, 17897,
-        // 1950-1959
-         18262, 18627, 18992, 19358, 19723, 20088, 20453, 20819, 21184, 21549,
-        // 1960-1969
-         21914, 22280, 22645, 23010, 23375, 23741, 24106, 24471, 24836, 25202,
-        // 1970-1979
-         25567, 25932, 26297, 26663, 27028, 27393, 27758, 28124, 28489, 28854,
-        // 1980-1989
-         29219, 29585, 29950, 30315, 30680, 31046, 31411, 31776, 32141, 32507,
-        // 1990-1999
-         32872, 33237, 33602, 33968, 34333, 34698, 35063, 35429, 35794, 36159,
-        // 2000-2009
-         36524, 36890, 37255, 37620, 37985, 38351, 38716, 39081, 39446, 39812,
-        // 2010-2019
-         40177, 40542, 40907, 41273, 41638, 42003, 42368, 42734, 43099, 43464,
-        // 2020-2029
-         43829, 44195, 44560, 44925, 45290, 45656, 46021, 46386, 46751, 47117,
-        // 2030-2039
-         47482, 47847, 48212, 48578, 48943, 49308, 49673, 50039, 50404, 50769,
-        // 2040-2049
-         51134, 51500, 51865, 52230, 52595, 52961, 53326, 53691, 54056, 54422,
-        // 2050-2059
-         54787, 55152, 55517, 55883, 56248, 56613, 56978, 57344, 57709, 58074,
-        // 2060-2069
-         58439, 58805, 59170, 59535, 59900, 60266, 60631, 60996, 61361, 61727,
-        // 2070-2079
-         62092, 62457, 62822, 63188, 63553, 63918, 64283, 64649, 65014, 65379,
-        // 2080-2089
-         65744, 66110, 66475, 66840, 67205, 67571, 67936, 68301, 68666, 69032,
-        // 2090-2099
-         69397, 69762, 70127, 70493, 70858, 71223, 71588, 71954, 72319, 72684,
-        // 2100-2109
-         73049, 73414, 73779, 74144, 74509, 74875, 75240, 75605, 75970, 76336,
-        // 2110-2119
-         76701, 77066, 77431, 77797, 78162, 78527, 78892, 79258, 79623, 79988,
-        // 2120-2129
-         80353, 80719, 81084, 81449, 81814, 82180, 82545, 82910, 83275, 83641,
-        // 2130-2139
-         84006, 84371, 84736, 85102, 85467, 85832, 86197, 86563, 86928, 87293,
-        // 2140-2149
-         87658, 88024, 88389, 88754, 89119, 89485, 89850, 90215, 90580, 90946,
-        // 2150-2159
-         91311, 91676, 92041, 92407, 92772, 93137, 93502, 93868, 94233, 94598,
-        // 2160-2169
-         94963, 95329, 95694, 96059, 96424, 96790, 97155, 97520, 97885, 98251,
-        // 2170-2179
-         98616, 98981, 99346, 99712,100077,100442,100807,101173,101538,101903,
-        // 2180-2189
-        102268,102634,102999,103364,103729,104095,104460,104825,105190,105556,
-        // 2190-2199
-        105921,106286,106651,107017,107382,107747,108112,108478,108843,109208,
-        // 2200
-        109573,
-    };
-    return year_offset[y-1900];
+std::size_t Date::parse_column(std::string_view buffer, std::vector<Date>& dates, DateOrder order) {
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+    std::size_t line = 0, n = 0;
+    while(p != end){
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if(eol == nullptr)
+            eol = end;
+        ++line;
+        const char* first = p;
+        const char* last = eol;
+        trim(first, last);
+        if(first != last){
+            Day d = 0;
+            Month m = January;
+            Year y = 0;
+            myQL_REQUIRE(parse_fields(first, last, order, d, m, y),
+                         "cannot parse line " << line << " (\"" << std::string_view(first, last - first)
+                         << "\") as a date");
+            dates.push_back(Date(d, m, y));
+            ++n;
+        }
+        p = eol == end ? end : eol + 1;
+    }
+    return n;
 }
 
 
@@ -11,6 +11,9 @@
 #include <iostream>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
 #include "period.hpp"
 
 namespace myQuantLib{
@@ -64,23 +67,31 @@ std::ostream& operator<<(std::ostream&, Month);
 typedef int Day;
 typedef int Year;
 
+// order of the fields of a numeric date, whatever the separator
+enum DateOrder {
+    YMD, // 2022-04-15, 2022/4/15, 20220415
+    DMY, // 15/04/2022, 15.4.2022, 15042022
+    MDY  // 04/15/2022, 04152022
+};
+
 class Date{
 public:
     typedef int serial_type;
-    Date(): _serial_number(Date::serial_type(0)){} // default
+    constexpr Date(): _serial_number(Date::serial_type(0)){} // default
     
-    explicit Date(Date::serial_type serial_number);
-    Date(Day d, Month m, Year y);
+    explicit constexpr Date(Date::serial_type serial_number);
+    constexpr Date(Day d, Month m, Year y);
+    // yyyy-m-d, see parse
     Date(const std::string& date_str);
     
-    // inspectors
-    Weekday weekday() const;
-    Day day_of_month() const;
+    // inspectors, the year is one division and one comparison, month and day one lookup in a day of year table
+    constexpr Weekday weekday() const;
+    constexpr Day day_of_month() const;
     // Jan 1st = 1
-    Day day_of_year() const;
-    Month month() const;
-    Year year() const;
-    Date::serial_type serial_number() const;
+    constexpr Day day_of_year() const;
+    constexpr Month month() const;
+    constexpr Year year() const;
+    constexpr Date::serial_type serial_number() const;
     
     // date arithmetic
     Date& operator+=(Date::serial_type days);
@@ -99,37 +110,99 @@ public:
     
     // static methods
     static Date today();
-    static Date min_date(){
-        static const Date d(min_serial_number());
-        return d;
-    }
-    static Date max_date(){
-        static const Date d(max_serial_number());
-        return d;
-    }
+    static constexpr Date min_date(){return Date(min_serial_number());}
+    static constexpr Date max_date(){return Date(max_serial_number());}
     static bool is_leap(Year y);
-    static Date end_of_month(const Date& d);
-    static bool is_end_of_month(const Date& d);
+    static constexpr Date end_of_month(const Date& d);
+    static constexpr bool is_end_of_month(const Date& d);
     // next given weekday following or equal to the given date
     // E.g, the Friday following Tuesday, January 15th 2002 was January 18th, 2002
     static Date next_weekday(const Date& d, Weekday w);
     // n-th given weekday in the given month and year
     // e.g., 4th Thursday of March, 1998 was March 26th, 1998
     static Date nth_weekday(std::size_t n, Weekday w, Month m, Year y);
+    
+    // parsing without allocating, blanks around the date are skipped
+    // a numeric date with its fields in the given order, separated by one of - / . or not separated at all
+    static Date parse(std::string_view date_str, DateOrder order = YMD);
+    // appends the dates of a buffer holding one date per line, e.g. a column of a file read in memory,
+    // blank lines are skipped; returns the number of dates appended
+    static std::size_t parse_column(std::string_view buffer, std::vector<Date>& dates, DateOrder order = YMD);
 private:
     // static members and methods, only _serial_number is instance specific
-    static Date::serial_type min_serial_number(){return 366;} //Jan 1st, 1901
-    static Date::serial_type max_serial_number(){return 109573;} // Dec 31st, 2199
+    static constexpr Date::serial_type min_serial_number(){return 366;} //Jan 1st, 1901
+    static constexpr Date::serial_type max_serial_number(){return 109573;} // Dec 31st, 2199
     static void check_serial_number(Date::serial_type serial_number);
+    static void check_day_month_year(Day d, Month m, Year y);
     
     Date::serial_type _serial_number;
     static Date advance(const Date& d, int units, TimeUnit);
-    static int month_len(Month m, bool leap_year);
-    static int month_offset(Month m, bool leap_year);
-    static Date::serial_type year_offset(Year y);
+    static constexpr bool leap(Year y){
+        return ((y % 4 == 0) & (y % 100 != 0)) | (y % 400 == 0);
+    }
+    static constexpr int month_len(Month m, bool leap_year){
+        return _month_lens[leap_year][m-1];
+    }
+    static constexpr int month_offset(Month m, bool leap_year){
+        return _month_offsets[leap_year][m-1];
+    }
+    // the December 31st of the preceding year, year_offset(1901) = 365
+    static constexpr Date::serial_type year_offset(Year y){
+        return 365 * (y - 1900) + (y - 1901) / 4 - (y > 2100);
+    }
+    static constexpr Date::serial_type serial_from(Day d, Month m, Year y);
+    
+    static constexpr int _month_lens[2][12] = {
+        {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+        {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}
+    };
+    static constexpr int _month_offsets[2][13] = {
+        {0,  31,  59,  90, 120, 151, 181, 212, 243, 273, 304, 334, 365},
+        {0,  31,  60,  91, 121, 152, 182, 213, 244, 274, 305, 335, 366}
+    };
+    
+    // day of month in bits 0-4, month in bits 5-8 and the end of month flag in bit 9, of each day of the year,
+    // for common and leap years
+    class MonthDayTable {
+    public:
+        constexpr MonthDayTable(): _entries() {
+            for(int l=0; l<2; ++l){
+                int doy = 1;
+                for(int m=1; m<=12; ++m)
+                    for(int d=1; d<=_month_lens[l][m-1]; ++d, ++doy)
+                        _entries[l][doy] = std::uint16_t(d | (m << 5) | ((d == _month_lens[l][m-1]) << 9));
+            }
+        }
+        constexpr std::uint16_t operator()(bool leap_year, Day day_of_year) const {
+            return _entries[leap_year][day_of_year];
+        }
+    private:
+        std::uint16_t _entries[2][367];
+    };
+    static const MonthDayTable _month_days;
+    constexpr std::uint16_t month_day() const {
+        Year y = year();
+        return _month_days(leap(y), _serial_number - year_offset(y));
+    }
 };
 
-inline Date::serial_type operator-(const Date& d1, const Date& d2){
+inline constexpr Date::MonthDayTable Date::_month_days{};
+
+constexpr Date::Date(Date::serial_type serial_number): _serial_number(serial_number){
+    if(serial_number < min_serial_number() || serial_number > max_serial_number())
+        check_serial_number(serial_number);
+}
+
+constexpr Date::Date(Day d, Month m, Year y): _serial_number(serial_from(d, m, y)){}
+
+constexpr Date::serial_type Date::serial_from(Day d, Month m, Year y){
+    if(!(y > 1900 && y < 2200 && int(m) > 0 && int(m) < 13 && d > 0 && d <= month_len(m, leap(y))))
+        check_day_month_year(d, m, y);
+    // serial_number = day + month_offset + year_offset
+    return d + month_offset(m, leap(y)) + year_offset(y);
+}
+
+constexpr Date::serial_type operator-(const Date& d1, const Date& d2){
     return d1.serial_number() - d2.serial_number();
 }
 
@@ -137,22 +210,22 @@ inline Date::serial_type operator-(const Date& d1, const Date& d2){
 inline double days_between(const Date& d1, const Date& d2){
     return double(d2 - d1);
 }
-inline bool operator==(const Date& d1, const Date& d2){
+constexpr bool operator==(const Date& d1, const Date& d2){
     return d1.serial_number() == d2.serial_number();
 }
-inline bool operator!=(const Date& d1, const Date& d2){
+constexpr bool operator!=(const Date& d1, const Date& d2){
     return d1.serial_number() != d2.serial_number();
 }
-inline bool operator<(const Date& d1, const Date& d2){
+constexpr bool operator<(const Date& d1, const Date& d2){
     return d1.serial_number() < d2.serial_number();
 }
-inline bool operator<=(const Date& d1, const Date& d2){
+constexpr bool operator<=(const Date& d1, const Date& d2){
     return d1.serial_number() <= d2.serial_number();
 }
-inline bool operator>(const Date& d1, const Date& d2){
+constexpr bool operator>(const Date& d1, const Date& d2){
     return d1.serial_number() > d2.serial_number();
 }
-inline bool operator>=(const Date& d1, const Date& d2){
+constexpr bool operator>=(const Date& d1, const Date& d2){
     return d1.serial_number() >= d2.serial_number();
 }
 
@@ -160,21 +233,31 @@ std::size_t hash_value(const Date& d);
 std::ostream& operator<<(std::ostream&, const Date&);
 
 // inline definitions
-inline Weekday Date::weekday() const{
+constexpr Weekday Date::weekday() const{
     //int w = _serial_number % 7;
     //return Weekday(w == 0 ? 1: w);
     return Weekday(_serial_number % 7 + 1);
 }
 
-inline Day Date::day_of_month() const{
-    return day_of_year() - month_offset(month(), is_leap(year()));
+constexpr Year Date::year() const {
+    Year y = (_serial_number / 365) + 1900;
+    // if it is in current year y, then _serial_number > year_offset(y)
+    return y - (_serial_number <= year_offset(y));
+}
+
+constexpr Month Date::month() const {
+    return Month((month_day() >> 5) & 15);
+}
+
+constexpr Day Date::day_of_month() const{
+    return month_day() & 31;
 }
 
-inline Day Date::day_of_year() const {
+constexpr Day Date::day_of_year() const {
     return _serial_number - year_offset(year());
 }
 
-inline Date::serial_type Date::serial_number() const {
+constexpr Date::serial_type Date::serial_number() const {
     return _serial_number;
 }
 
@@ -194,14 +277,14 @@ inline Date Date::operator-(const Period& p) const {
     return advance(*this, -p.length(), p.units());
 }
 
-inline Date Date::end_of_month(const Date &d) {
-    Month m = d.month();
+constexpr Date Date::end_of_month(const Date &d) {
     Year y = d.year();
-    return {month_len(m, is_leap(y)), m, y};
+    std::uint16_t md = _month_days(leap(y), d._serial_number - year_offset(y));
+    return Date(d._serial_number + month_len(Month((md >> 5) & 15), leap(y)) - (md & 31));
 }
 
-inline bool Date::is_end_of_month(const Date &d){
-    return d.day_of_month() == month_len(d.month(), is_leap(d.year()));
+constexpr bool Date::is_end_of_month(const Date &d){
+    return d.month_day() >> 9;
 }
 
 
@@ -46,7 +46,7 @@ protected:
     public:
         explicit Link(const std::shared_ptr<T>& h=std::shared_ptr<T>());
         void link_to(const std::shared_ptr<T>&);
-        const std::shared_ptr<T> current_link() const {return _h;}
+        const std::shared_ptr<T>& current_link() const {return _h;}
         bool empty() const {return _h.get() == nullptr;}
         void update() {notify_observers();} // triggered by _h->notify_observers()
     private:
@@ -65,7 +65,7 @@ public:
 
 // inline definitions
 template<class T>
-inline Handle<T>::Link::Link(const std::shared_ptr<T>& h): _h(h){link_to(_h);}
+inline Handle<T>::Link::Link(const std::shared_ptr<T>& h): _h(h){register_with(_h);} // link_to(_h) would see no change
 
 
 template<class T>
@@ -73,7 +73,7 @@ inline void Handle<T>::Link::link_to(const std::shared_ptr<T>& h){
     if(h != _h){
         if(_h) unregister_with(_h);
         _h = h;
-        register_with(_h); // Link is an observer for _h, and _h is in Link's observables list,
+        register_with(_h); // no-op when empty; Link is an observer for _h, and _h is in Link's observables list,
         notify_observers(); // Link acted as an observable, notify its observers
     }
 }
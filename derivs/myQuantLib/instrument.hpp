@@ -53,6 +53,7 @@ public:
     }
 protected:
     LazyObject(){};
+    ~LazyObject() override {detach_observer();}
     mutable bool calculated_;
     virtual void do_calculation() const = 0;
 };
@@ -35,8 +35,7 @@ double InterestRate::compound_factor(double time) const {
     }
 }
 
-InterestRate InterestRate::implied_rate(double compound,
-                                        const DayCounter& resultDC,
+double InterestRate::implied_rate_value(double compound,
                                         Compounding comp,
                                         Frequency freq,
                                         double time){
@@ -74,7 +73,15 @@ InterestRate InterestRate::implied_rate(double compound,
                 myQL_FAIL("unknown compounding convention (" << int(comp) << ")");
         }
     }
-    return InterestRate(r, resultDC, comp, freq);
+    return r;
+}
+
+InterestRate InterestRate::implied_rate(double compound,
+                                        const DayCounter& resultDC,
+                                        Compounding comp,
+                                        Frequency freq,
+                                        double time){
+    return InterestRate(implied_rate_value(compound, comp, freq, time), resultDC, comp, freq);
 }
 
 std::ostream& operator<<(std::ostream& out, const InterestRate& ir) {
@@ -92,6 +92,11 @@ public:
                                      Compounding comp,
                                      Frequency freq,
                                      double time);
+    // the rate of implied_rate(compound, resultDC, comp, freq, time), without building an InterestRate
+    static double implied_rate_value(double compound,
+                                     Compounding comp,
+                                     Frequency freq,
+                                     double time);
 
     //! implied rate for a given compound factor between two dates.
     /*! The resulting rate is calculated taking the required
@@ -49,6 +49,13 @@ protected:
         virtual bool is_in_range(double x) const = 0;
         // depending on implementation methods
         virtual double value(double x) const = 0;
+        // hint: the segment found by the previous call, O(1) when x moved to the same or the next segment
+        virtual double value(double x, std::size_t& /*hint*/) const {return value(x);}
+        virtual void values(const double* xs, std::size_t n, double* out) const {
+            std::size_t hint = 0;
+            for(std::size_t i=0; i<n; ++i)
+                out[i] = value(xs[i], hint);
+        }
         virtual double primitive(double) const = 0;
         virtual double derivative(double) const = 0;
         virtual double second_derivative(double) const = 0;
@@ -82,18 +89,18 @@ public:
             return std::vector<double>(_ybegin, _ybegin + (_xend - _xbegin));
         }
         bool is_in_range(double x) const override {
-            // check increasing order of input xvalues
-            for (I1 i = _xbegin, j = _xbegin + 1; j != _xend; ++i, ++j){
-                myQL_REQUIRE(*j > *i, "unsorted x values");
-            }
             double x1 = xmin(), x2 = xmax();
             return x >= x1 && x<= x2;
         }
         
     protected:
-        std::size_t locate(double x) const {
-            for (I1 i=_xbegin, j=_xbegin+1; j!=_xend; ++i, ++j)
+        // check increasing order of input xvalues, once per update() of the derived class rather than per lookup
+        void check_sorted() const {
+            for (I1 i = _xbegin, j = _xbegin + 1; j != _xend; ++i, ++j)
                 myQL_REQUIRE(*j > *i, "unsorted x values");
+        }
+        // segment i such that x is in [x_i, x_i+1), the first or last one outside the range
+        std::size_t locate(double x) const {
             if (x < *_xbegin)
                 return 0;
             else if (x > *(_xend - 1))
@@ -101,6 +108,22 @@ public:
             else
                 return std::upper_bound(_xbegin, _xend-1, x) - _xbegin - 1;
         }
+        // same segment as locate(x), trying the hint and the segment after it before a binary search
+        std::size_t locate(double x, std::size_t& hint) const {
+            std::size_t last = _xend - _xbegin - 2;
+            std::size_t i = std::min(hint, last);
+            if (x >= _xbegin[i]) {
+                if (i != last && x >= _xbegin[i+1]) {
+                    ++i;
+                    if (i != last && x >= _xbegin[i+1])
+                        i = std::upper_bound(_xbegin + i + 1, _xend - 1, x) - _xbegin - 1;
+                }
+            } else {
+                i = x < *_xbegin ? 0 : std::upper_bound(_xbegin, _xbegin + i, x) - _xbegin - 1;
+            }
+            hint = i;
+            return i;
+        }
         I1 _xbegin, _xend;
         I2 _ybegin;
     };
@@ -113,6 +136,20 @@ public:
         check_range(x, allow_extrapolation);
         return _impl->value(x);
     }
+    // for a sequence of nearby or increasing x, hint starts at 0 and is kept between calls
+    double operator()(double x, std::size_t& hint, bool allow_extrapolation = false) const {
+        check_range(x, allow_extrapolation);
+        return _impl->value(x, hint);
+    }
+    // out[i] = value at xs[i], one pass of the nodes when xs is increasing
+    void values(const double* xs, std::size_t n, double* out, bool allow_extrapolation = false) const {
+        if (n == 0)
+            return;
+        std::pair<const double*, const double*> range = std::minmax_element(xs, xs + n);
+        check_range(*range.first, allow_extrapolation);
+        check_range(*range.second, allow_extrapolation);
+        _impl->values(xs, n, out);
+    }
     double primitive(double x, bool allow_extrapolation = false) const {
         check_range(x, allow_extrapolation);
         return _impl->primitive(x);
@@ -18,6 +18,7 @@ public:
     // constructor, value, primitive, derivative, second_derivative
     LinearInterpolationImpl(const I1& xbegin, const I1& xend, const I2& ybegin);
     void update() override {
+        this->check_sorted();
         _primitive_const[0] = 0.0;
         for(std::size_t i=1; i < std::size_t(this->_xend - this->_xbegin); ++i){
             double dx = this->_xbegin[i] - this->_xbegin[i-1];
@@ -30,6 +31,17 @@ public:
         std::size_t i = this->locate(x);
         return this->_ybegin[i] + (x - this->_xbegin[i]) * _s[i];
     }
+    double value(double x, std::size_t& hint) const override {
+        std::size_t i = this->locate(x, hint);
+        return this->_ybegin[i] + (x - this->_xbegin[i]) * _s[i];
+    }
+    void values(const double* xs, std::size_t n, double* out) const override {
+        std::size_t hint = 0;
+        for(std::size_t k=0; k<n; ++k){
+            std::size_t i = this->locate(xs[k], hint);
+            out[k] = this->_ybegin[i] + (xs[k] - this->_xbegin[i]) * _s[i];
+        }
+    }
     double primitive(double x) const override {
         std::size_t i = this->locate(x);
         double dx = x - this->_xbegin[i];
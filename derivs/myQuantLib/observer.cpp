@@ -6,13 +6,200 @@
 //
 
 #include "observer.hpp"
+#include <algorithm>
+#include <exception>
 
 namespace myQuantLib {
 
+void ObserverProxy::update(){
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if(_observer)
+        _observer->update();
+}
+
+void ObserverProxy::detach(){
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _observer = nullptr;
+}
+
+
 void Observable::notify_observers(){
-    for(std::list<Observer*>::iterator it = _observers.begin(); it != _observers.end(); ++it)
-        (*it)->update();
+    std::shared_ptr<const ObserverSet> observers = std::atomic_load(&_observers);
+    ObservableSettings& settings = ObservableSettings::instance();
+    if(!settings.updates_enabled()){
+        if(settings.updates_deferred())
+            settings.defer(*observers);
+        return;
+    }
+    for(ObserverSet::const_iterator it = observers->begin(); it != observers->end(); ++it)
+        if(std::shared_ptr<ObserverProxy> o = it->lock())
+            o->update();
+}
+
+// copy on write: a new snapshot replaces the old one unless another thread replaced it first, then try again
+void Observable::register_observer(const std::shared_ptr<ObserverProxy>& o){
+    std::shared_ptr<const ObserverSet> current = std::atomic_load(&_observers);
+    std::shared_ptr<const ObserverSet> updated;
+    do{
+        std::shared_ptr<ObserverSet> observers = std::make_shared<ObserverSet>();
+        observers->reserve(current->size() + 1);
+        bool found = false;
+        for(const std::weak_ptr<ObserverProxy>& w: *current){
+            std::shared_ptr<ObserverProxy> p = w.lock();
+            if(!p)
+                continue; // drop destroyed observers on the way
+            found = found || p == o;
+            observers->push_back(w);
+        }
+        if(!found)
+            observers->push_back(o);
+        updated = observers;
+    }while(!std::atomic_compare_exchange_weak(&_observers, &current, updated));
+}
+
+void Observable::unregister_observer(const std::shared_ptr<ObserverProxy>& o){
+    std::shared_ptr<const ObserverSet> current = std::atomic_load(&_observers);
+    std::shared_ptr<const ObserverSet> updated;
+    do{
+        std::shared_ptr<ObserverSet> observers = std::make_shared<ObserverSet>();
+        observers->reserve(current->size());
+        for(const std::weak_ptr<ObserverProxy>& w: *current){
+            std::shared_ptr<ObserverProxy> p = w.lock();
+            if(p && p != o)
+                observers->push_back(w);
+        }
+        updated = observers;
+    }while(!std::atomic_compare_exchange_weak(&_observers, &current, updated));
+}
+
+
+Observer::Observer(const Observer& o): _proxy(std::make_shared<ObserverProxy>(this)){
+    std::vector<std::shared_ptr<Observable>> observables;
+    {
+        std::lock_guard<std::mutex> lock(o._mutex);
+        observables = o._observables;
+    }
+    for(const std::shared_ptr<Observable>& h: observables)
+        register_with(h);
+}
+
+Observer& Observer::operator=(const Observer& o){
+    if(this == &o)
+        return *this;
+    unregister_with_all();
+    std::vector<std::shared_ptr<Observable>> observables;
+    {
+        std::lock_guard<std::mutex> lock(o._mutex);
+        observables = o._observables;
+    }
+    for(const std::shared_ptr<Observable>& h: observables)
+        register_with(h);
+    return *this;
+}
+
+Observer::~Observer(){
+    detach_observer();
 }
 
+void Observer::detach_observer(){
+    _proxy->detach(); // no update() after this line
+    unregister_with_all();
 }
 
+void Observer::register_with(const std::shared_ptr<Observable>& o){
+    if(!o)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(std::find(_observables.begin(), _observables.end(), o) != _observables.end())
+            return;
+        _observables.push_back(o);
+    }
+    o->register_observer(_proxy); // access private methods because of friend class
+}
+
+void Observer::unregister_with(const std::shared_ptr<Observable>& o){
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<std::shared_ptr<Observable>>::iterator it = std::find(_observables.begin(), _observables.end(), o);
+        if(it == _observables.end())
+            return;
+        _observables.erase(it);
+    }
+    o->unregister_observer(_proxy); // access private methods because of friend class
+}
+
+void Observer::unregister_with_all(){
+    std::vector<std::shared_ptr<Observable>> observables;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        observables.swap(_observables);
+    }
+    for(const std::shared_ptr<Observable>& o: observables)
+        o->unregister_observer(_proxy);
+}
+
+
+ObservableSettings& ObservableSettings::instance(){
+    static ObservableSettings settings; // initialization is thread safe
+    return settings;
+}
+
+void ObservableSettings::disable_updates(bool deferred){
+    std::lock_guard<std::mutex> lock(_mutex);
+    _disabled.fetch_add(1, std::memory_order_acq_rel);
+    if(deferred)
+        _deferred.store(true, std::memory_order_release);
+}
+
+// the last enable_updates sends the deferred notifications in waves, updates stay disabled meanwhile so
+// the notifications the updates send are deferred to the next wave: an observer behind a Handle on 500 quotes
+// is updated once, after the 500 Links were
+void ObservableSettings::enable_updates(){
+    std::exception_ptr error;
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_disabled.load(std::memory_order_acquire) == 0)
+        return;
+    if(_disabled.load(std::memory_order_acquire) > 1){
+        _disabled.fetch_sub(1, std::memory_order_acq_rel);
+        return;
+    }
+    while(!_deferred_observers.empty()){
+        DeferredSet observers;
+        observers.swap(_deferred_observers);
+        lock.unlock();
+        // every observer is updated even if one throws
+        for(const std::weak_ptr<ObserverProxy>& w: observers){
+            if(std::shared_ptr<ObserverProxy> o = w.lock()){
+                try{
+                    o->update();
+                }catch(...){
+                    if(!error)
+                        error = std::current_exception();
+                }
+            }
+        }
+        lock.lock();
+    }
+    _deferred.store(false, std::memory_order_release);
+    _disabled.fetch_sub(1, std::memory_order_acq_rel);
+    lock.unlock();
+    if(error)
+        std::rethrow_exception(error);
+}
+
+void ObservableSettings::defer(const Observable::ObserverSet& observers){
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_disabled.load(std::memory_order_acquire) != 0){
+            _deferred_observers.insert(observers.begin(), observers.end());
+            return;
+        }
+    }
+    // enabled again since notify_observers looked
+    for(const std::weak_ptr<ObserverProxy>& w: observers)
+        if(std::shared_ptr<ObserverProxy> o = w.lock())
+            o->update();
+}
+
+}
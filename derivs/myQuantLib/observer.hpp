@@ -10,48 +10,121 @@
 #ifndef observer_hpp
 #define observer_hpp
 
-#include <list>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
 namespace myQuantLib{
 
 // observer pattern: Observable notify all registered observers, observers registered with observables update when notified
+/*thread safety: quotes tick on one thread while others price, so
+ 1) an Observable holds an immutable snapshot of its observers, replaced (copy on write) on registration changes,
+    notify_observers walks the snapshot it loaded. The snapshot is loaded and replaced with the atomic shared_ptr
+    functions, which libstdc++ implements with a small pool of mutexes: short critical sections, not lock-free
+ 2) it holds its observers weakly, through the ObserverProxy each Observer owns, an Observer destroyed during a
+    notification is skipped. The proxy calls update() under its own recursive_mutex, so updates of one observer are
+    serialized (not lock-free), and detach_observer (called by ~Observer, and first by the destructors of TermStructure,
+    YieldTermStructure, LazyObject) takes that mutex, waiting for an update() running on another thread to return
+ 3) updates can be deferred (ObservableSettings, DeferredUpdates), each observer notified meanwhile gets a single
+    update() when updates are enabled again, e.g. 500 quote ticks give a curve on all of them one invalidation
+ */
 class Observer;
+class Observable;
+
+// the part of an Observer that Observables point to, may outlive the Observer
+class ObserverProxy{
+public:
+    explicit ObserverProxy(Observer* o): _observer(o){}
+    void update();  // calls _observer->update() unless detached
+    void detach();  // returns once no update() is running on the Observer
+private:
+    std::recursive_mutex _mutex; // recursive: an update may notify back to the same observer
+    Observer* _observer;
+};
 
 class Observable{
     friend class Observer;
+    friend class ObservableSettings;
 public:
-    Observable(){};
-    virtual ~Observable(){}; // do not delete Observer* since Observable does not own them
+    Observable(): _observers(std::make_shared<const ObserverSet>()){}
+    // observers are registered with an instance, not with its value, a copy starts without any
+    Observable(const Observable&): Observable(){}
+    Observable& operator=(const Observable&){return *this;}
+    virtual ~Observable(){}; // do not delete observers since Observable does not own them
     void notify_observers();
+    std::size_t num_observers() const {return std::atomic_load(&_observers)->size();} // may count destroyed observers
 private:
-    void register_observer(Observer* o) {_observers.push_back(o);}
-    void unregister_observer(Observer* o) {_observers.remove(o);}
-    std::list<Observer*> _observers;
+    typedef std::vector<std::weak_ptr<ObserverProxy>> ObserverSet;
+    void register_observer(const std::shared_ptr<ObserverProxy>& o);
+    void unregister_observer(const std::shared_ptr<ObserverProxy>& o);
+    std::shared_ptr<const ObserverSet> _observers; // read and replaced with the atomic shared_ptr functions only
 };
 
 class Observer{
 public:
-    virtual ~Observer(){
-        //remove registration from all Observables it subscribes to
-        for(std::list<std::shared_ptr<Observable>>::iterator it = _observables.begin();
-            it != _observables.end(); ++it ){
-            (*it)->unregister_observer(this);
-        }
-    }
-    void register_with(const std::shared_ptr<Observable>& o){
-        o->register_observer(this); // access private methods because of friend class
-        _observables.push_back(o);
-    }
-    void unregister_with(const std::shared_ptr<Observable>& o){
-        o->unregister_observer(this); // access private methods because of friend class
-        _observables.remove(o);
-    }
+    virtual ~Observer();
+    void register_with(const std::shared_ptr<Observable>& o);
+    void unregister_with(const std::shared_ptr<Observable>& o);
+    // does not wait for an update() already running on another thread, see detach_observer
+    void unregister_with_all();
     virtual void update()=0;
 protected:
-    Observer(){};
+    Observer(): _proxy(std::make_shared<ObserverProxy>(this)){};
+    // a copy observes the same observables
+    Observer(const Observer& o);
+    Observer& operator=(const Observer& o);
+    // no update() once it returns: waits for an update() running on another thread, then unregisters with all.
+    // a derived class notified from other threads calls it first in its destructor,
+    // otherwise update() may run while the derived part is being destroyed
+    void detach_observer();
+private:
+    std::shared_ptr<ObserverProxy> _proxy;
+    mutable std::mutex _mutex; // guards _observables
+    std::vector<std::shared_ptr<Observable>> _observables;
+};
+
+
+// global switch for notifications, when disabled they are either dropped or deferred until enabled again
+class ObservableSettings{
+public:
+    static ObservableSettings& instance(); // thread safe, unlike Singleton without myQL_ENABLE_SINGLETON_THREAD_SAFE_INIT
+    ObservableSettings(const ObservableSettings&) = delete;
+    ObservableSettings& operator=(const ObservableSettings&) = delete;
+    
+    // calls nest, updates are enabled again when each disable_updates is matched by enable_updates
+    // deferred: observers notified meanwhile get one update() when they are (otherwise notifications are dropped),
+    // rethrows the first exception of these updates
+    void disable_updates(bool deferred=false);
+    void enable_updates();
+    bool updates_enabled() const {return _disabled.load(std::memory_order_acquire) == 0;}
+    bool updates_deferred() const {return _deferred.load(std::memory_order_acquire);}
 private:
-    std::list<std::shared_ptr<Observable>> _observables;
+    friend class Observable;
+    ObservableSettings(){}
+    void defer(const Observable::ObserverSet& observers);
+    
+    typedef std::set<std::weak_ptr<ObserverProxy>, std::owner_less<std::weak_ptr<ObserverProxy>>> DeferredSet;
+    std::atomic<unsigned long> _disabled{0}; // changed under _mutex
+    std::atomic<bool> _deferred{false};
+    std::mutex _mutex;
+    DeferredSet _deferred_observers;
+};
+
+// defers notifications for its lifetime
+class DeferredUpdates{
+public:
+    DeferredUpdates(){ObservableSettings::instance().disable_updates(true);}
+    ~DeferredUpdates(){
+        try{
+            ObservableSettings::instance().enable_updates();
+        }catch(...){
+            // an update failed, nothing we can do from a destructor
+        }
+    }
+    DeferredUpdates(const DeferredUpdates&) = delete;
+    DeferredUpdates& operator=(const DeferredUpdates&) = delete;
 };
 
 
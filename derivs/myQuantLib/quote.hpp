@@ -9,6 +9,7 @@
 #define quote_hpp
 
 #include "observer.hpp"
+#include <atomic>
 
 namespace myQuantLib {
 
@@ -18,6 +19,20 @@ public:
     virtual double value() const = 0;
     virtual bool is_valid() const = 0;
 };
+
+// a quote set by hand, every set_value notifies the observers; the value is atomic so it can tick on one thread while others price
+class SimpleQuote: public Quote {
+public:
+    explicit SimpleQuote(double value): _value(value){}
+    double value() const override {return _value.load();}
+    bool is_valid() const override {return true;}
+    void set_value(double value){
+        _value.store(value);
+        notify_observers();
+    }
+private:
+    std::atomic<double> _value;
+};
 }
 
 
@@ -58,7 +58,7 @@ public:
     // calculate the reference date based on the global evaluation date
     TermStructure(int settlement_days, Calendar, DayCounter dc=DayCounter());
     
-    ~TermStructure() override = default;
+    ~TermStructure() override {detach_observer();} // update() may be running on another thread
     
     virtual DayCounter day_counter() const {return _day_counter;}
     double time_from_ref(const Date& date) const {
@@ -72,6 +72,7 @@ public:
     const std::vector<Date>& dates() const {return _dates;}
     const std::vector<double>& data() const {return this->_data;}
     const std::vector<double>& zero_rates() const {return this->_data;}
+    using YieldTermStructure::zero_rates; // batch zero rates, hidden by the node accessor otherwise
     std::vector<std::pair<Date, double>> nodes() const {
         std::vector<std::pair<Date, double>> results(_dates.size());
         for(std::size_t i=0; i<_dates.size(); ++i)
@@ -110,6 +111,23 @@ protected:
         double inst_fwd_max = zmax + tmax * this->_interpolation.derivative(tmax);
         return (zmax * tmax + inst_fwd_max * (time-tmax)) / time;
     }
+    void zero_yields_impl(const double* times, std::size_t n, double* out) const override {
+        this->_interpolation.values(times, n, out, true);
+        double tmax = this->_times.back();
+        double zmax = this->_data.back();
+        double inst_fwd_max = 0.0;
+        bool beyond = false;
+        for(std::size_t i=0; i<n; ++i) {
+            if(times[i] <= tmax)
+                continue;
+            // flat fwd extrapolation
+            if(!beyond) {
+                inst_fwd_max = zmax + tmax * this->_interpolation.derivative(tmax);
+                beyond = true;
+            }
+            out[i] = (zmax * tmax + inst_fwd_max * (times[i]-tmax)) / times[i];
+        }
+    }
     
     mutable std::vector<Date> _dates;
 private:
@@ -45,6 +45,11 @@ public:
     
 protected:
     virtual double zero_yield_impl(double time) const = 0;
+    // zero_yield_impl of n times, the yield at time 0 is not used
+    virtual void zero_yields_impl(const double* times, std::size_t n, double* out) const {
+        for(std::size_t i=0; i<n; ++i)
+            out[i] = times[i] == 0.0 ? 0.0 : zero_yield_impl(times[i]);
+    }
     
     double discount_impl(double time) const override {
         // discount is computed by zero yields inputs
@@ -53,6 +58,11 @@ protected:
         double r = zero_yield_impl(time);
         return std::exp(- r * time);
     }
+    void discounts_impl(const double* times, std::size_t n, double* out) const override {
+        zero_yields_impl(times, n, out);
+        for(std::size_t i=0; i<n; ++i)
+            out[i] = times[i] == 0.0 ? 1.0 : std::exp(- out[i] * times[i]);
+    }
     
 };
 
@@ -6,14 +6,20 @@
 //
 
 #include "yieldtermstructure.hpp"
+#include <algorithm>
 
 namespace myQuantLib {
 
-//TODO: implement discount, zero_rate, forward_rate and set_jumps
-
 namespace {
     // time interval used in finite difference
     const double dt = 0.0001;  // 0.0001 * 365.25 * 24 = 0.88 hour
+    
+    // the frequency check of InterestRate, once for a batch of rates
+    void check_frequency(Compounding comp, Frequency freq) {
+        if (comp == Compounded || comp == SimpleThenCompounded || comp == CompoundedThenSimple) {
+            myQL_REQUIRE(freq != Once && freq != NoFrequency, "frequency not allowed for this interest rate");
+        }
+    }
 }
 
 void YieldTermStructure::set_jumps(const Date &ref_date) {
@@ -33,6 +39,29 @@ void YieldTermStructure::set_jumps(const Date &ref_date) {
     for (std::size_t i=0; i<n_jumps; ++i)
         _jump_times[i] = time_from_ref(_jump_dates[i]);
     _latest_ref = ref_date;
+    std::atomic_store(&_jump_table, build_jump_table());
+}
+
+std::shared_ptr<const YieldTermStructure::JumpTable> YieldTermStructure::build_jump_table() const {
+    std::vector<std::pair<double, std::size_t>> order;
+    for (std::size_t i=0; i<n_jumps; ++i)
+        if (_jump_times[i] > 0)
+            order.push_back(std::make_pair(_jump_times[i], i));
+    std::sort(order.begin(), order.end());
+    std::shared_ptr<JumpTable> table = std::make_shared<JumpTable>();
+    table->times.reserve(order.size());
+    table->cumulative.reserve(order.size() + 1);
+    table->cumulative.push_back(1.0);
+    for (std::size_t k=0; k<order.size(); ++k) {
+        const Handle<Quote>& jump = _jumps[order[k].second];
+        if (jump.empty() || !jump->is_valid() || !(jump->value() > 0.0))
+            break;
+        table->times.push_back(order[k].first);
+        table->cumulative.push_back(table->cumulative.back() * jump->value());
+    }
+    for (std::size_t k=table->times.size(); k<order.size(); ++k)
+        table->times.push_back(order[k].first);
+    return table;
 }
 
 double YieldTermStructure::discount(double time, bool extrapolate) const {
@@ -116,6 +145,103 @@ InterestRate YieldTermStructure::forward_rate(double t1, double t2,
     return InterestRate::implied_rate(compound, day_counter(), comp, freq, t2 - t1);
 }
 
+void YieldTermStructure::discounts(const double* times, std::size_t n, double* out, bool extrapolate) const {
+    if(n == 0)
+        return;
+    std::pair<const double*, const double*> range = std::minmax_element(times, times + n);
+    check_range(*range.first, extrapolate);
+    check_range(*range.second, extrapolate);
+    discounts_impl(times, n, out);
+    if(_jumps.empty())
+        return;
+    
+    std::shared_ptr<const JumpTable> table = std::atomic_load(&_jump_table);
+    std::size_t used = std::lower_bound(table->times.begin(), table->times.end(), *range.second) - table->times.begin();
+    if (used >= table->cumulative.size()) {
+        // a jump with an invalid quote when the table was built is needed, fail as discount does
+        for (std::size_t i=0; i<n_jumps; ++i) {
+            if (_jump_times[i] > 0 && _jump_times[i] < *range.second) {
+                myQL_REQUIRE(_jumps[i]->is_valid(), "invalid " << (i+1) << "-th jump quote");
+                double this_jump = _jumps[i]->value();
+                myQL_REQUIRE(this_jump > 0.0, "invalid " << (i+1) << "-th jump value: " << this_jump);
+            }
+        }
+        // valid by now, the quote changed without a notification
+        table = build_jump_table();
+    }
+    // a jump applies to the times after it
+    for(std::size_t i=0; i<n; ++i)
+        out[i] *= table->cumulative[std::lower_bound(table->times.begin(), table->times.begin() + used, times[i]) - table->times.begin()];
+}
+
+std::vector<double> YieldTermStructure::discounts(const std::vector<double>& times, bool extrapolate) const {
+    std::vector<double> results(times.size());
+    discounts(times.data(), times.size(), results.data(), extrapolate);
+    return results;
+}
+
+std::vector<double> YieldTermStructure::discounts(const std::vector<Date>& dates, bool extrapolate) const {
+    std::vector<double> times(dates.size());
+    for(std::size_t i=0; i<dates.size(); ++i)
+        times[i] = time_from_ref(dates[i]);
+    return discounts(times, extrapolate);
+}
+
+void YieldTermStructure::zero_rates(const double* times, std::size_t n, double* out,
+                                    Compounding comp, Frequency freq, bool extrapolate) const {
+    check_frequency(comp, freq);
+    std::vector<double> ts(times, times + n);
+    for(std::size_t i=0; i<n; ++i)
+        if (ts[i] == 0.0) ts[i] = dt;
+    discounts(ts.data(), n, out, extrapolate);
+    for(std::size_t i=0; i<n; ++i)
+        out[i] = InterestRate::implied_rate_value(1.0 / out[i], comp, freq, ts[i]);
+}
+
+std::vector<double> YieldTermStructure::zero_rates(const std::vector<double>& times,
+                                                   Compounding comp, Frequency freq, bool extrapolate) const {
+    std::vector<double> results(times.size());
+    zero_rates(times.data(), times.size(), results.data(), comp, freq, extrapolate);
+    return results;
+}
+
+void YieldTermStructure::forward_rates(const double* t1s, const double* t2s, std::size_t n, double* out,
+                                       Compounding comp, Frequency freq, bool extrapolate) const {
+    if(n == 0)
+        return;
+    check_frequency(comp, freq);
+    // starts in ts[0, n), ends in ts[n, 2n), equal times are moved apart as in forward_rate
+    std::vector<double> ts(2 * n), dfs(2 * n);
+    double tmin = t1s[0], tmax = t2s[0];
+    for(std::size_t i=0; i<n; ++i) {
+        double t1 = t1s[i], t2 = t2s[i];
+        if (t2 == t1) {
+            t1 = std::max(t1 - dt/2.0, 0.0);
+            t2 = t1 + dt;
+        } else {
+            myQL_REQUIRE(t2 > t1, "t2 (" << t2 << ") < t1 (" << t1 << ")");
+        }
+        tmin = std::min(tmin, t1s[i]);
+        tmax = std::max(tmax, t2s[i]);
+        ts[i] = t1;
+        ts[n + i] = t2;
+    }
+    check_range(tmin, extrapolate);
+    check_range(tmax, extrapolate);
+    discounts(ts.data(), 2 * n, dfs.data(), true);
+    for(std::size_t i=0; i<n; ++i)
+        out[i] = InterestRate::implied_rate_value(dfs[i] / dfs[n + i], comp, freq, ts[n + i] - ts[i]);
+}
+
+std::vector<double> YieldTermStructure::forward_rates(const std::vector<double>& t1s, const std::vector<double>& t2s,
+                                                      Compounding comp, Frequency freq, bool extrapolate) const {
+    myQL_REQUIRE(t1s.size() == t2s.size(), "mismatch between number of start (" << t1s.size()
+                 << ") and end times (" << t2s.size() << ")");
+    std::vector<double> results(t1s.size());
+    forward_rates(t1s.data(), t2s.data(), t1s.size(), results.data(), comp, freq, extrapolate);
+    return results;
+}
+
 void YieldTermStructure::update() {
     TermStructure::update();
     Date new_ref= Date();
@@ -123,6 +249,8 @@ void YieldTermStructure::update() {
         new_ref = ref_date();
         if (new_ref != _latest_ref)
             set_jumps(new_ref);
+        else
+            std::atomic_store(&_jump_table, build_jump_table()); // a jump quote may have changed
     } catch (Error&){
         if(new_ref == Date()){
             // the curve couldn't calculate the reference
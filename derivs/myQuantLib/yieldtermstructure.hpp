@@ -13,6 +13,7 @@
 #include "handle.hpp"
 #include "interestrate.hpp"
 
+#include <memory>
 #include <vector>
 
 namespace myQuantLib {
@@ -47,6 +48,8 @@ public:
         for(std::size_t i = 0; i < n_jumps; ++i)
             register_with(_jumps[i]);  // trigger update whenever any one of the jumps changes
     }
+
+    ~YieldTermStructure() override {detach_observer();} // before _jumps and the jump times update() reads go
     
     /*! \name Discount factors
 
@@ -103,6 +106,27 @@ public:
                               Frequency freq = Annual,
                               bool extrapolate = false) const;
     
+    /*! \name Batch evaluation
+
+        The same values as the methods above for a whole grid of times in one call:
+        the range is checked once, the jumps are applied from a cumulative table and
+        derived curves can evaluate the grid at once (discounts_impl). Times need not
+        be sorted, increasing times are the fastest.
+    */
+    void discounts(const double* times, std::size_t n, double* out, bool extrapolate = false) const;
+    std::vector<double> discounts(const std::vector<double>& times, bool extrapolate = false) const;
+    std::vector<double> discounts(const std::vector<Date>& dates, bool extrapolate = false) const;
+    // zero_rate(times[i], comp, freq, extrapolate).rate()
+    void zero_rates(const double* times, std::size_t n, double* out,
+                    Compounding comp, Frequency freq = Annual, bool extrapolate = false) const;
+    std::vector<double> zero_rates(const std::vector<double>& times,
+                                   Compounding comp, Frequency freq = Annual, bool extrapolate = false) const;
+    // forward_rate(t1s[i], t2s[i], comp, freq, extrapolate).rate()
+    void forward_rates(const double* t1s, const double* t2s, std::size_t n, double* out,
+                       Compounding comp, Frequency freq = Annual, bool extrapolate = false) const;
+    std::vector<double> forward_rates(const std::vector<double>& t1s, const std::vector<double>& t2s,
+                                      Compounding comp, Frequency freq = Annual, bool extrapolate = false) const;
+    
     const std::vector<Date>& jump_dates() const {return this->_jump_dates;}
     const std::vector<double>& jump_times() const {return this->_jump_times;}
     
@@ -119,15 +143,29 @@ protected:
         must assume that extrapolation is required.
     */
     virtual double discount_impl(double) const = 0;
+    // discount_impl of n times, to be overridden by curves that do better than one call per time
+    virtual void discounts_impl(const double* times, std::size_t n, double* out) const {
+        for(std::size_t i=0; i<n; ++i)
+            out[i] = discount_impl(times[i]);
+    }
 private:
+    // jumps after the reference date in time order, cumulative[k] is the effect of the first k of them,
+    // up to the first jump whose quote is invalid (cumulative.size() - 1 jumps can be applied)
+    struct JumpTable{
+        std::vector<double> times;
+        std::vector<double> cumulative;
+    };
     // method
     void set_jumps(const Date& ref_date);
+    std::shared_ptr<const JumpTable> build_jump_table() const;
     // data members
     std::vector<Handle<Quote>> _jumps;
     std::vector<Date> _jump_dates;
     std::vector<double> _jump_times;
     std::size_t n_jumps = 0;
     Date _latest_ref;
+    // for the batch methods, rebuilt by set_jumps and update(), read and replaced with the atomic shared_ptr functions
+    std::shared_ptr<const JumpTable> _jump_table;
 };
 
 
@@ -9,6 +9,12 @@
 #define test_hpp
 
 void test_date();
+void test_observer();
+void test_interpolation();
+void test_yieldtermstructure();
+void test_calendar();
+void test_biz252();
+void test_date_parse();
 
 
 #endif /* test_hpp */
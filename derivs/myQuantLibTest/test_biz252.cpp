@@ -0,0 +1,83 @@
+//
+//  test_biz252.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/14/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/daycounter_biz252.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <random>
+
+namespace {
+
+// business days from d1 included to d2 excluded, one day at a time, negative going backwards
+myQuantLib::Date::serial_type count_by_days(const myQuantLib::Calendar& cal, const myQuantLib::Date& d1,
+                                            const myQuantLib::Date& d2) {
+    myQuantLib::Date::serial_type wd = 0;
+    for(myQuantLib::Date d = d1; d < d2; ++d)
+        if(cal.is_biz_day(d)) ++wd;
+    for(myQuantLib::Date d = d2 + 1; d <= d1; ++d)
+        if(cal.is_biz_day(d)) --wd;
+    return wd;
+}
+
+}
+
+void test_biz252(){
+    using namespace myQuantLib;
+    UnitedStates cal(UnitedStates::Settlement);
+    Biz252 dc(cal);
+    std::cout << dc.name() << "\n";
+    
+    unsigned long num_pairs, num_threads;
+    std::cout << "number of random date pairs: ";
+    std::cin >> num_pairs;
+    std::cout << "number of threads: ";
+    std::cin >> num_threads;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<Date::serial_type> offset(0, 14999), length(-1000, 6299);
+    Date base(1, January, 1990);
+    std::vector<Date> d1s(num_pairs), d2s(num_pairs);
+    for(unsigned long i=0; i<num_pairs; ++i){
+        d1s[i] = base + offset(gen);
+        d2s[i] = d1s[i] + length(gen);
+    }
+    
+    unsigned long errors = 0;
+    for(unsigned long i=0; i<num_pairs; ++i)
+        if(dc.day_count(d1s[i], d2s[i]) != count_by_days(cal, d1s[i], d2s[i])) ++errors;
+    std::cout << "mismatches against day by day counts: " << errors << "\n";
+    
+    // every thread prices accruals on the same day counter, the sums must agree with a single thread
+    double expected = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_pairs; ++i)
+        expected += dc.year_fraction(d1s[i], d2s[i]);
+    auto mid = std::chrono::steady_clock::now();
+    std::vector<double> sums(num_threads, 0.0);
+    std::vector<std::thread> threads;
+    for(unsigned long t=0; t<num_threads; ++t)
+        threads.emplace_back([&, t](){
+            Biz252 local(UnitedStates(UnitedStates::Settlement)); // another copy sharing the same table
+            const DayCounter& counter = t % 2 ? local : dc;
+            double sum = 0.0;
+            for(unsigned long i=0; i<num_pairs; ++i)
+                sum += counter.year_fraction(d1s[i], d2s[i]);
+            sums[t] = sum;
+        });
+    for(auto& th: threads) th.join();
+    auto end = std::chrono::steady_clock::now();
+    unsigned long disagreements = 0;
+    for(double s: sums)
+        if(s != expected) ++disagreements;
+    std::cout << "year fractions, single thread, time(ms): "
+              << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", " << num_threads << " threads, time(ms): "
+              << std::chrono::duration<double, std::milli>(end - mid).count()
+              << ", threads disagreeing: " << disagreements << "\n";
+}
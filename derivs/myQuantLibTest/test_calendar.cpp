@@ -0,0 +1,129 @@
+//
+//  test_calendar.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/13/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/calendar_us.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <set>
+#include <random>
+
+namespace {
+
+// business days by the rules alone, not the business day table: the weekends of the calendar and a set of the
+// other days its rules (with the added and removed holidays at construction) make holidays
+class ReferenceDays: public myQuantLib::UnitedStates {
+public:
+    ReferenceDays(Market market, const myQuantLib::Date& from, const myQuantLib::Date& to): UnitedStates(market) {
+        for(myQuantLib::Date d = from; d <= to; ++d)
+            if(!is_weekend(d.weekday()) && !_impl->is_biz_day_with_holidays(d))
+                holidays.insert(d);
+    }
+    bool is_reference_biz_day(const myQuantLib::Date& d) const {
+        return !is_weekend(d.weekday()) && holidays.find(d) == holidays.end();
+    }
+    std::set<myQuantLib::Date> holidays;
+};
+
+// bizdays_between and advance(n, Days) one day at a time on the reference
+myQuantLib::Date::serial_type count_by_days(const ReferenceDays& ref, const myQuantLib::Date& from,
+                                            const myQuantLib::Date& to) {
+    myQuantLib::Date::serial_type wd = 0;
+    for(myQuantLib::Date d = from; d < to; ++d)
+        if(ref.is_reference_biz_day(d) && d != from) ++wd; // include_first = false, include_last = true
+    if(from < to && ref.is_reference_biz_day(to)) ++wd;
+    return wd;
+}
+
+myQuantLib::Date advance_by_days(const ReferenceDays& ref, const myQuantLib::Date& d, int n) {
+    myQuantLib::Date d1 = d;
+    for(; n > 0; --n){
+        ++d1;
+        while(!ref.is_reference_biz_day(d1)) ++d1;
+    }
+    for(; n < 0; ++n){
+        --d1;
+        while(!ref.is_reference_biz_day(d1)) --d1;
+    }
+    return d1;
+}
+
+}
+
+void test_calendar(){
+    using namespace myQuantLib;
+    UnitedStates cal(UnitedStates::Settlement);
+    std::cout << "business day table of the US settlement calendar\n";
+    std::cout << "4 July 2022 is a holiday: " << cal.is_holiday(Date(4, July, 2022))
+              << ", 24 November 2022 (Thanksgiving) is a holiday: " << cal.is_holiday(Date(24, November, 2022))
+              << ", 25 November 2022 is a business day: " << cal.is_biz_day(Date(25, November, 2022)) << "\n";
+    
+    unsigned long num_pairs;
+    std::cout << "number of random date pairs: ";
+    std::cin >> num_pairs;
+    unsigned long count_errors = 0, advance_errors = 0;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<Date::serial_type> offset(0, 14999), length(1, 3650);
+    std::uniform_int_distribution<int> days(-300, 299);
+    Date base(1, January, 1990);
+    std::vector<Date> froms(num_pairs), tos(num_pairs);
+    std::vector<int> ns(num_pairs);
+    for(unsigned long i=0; i<num_pairs; ++i){
+        froms[i] = base + offset(gen);
+        tos[i] = froms[i] + length(gen);
+        ns[i] = days(gen);
+        if(ns[i] == 0) ns[i] = 1; // advancing by 0 days adjusts
+    }
+    ReferenceDays ref(UnitedStates::Settlement, base - 1000, base + 20000);
+    for(unsigned long i=0; i<num_pairs; ++i){
+        if(cal.bizdays_between(froms[i], tos[i], false, true) != count_by_days(ref, froms[i], tos[i]))
+            ++count_errors;
+        if(cal.bizdays_between(tos[i], froms[i], true, true) != -(count_by_days(ref, froms[i], tos[i])
+                                                                   + ref.is_reference_biz_day(froms[i])))
+            ++count_errors;
+        if(cal.advance(froms[i], ns[i], Days) != advance_by_days(ref, froms[i], ns[i]))
+            ++advance_errors;
+    }
+    std::cout << "mismatches against day by day loops, bizdays_between: " << count_errors
+              << ", advance: " << advance_errors << "\n";
+    
+    Date::serial_type total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_pairs; ++i)
+        total += count_by_days(ref, froms[i], tos[i]);
+    auto mid = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_pairs; ++i)
+        total -= cal.bizdays_between(froms[i], tos[i], false, true);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "bizdays_between over up to 10 years, day by day, time(ms): "
+              << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", table, time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count()
+              << ", difference: " << total << "\n";
+    
+    bool null_rejected = false;
+    try {
+        cal.bizdays_between(Date(), Date(1, June, 2022));
+    } catch (Error&) {
+        null_rejected = true;
+    }
+    
+    // the table is rebuilt when the holidays change
+    Date d(15, June, 2022);
+    Date::serial_type before = cal.bizdays_between(Date(1, June, 2022), Date(30, June, 2022));
+    cal.add_holiday(d);
+    Date::serial_type with_holiday = cal.bizdays_between(Date(1, June, 2022), Date(30, June, 2022));
+    Date next_day = cal.advance(Date(14, June, 2022), 1, Days);
+    cal.remove_holiday(d);
+    ref.holidays.insert(d);
+    bool agree = with_holiday == count_by_days(ref, Date(31, May, 2022), Date(29, June, 2022))
+                 && next_day == advance_by_days(ref, Date(14, June, 2022), 1);
+    std::cout << "business days in June 2022: " << before << ", with 15 June as a holiday: " << with_holiday
+              << ", business day after 14 June: " << next_day
+              << ", after removing it again: " << cal.bizdays_between(Date(1, June, 2022), Date(30, June, 2022))
+              << ", agrees with the reference: " << agree << ", null date rejected: " << null_rejected << "\n";
+}
@@ -0,0 +1,114 @@
+//
+//  test_date_parse.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/15/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/date.hpp"
+#include "../myQuantLib/errors.hpp"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+
+namespace {
+
+// the fields can be computed at compile time
+static_assert(myQuantLib::Date(15, myQuantLib::April, 2022).month() == myQuantLib::April, "constexpr month");
+static_assert(myQuantLib::Date(29, myQuantLib::February, 2000).day_of_month() == 29, "constexpr day");
+static_assert(myQuantLib::Date::is_end_of_month(myQuantLib::Date(28, myQuantLib::February, 2100)), "constexpr end of month");
+static_assert(myQuantLib::Date::max_date().year() == 2199, "constexpr year");
+
+// yyyy-m-d with find, substr and stoi, how the strings were parsed before
+myQuantLib::Date parse_by_substr(const std::string& date_str) {
+    std::size_t end_pos = date_str.find("-");
+    myQuantLib::Year y = std::stoi(date_str.substr(0, end_pos));
+    std::size_t beg_pos = end_pos + 1;
+    end_pos = date_str.find("-", beg_pos);
+    myQuantLib::Month m = myQuantLib::Month(std::stoi(date_str.substr(beg_pos, end_pos - beg_pos)));
+    myQuantLib::Day d = std::stoi(date_str.substr(end_pos + 1));
+    return myQuantLib::Date(d, m, y);
+}
+
+bool throws(const std::string& date_str, myQuantLib::DateOrder order) {
+    try {
+        myQuantLib::Date::parse(date_str, order);
+    } catch (myQuantLib::Error&) {
+        return true;
+    }
+    return false;
+}
+
+}
+
+void test_date_parse(){
+    using namespace myQuantLib;
+    // every date against a day by day walk through the calendar
+    static const int lens[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    unsigned long errors = 0;
+    Year y = 1901;
+    int m = 1;
+    Day d = 1, doy = 1;
+    for(Date::serial_type s = Date::min_date().serial_number(); s <= Date::max_date().serial_number(); ++s){
+        bool leap_year = y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+        int len = lens[m-1] + (m == 2 && leap_year);
+        Date date(s);
+        if(date.year() != y || date.month() != Month(m) || date.day_of_month() != d || date.day_of_year() != doy
+           || Date::is_end_of_month(date) != (d == len) || Date::end_of_month(date) != Date(len, Month(m), y)
+           || Date(d, Month(m), y) != date)
+            ++errors;
+        if(++doy, ++d > len){
+            d = 1;
+            if(++m > 12){
+                m = 1;
+                ++y;
+                doy = 1;
+            }
+        }
+    }
+    std::cout << "dates disagreeing with a day by day walk: " << errors << "\n";
+    
+    std::cout << "2022-04-15: " << Date::parse("2022-04-15") << ", 2022/4/5: " << Date::parse("2022/4/5")
+              << ", 20220415: " << Date::parse("20220415") << ", 15.04.2022 (DMY): " << Date::parse("15.04.2022", DMY)
+              << ", 4/15/2022 (MDY): " << Date::parse(" 4/15/2022\r", MDY) << "\n";
+    std::cout << "rejected: 2022-4/15 " << throws("2022-4/15", YMD) << ", 2022-13-01 " << throws("2022-13-01", YMD)
+              << ", 2022-02-29 " << throws("2022-02-29", YMD) << ", 2022415 " << throws("2022415", YMD)
+              << ", 22-04-15 " << throws("22-04-15", YMD) << ", 2022-04-15x " << throws("2022-04-15x", YMD)
+              << ", empty " << throws("", YMD) << "\n";
+    
+    unsigned long num_dates;
+    std::cout << "number of dates to parse: ";
+    std::cin >> num_dates;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<Date::serial_type> offset(0, 99999);
+    std::string buffer;
+    std::vector<std::string> lines;
+    for(unsigned long i=0; i<num_dates; ++i){
+        Date date(Date::min_date().serial_number() + offset(gen));
+        lines.push_back(std::to_string(date.year()) + "-" + std::to_string(int(date.month())) + "-"
+                        + std::to_string(date.day_of_month()));
+        buffer += lines.back() + "\n";
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Date> by_substr;
+    for(const std::string& line: lines)
+        by_substr.push_back(parse_by_substr(line));
+    auto mid = std::chrono::steady_clock::now();
+    std::vector<Date> by_column;
+    Date::parse_column(buffer, by_column);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "parsed with substr and stoi, time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", parsed as a column, time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count()
+              << ", same dates: " << (by_substr == by_column) << "\n";
+    
+    long sum = 0;
+    start = std::chrono::steady_clock::now();
+    for(const Date& date: by_column)
+        sum += date.year() + int(date.month()) + date.day_of_month() + Date::is_end_of_month(date);
+    end = std::chrono::steady_clock::now();
+    std::cout << "year, month, day and end of month of each date, time(ms): "
+              << std::chrono::duration<double, std::milli>(end - start).count() << ", checksum: " << sum << "\n";
+}
@@ -0,0 +1,62 @@
+//
+//  test_interpolation.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/11/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/interpolations/linearinterpolation.hpp"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+void test_interpolation(){
+    using namespace myQuantLib;
+    unsigned long num_nodes, num_queries;
+    std::cout << "linear interpolation, plain vs. hinted vs. batch lookups of increasing x\n";
+    std::cout << "number of nodes: ";
+    std::cin >> num_nodes;
+    std::cout << "number of queries: ";
+    std::cin >> num_queries;
+    
+    std::vector<double> xs(num_nodes), ys(num_nodes);
+    for(unsigned long i=0; i<num_nodes; ++i){
+        xs[i] = 30.0 * i / (num_nodes - 1);
+        ys[i] = 0.02 + 0.01 * std::sin(xs[i]);
+    }
+    LinearInterpolation interpolation(xs.begin(), xs.end(), ys.begin());
+    std::vector<double> queries(num_queries), plain(num_queries), hinted(num_queries), batch(num_queries);
+    for(unsigned long i=0; i<num_queries; ++i)
+        queries[i] = 30.0 * (i + 0.5) / num_queries;
+    
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_queries; ++i)
+        plain[i] = interpolation(queries[i]);
+    auto mid = std::chrono::steady_clock::now();
+    std::size_t hint = 0;
+    for(unsigned long i=0; i<num_queries; ++i)
+        hinted[i] = interpolation(queries[i], hint);
+    auto mid2 = std::chrono::steady_clock::now();
+    interpolation.values(queries.data(), num_queries, batch.data());
+    auto end = std::chrono::steady_clock::now();
+    
+    double hinted_err = 0.0, batch_err = 0.0;
+    for(unsigned long i=0; i<num_queries; ++i){
+        hinted_err = std::fmax(hinted_err, std::fabs(hinted[i] - plain[i]));
+        batch_err = std::fmax(batch_err, std::fabs(batch[i] - plain[i]));
+    }
+    std::cout << "plain, time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "hinted, time(ms): " << std::chrono::duration<double, std::milli>(mid2 - mid).count()
+              << ", max difference: " << hinted_err << "\n";
+    std::cout << "batch, time(ms): " << std::chrono::duration<double, std::milli>(end - mid2).count()
+              << ", max difference: " << batch_err << "\n";
+    
+    // a hint from anywhere gives the same segment, e.g. for decreasing queries
+    double reverse_err = 0.0;
+    hint = 0;
+    for(unsigned long i=num_queries; i-- > 0;)
+        reverse_err = std::fmax(reverse_err, std::fabs(interpolation(queries[i], hint) - plain[i]));
+    std::cout << "decreasing queries with a hint, max difference: " << reverse_err << "\n";
+}
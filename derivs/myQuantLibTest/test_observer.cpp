@@ -0,0 +1,96 @@
+//
+//  test_observer.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/10/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/observer.hpp"
+#include "../myQuantLib/handle.hpp"
+#include "../myQuantLib/quote.hpp"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class CountingObserver: public myQuantLib::Observer {
+public:
+    ~CountingObserver() override {detach_observer();}
+    void update() override {++_count;}
+    unsigned long count() const {return _count.load();}
+private:
+    std::atomic<unsigned long> _count{0};
+};
+
+}
+
+void test_observer(){
+    using namespace myQuantLib;
+    const unsigned long num_quotes = 500;
+    std::vector<std::shared_ptr<SimpleQuote>> quotes;
+    std::vector<Handle<Quote>> handles;
+    for(unsigned long i=0; i<num_quotes; ++i){
+        quotes.push_back(std::make_shared<SimpleQuote>(0.01 * i));
+        handles.push_back(Handle<Quote>(quotes.back()));
+    }
+    // a curve on the quotes directly, another one through handles
+    CountingObserver curve, handle_curve;
+    for(unsigned long i=0; i<num_quotes; ++i){
+        curve.register_with(quotes[i]);
+        handle_curve.register_with(handles[i]);
+    }
+    
+    for(unsigned long i=0; i<num_quotes; ++i)
+        quotes[i]->set_value(0.02 * i);
+    std::cout << "updates after " << num_quotes << " ticks, direct: " << curve.count()
+              << ", through handles: " << handle_curve.count() << "\n";
+    {
+        DeferredUpdates batch;
+        for(unsigned long i=0; i<num_quotes; ++i)
+            quotes[i]->set_value(0.03 * i);
+    }
+    std::cout << "updates after " << num_quotes << " deferred ticks (expect one more each), direct: " << curve.count()
+              << ", through handles: " << handle_curve.count() << "\n";
+    
+    // ticks on one thread, observers created, notified and destroyed on others
+    unsigned long num_ticks, num_threads;
+    std::cout << "ticking thread against pricing threads\n";
+    std::cout << "number of ticks: ";
+    std::cin >> num_ticks;
+    std::cout << "number of pricing threads: ";
+    std::cin >> num_threads;
+    std::atomic<bool> done{false};
+    std::atomic<unsigned long> observers_made{0};
+    std::vector<std::thread> pricers;
+    for(unsigned long t=0; t<num_threads; ++t)
+        pricers.emplace_back([&, t](){
+            while(!done.load()){
+                CountingObserver pricer;
+                for(unsigned long i=t; i<num_quotes; i+=num_threads)
+                    pricer.register_with(handles[i]);
+                for(unsigned long i=t; i<num_quotes; i+=num_threads)
+                    (*handles[i])->value(); // read while the quotes tick
+                ++observers_made;
+            }
+        });
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long k=0; k<num_ticks; ++k){
+        if(k % 100 == 0){
+            DeferredUpdates batch;
+            for(unsigned long i=0; i<num_quotes; ++i)
+                quotes[i]->set_value(0.01 * k);
+        }
+        quotes[k % num_quotes]->set_value(0.01 * k);
+    }
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    done.store(true);
+    for(std::thread& t: pricers)
+        t.join();
+    std::cout << "ticks: " << num_ticks << ", time(ms): " << time << ", observers created by pricing threads: "
+              << observers_made.load() << "\n";
+    std::cout << "observers left on the first quote (expect 2): " << quotes[0]->num_observers() << "\n";
+}
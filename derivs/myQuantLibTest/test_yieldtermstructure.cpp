@@ -0,0 +1,84 @@
+//
+//  test_yieldtermstructure.cpp
+//  derivs
+//
+//  Created by Xin Li on 4/12/22.
+//
+
+#include "test.hpp"
+#include "../myQuantLib/termstructures/zerocurve.hpp"
+#include "../myQuantLib/daycounter_thirty360.hpp"
+#include "../myQuantLib/quote.hpp"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+void test_yieldtermstructure(){
+    using namespace myQuantLib;
+    unsigned long num_times, num_repeats;
+    std::cout << "zero curve with jumps, scalar vs. batch discounts, zero and forward rates\n";
+    std::cout << "number of times (quarterly, past the last pillar after 30y): ";
+    std::cin >> num_times;
+    std::cout << "number of repeats: ";
+    std::cin >> num_repeats;
+    
+    Date today(15, April, 2022);
+    std::vector<Date> dates;
+    std::vector<double> yields;
+    for(unsigned long i=0; i<=60; ++i){
+        dates.push_back(today + Date::serial_type(183 * i));
+        yields.push_back(0.01 + 0.03 * (1.0 - std::exp(-0.1 * i)));
+    }
+    std::vector<std::shared_ptr<SimpleQuote>> jump_quotes;
+    std::vector<Handle<Quote>> jumps;
+    std::vector<Date> jump_dates;
+    for(unsigned long i=0; i<3; ++i){
+        jump_quotes.push_back(std::make_shared<SimpleQuote>(0.999 - 0.001 * i));
+        jumps.push_back(Handle<Quote>(jump_quotes.back()));
+        jump_dates.push_back(Date(31, December, Year(2024 - 2 * i))); // out of time order
+    }
+    ZeroCurve curve(dates, yields, Thirty360(Thirty360::BondBasis), Calendar(), jumps, jump_dates);
+    
+    std::vector<double> times(num_times), ends(num_times);
+    for(unsigned long i=0; i<num_times; ++i){
+        times[i] = 0.25 * i;
+        ends[i] = i % 10 == 0 ? times[i] : times[i] + 0.25; // some instantaneous forwards
+    }
+    std::vector<double> dfs(num_times), zeros(num_times), fwds(num_times);
+    std::vector<double> batch_dfs, batch_zeros, batch_fwds;
+    
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long k=0; k<num_repeats; ++k)
+        for(unsigned long i=0; i<num_times; ++i){
+            dfs[i] = curve.discount(times[i], true);
+            zeros[i] = curve.zero_rate(times[i], Compounded, Semiannual, true).rate();
+            fwds[i] = curve.forward_rate(times[i], ends[i], Continuous, Annual, true).rate();
+        }
+    auto mid = std::chrono::steady_clock::now();
+    for(unsigned long k=0; k<num_repeats; ++k){
+        batch_dfs = curve.discounts(times, true);
+        batch_zeros = curve.zero_rates(times, Compounded, Semiannual, true);
+        batch_fwds = curve.forward_rates(times, ends, Continuous, Annual, true);
+    }
+    auto end = std::chrono::steady_clock::now();
+    
+    double df_err = 0.0, zero_err = 0.0, fwd_err = 0.0;
+    for(unsigned long i=0; i<num_times; ++i){
+        df_err = std::fmax(df_err, std::fabs(dfs[i] - batch_dfs[i]));
+        zero_err = std::fmax(zero_err, std::fabs(zeros[i] - batch_zeros[i]));
+        fwd_err = std::fmax(fwd_err, std::fabs(fwds[i] - batch_fwds[i]));
+    }
+    std::cout << "scalar, time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "batch, time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    std::cout << "max difference, discounts: " << df_err << ", zero rates: " << zero_err
+              << ", forward rates: " << fwd_err << "\n";
+    
+    // a jump quote ticks, the batch methods see the new value
+    jump_quotes[1]->set_value(0.99);
+    batch_dfs = curve.discounts(times, true);
+    df_err = 0.0;
+    for(unsigned long i=0; i<num_times; ++i)
+        df_err = std::fmax(df_err, std::fabs(curve.discount(times[i], true) - batch_dfs[i]));
+    std::cout << "after a jump tick, max difference of discounts: " << df_err << "\n";
+}
@@ -9,6 +9,7 @@
 
 /*rational approximations for functions related to normal distributions*/
 #include <cmath>
+#include "fast_math.hpp"
 
 const double InvRoot2Pi = 0.398942280401433;
 
@@ -102,3 +103,121 @@ double inv_cum_norm(double u){
 }
 
 
+
+/*array versions*/
+namespace {
+// Beasley-Springer/Moro, same coefficients and evaluation order as inv_cum_norm(double)
+const double moro_a[4] = {2.50662823884, -18.61500062529, 41.39119773534, -25.44106049637};
+const double moro_b[4] = {-8.47351093090, 23.08336743743, -21.06224101826, 3.13082909833};
+
+// Acklam, relative error 1.15e-9 before refinement
+const double acklam_a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                            1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+const double acklam_b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                            6.680131188771972e+01, -1.328068155288572e+01};
+const double acklam_c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                            -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+const double acklam_d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                            3.754408661907416e+00};
+const double acklam_low = 0.02425;
+
+const double Root2Pi = 2.50662827463100050242;
+const double InvRoot2 = 0.70710678118654752440;
+
+// Acklam + one Halley step for u <= 0.5, the upper half follows by symmetry as 1-u is exact there
+double acklam_refined_lower(double u, double x)
+{
+    if(u < acklam_low){
+        double q = std::sqrt(-2.0 * std::log(u));
+        x = (((((acklam_c[0] * q + acklam_c[1]) * q + acklam_c[2]) * q + acklam_c[3]) * q + acklam_c[4]) * q + acklam_c[5]) /
+            ((((acklam_d[0] * q + acklam_d[1]) * q + acklam_d[2]) * q + acklam_d[3]) * q + 1.0);
+    }
+    double e = 0.5 * std::erfc(-x * InvRoot2) - u;
+    double t = e * Root2Pi * std::exp(0.5 * x * x);
+    return x - t / (1.0 + 0.5 * x * t);
+}
+}
+
+// values are processed in tiles: the branch-free pass for a tile goes to a small buffer on the stack,
+// the second pass reads the inputs again, so out may alias in
+const unsigned long NORMALS_TILE = 64;
+
+void inv_cum_norm(const double* u, double* out, unsigned long n, NormalAccuracy accuracy)
+{
+    double central[NORMALS_TILE];
+    for(unsigned long i0=0; i0<n; i0+=NORMALS_TILE){
+        unsigned long m = n - i0 < NORMALS_TILE ? n - i0 : NORMALS_TILE;
+        const double* v = u + i0;
+        double* res = out + i0;
+        if(accuracy == NormalAccuracy::fast){
+            // central region |u - 0.5| < 0.42 for every value
+            for(unsigned long k=0; k<m; ++k){
+                double x = v[k] - 0.5;
+                double y = x*x;
+                central[k] = x * (((moro_a[3] * y + moro_a[2]) * y + moro_a[1]) * y + moro_a[0]) /
+                                ((((moro_b[3] * y + moro_b[2]) * y + moro_b[1]) * y + moro_b[0]) * y + 1.0);
+            }
+            // tails, about 16% of uniform draws
+            for(unsigned long k=0; k<m; ++k){
+                double x = v[k];
+                res[k] = std::fabs(x - 0.5) < 0.42 ? central[k] : inv_cum_norm(x);
+            }
+        }else{
+            // central Acklam rational on min(u, 1-u) for every value
+            for(unsigned long k=0; k<m; ++k){
+                double p = v[k] > 0.5 ? 1.0 - v[k] : v[k];
+                double q = p - 0.5;
+                double r = q*q;
+                central[k] = (((((acklam_a[0] * r + acklam_a[1]) * r + acklam_a[2]) * r + acklam_a[3]) * r + acklam_a[4]) * r + acklam_a[5]) * q /
+                             (((((acklam_b[0] * r + acklam_b[1]) * r + acklam_b[2]) * r + acklam_b[3]) * r + acklam_b[4]) * r + 1.0);
+            }
+            // tails and refinement
+            for(unsigned long k=0; k<m; ++k){
+                bool upper = v[k] > 0.5;
+                double x = acklam_refined_lower(upper ? 1.0 - v[k] : v[k], central[k]);
+                res[k] = upper ? -x : x;
+            }
+        }
+    }
+}
+
+void cum_norm(const double* x, double* out, unsigned long n, NormalAccuracy accuracy)
+{
+    if(accuracy == NormalAccuracy::full){
+        for(unsigned long i=0; i<n; ++i)
+            out[i] = 0.5 * std::erfc(-x[i] * InvRoot2);
+        return;
+    }
+    
+    // Abramowitz-Stegun as cum_norm(double), the densities come from exp_array,
+    // so results can differ from the scalar version in the last bits
+    static const double a[5] = {0.319381530, -0.356563782, 1.781477937, -1.821255978, 1.330274429};
+    double density[NORMALS_TILE];
+    for(unsigned long i0=0; i0<n; i0+=NORMALS_TILE){
+        unsigned long m = n - i0 < NORMALS_TILE ? n - i0 : NORMALS_TILE;
+        const double* v = x + i0;
+        double* res = out + i0;
+        for(unsigned long k=0; k<m; ++k)
+            density[k] = -0.5 * v[k] * v[k];
+        exp_array(density, density, m);
+        for(unsigned long k=0; k<m; ++k){
+            double y = v[k];
+            double d = InvRoot2Pi * density[k];
+            double tmp = 1.0 / (1.0 + 0.2316419 * std::fabs(y));
+            double poly = tmp * (a[0] + tmp * (a[1] + tmp * (a[2] + tmp * (a[3] + tmp * a[4]))));
+            // lower tail probability of -|x|
+            double lower = std::fabs(y) > 7.0 ? d / std::sqrt(1.0 + y*y) : d * poly;
+            res[k] = y < 0.0 ? lower : 1.0 - lower;
+        }
+    }
+}
+
+void cum_norm(MJArray& values, NormalAccuracy accuracy)
+{
+    if(values.size()) cum_norm(&values[0], &values[0], values.size(), accuracy);
+}
+
+void inv_cum_norm(MJArray& values, NormalAccuracy accuracy)
+{
+    if(values.size()) inv_cum_norm(&values[0], &values[0], values.size(), accuracy);
+}
@@ -8,9 +8,26 @@
 #ifndef normals_hpp
 #define normals_hpp
 
+#include "mjarray.hpp"
+
 /*functions related to Gaussian/Normal distributions */
 double norm_density(double x);
 double cum_norm(double x);
 double inv_cum_norm(double x);
 
+/*array versions, element-wise over n values, in and out may point to the same array.
+ fast: the scalar approximations above, Beasley-Springer/Moro (about 3e-9 in x) and Abramowitz-Stegun (about 7.5e-8),
+       fast inv_cum_norm gives bit-identical results to the scalar one.
+ full: double precision, Acklam's approximation refined by a Halley step on erfc, and cum_norm by erfc.
+ The common branch is evaluated for all values in a branch-free loop the compiler can vectorize,
+ the few values in the tails are patched up by a second pass.
+ */
+enum class NormalAccuracy {fast, full};
+
+void cum_norm(const double* x, double* out, unsigned long n, NormalAccuracy accuracy=NormalAccuracy::fast);
+void inv_cum_norm(const double* u, double* out, unsigned long n, NormalAccuracy accuracy=NormalAccuracy::fast);
+// in place over the whole array
+void cum_norm(MJArray& values, NormalAccuracy accuracy=NormalAccuracy::fast);
+void inv_cum_norm(MJArray& values, NormalAccuracy accuracy=NormalAccuracy::fast);
+
 #endif /* normals_hpp */
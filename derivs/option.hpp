@@ -27,6 +27,7 @@ public:
     void set_time_to_exp(double time_to_exp){ttx = time_to_exp;}
     
     double payoff(double spot) const {return pf(spot);}
+    const PayoffBridge& get_payoff() const {return pf;}
     
 private:
     PayoffBridge pf;  // use PayoffBridge, we can rely on default big-fives to handle copy/move, used it just like built-in type
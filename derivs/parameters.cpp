@@ -6,3 +6,257 @@
 //
 
 #include "parameters.hpp"
+#include "aad.hpp"
+
+Number Parameters::integrate(double from_time, double to_time, const std::vector<Number>& knots) const
+{
+    return integral_number(integrate(from_time, to_time), knots, false, from_time, to_time);
+}
+
+Number Parameters::integrate_square(double from_time, double to_time, const std::vector<Number>& knots) const
+{
+    return integral_number(integrate_square(from_time, to_time), knots, true, from_time, to_time);
+}
+
+// the workspaces only grow, so recording integrals does not allocate once they have reached the number of knots
+Number Parameters::integral_number(double val, const std::vector<Number>& knots, bool square, double from_time, double to_time) const
+{
+    unsigned long n = p->num_knots();
+    if(knots.size() != n)
+        throw("Parameters: one Number per knot expected");
+    static thread_local std::vector<unsigned long> idx;
+    static thread_local std::vector<double> partials;
+    if(idx.size() < n){
+        idx.resize(n);
+        partials.resize(n);
+    }
+    unsigned long m = square ? p->integrate_square_gradient(from_time, to_time, idx.data(), partials.data())
+                             : p->integrate_gradient(from_time, to_time, idx.data(), partials.data());
+    for(unsigned long i=0; i<m; ++i)
+        idx[i] = knots[idx[i]].get_node(); // in place, entry i is read before it is written
+    unsigned long node = Tape::get_tape().record(idx.data(), partials.data(), m);
+    return Number(val, node);
+}
+
+void ParametersInner::integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    double t = from_time;
+    for(unsigned long j=0; j<n; ++j){
+        out[j] = integrate(t, grid[j]);
+        t = grid[j];
+    }
+}
+
+void ParametersInner::integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    double t = from_time;
+    for(unsigned long j=0; j<n; ++j){
+        out[j] = integrate_square(t, grid[j]);
+        t = grid[j];
+    }
+}
+
+namespace {
+void check_knots(const std::vector<double>& times, const std::vector<double>& values)
+{
+    if(times.empty() || times.size() != values.size())
+        throw("piecewise parameters need one value per time and at least one time");
+    if(times[0] < 0.0)
+        throw("piecewise parameters need nonnegative times");
+    for(unsigned long i=1; i<times.size(); ++i)
+        if(!(times[i] > times[i-1]))
+            throw("piecewise parameters need increasing times");
+}
+
+// appends a partial derivative, knots come in ascending order so a repeated knot is the last one
+void add_partial(unsigned long knot, double partial, unsigned long* knots, double* partials, unsigned long& m)
+{
+    if(m && knots[m-1] == knot){
+        partials[m-1] += partial;
+    }else{
+        knots[m] = knot;
+        partials[m++] = partial;
+    }
+}
+}
+
+ParametersPiecewiseConstant::ParametersPiecewiseConstant(const std::vector<double>& _times, const std::vector<double>& _values)
+: times(_times), values(_values), integrals(_times.size()), square_integrals(_times.size())
+{
+    check_knots(times, values);
+    integrals[0] = square_integrals[0] = 0.0;
+    for(unsigned long i=1; i<times.size(); ++i){
+        double dt = times[i-1] - start(i-1);
+        integrals[i] = integrals[i-1] + values[i-1] * dt;
+        square_integrals[i] = square_integrals[i-1] + values[i-1] * values[i-1] * dt;
+    }
+}
+
+unsigned long ParametersPiecewiseConstant::segment(double t) const
+{
+    unsigned long i = std::lower_bound(times.begin(), times.end(), t) - times.begin();
+    return i < times.size() ? i : times.size() - 1;
+}
+
+// the segment only moves forward along the grid
+void ParametersPiecewiseConstant::integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    unsigned long i = segment(from_time);
+    double prev = cumulative(from_time, i);
+    for(unsigned long j=0; j<n; ++j){
+        while(i + 1 < times.size() && times[i] < grid[j]) ++i;
+        double cur = cumulative(grid[j], i);
+        out[j] = cur - prev;
+        prev = cur;
+    }
+}
+
+void ParametersPiecewiseConstant::integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    unsigned long i = segment(from_time);
+    double prev = cumulative_square(from_time, i);
+    for(unsigned long j=0; j<n; ++j){
+        while(i + 1 < times.size() && times[i] < grid[j]) ++i;
+        double cur = cumulative_square(grid[j], i);
+        out[j] = cur - prev;
+        prev = cur;
+    }
+}
+
+// the integral over [from_time, to_time] is the sum of values[i] times the overlap with segment i
+unsigned long ParametersPiecewiseConstant::gradient(double from_time, double to_time, bool square, unsigned long* knots, double* partials) const
+{
+    double sign = to_time < from_time ? -1.0 : 1.0;
+    double a = std::min(from_time, to_time), b = std::max(from_time, to_time);
+    unsigned long last = segment(b);
+    unsigned long m = 0;
+    for(unsigned long i=segment(a); i<=last; ++i){
+        double lo = std::max(a, start(i));
+        double hi = i < last ? times[i] : b;
+        double overlap = sign * (hi - lo);
+        add_partial(i, square ? 2.0 * values[i] * overlap : overlap, knots, partials, m);
+    }
+    return m;
+}
+
+unsigned long ParametersPiecewiseConstant::integrate_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const
+{
+    return gradient(from_time, to_time, false, knots, partials);
+}
+
+unsigned long ParametersPiecewiseConstant::integrate_square_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const
+{
+    return gradient(from_time, to_time, true, knots, partials);
+}
+
+ParametersPiecewiseLinear::ParametersPiecewiseLinear(const std::vector<double>& _times, const std::vector<double>& _values)
+: times(_times), values(_values), integrals(_times.size()), square_integrals(_times.size())
+{
+    check_knots(times, values);
+    integrals[0] = values[0] * times[0];
+    square_integrals[0] = values[0] * values[0] * times[0];
+    for(unsigned long i=1; i<times.size(); ++i){
+        double h = times[i] - times[i-1];
+        double a = values[i-1], b = values[i];
+        integrals[i] = integrals[i-1] + h * (a + b) / 2.0;
+        square_integrals[i] = square_integrals[i-1] + h * (a * a + a * b + b * b) / 3.0;
+    }
+}
+
+// number of knots at or before t, less one
+unsigned long ParametersPiecewiseLinear::segment(double t) const
+{
+    unsigned long k = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    return k - 1; // wraps to NO_SEGMENT before the first knot
+}
+
+// in segment i, u = (t - times[i]) / h: f = a (1 - u) + b u and the integrals from times[i] are polynomials in u
+double ParametersPiecewiseLinear::cumulative(double t, unsigned long i, bool square) const
+{
+    unsigned long n = times.size();
+    if(i == NO_SEGMENT)
+        return (square ? values[0] * values[0] : values[0]) * t;
+    if(i == n - 1)
+        return square ? square_integrals[i] + values[i] * values[i] * (t - times[i])
+                      : integrals[i] + values[i] * (t - times[i]);
+    double h = times[i+1] - times[i];
+    double u = (t - times[i]) / h;
+    double a = values[i], b = values[i+1];
+    if(!square)
+        return integrals[i] + h * (a * (u - 0.5 * u * u) + 0.5 * b * u * u);
+    double u2 = u * u, u3 = u2 * u;
+    return square_integrals[i] + h * (a * a * (u - u2 + u3 / 3.0) + 2.0 * a * b * (0.5 * u2 - u3 / 3.0) + b * b * u3 / 3.0);
+}
+
+// the segment only moves forward along the grid
+void ParametersPiecewiseLinear::integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    unsigned long k = segment(from_time) + 1;
+    double prev = cumulative(from_time, k - 1, false);
+    for(unsigned long j=0; j<n; ++j){
+        while(k < times.size() && times[k] <= grid[j]) ++k;
+        double cur = cumulative(grid[j], k - 1, false);
+        out[j] = cur - prev;
+        prev = cur;
+    }
+}
+
+void ParametersPiecewiseLinear::integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const
+{
+    unsigned long k = segment(from_time) + 1;
+    double prev = cumulative(from_time, k - 1, true);
+    for(unsigned long j=0; j<n; ++j){
+        while(k < times.size() && times[k] <= grid[j]) ++k;
+        double cur = cumulative(grid[j], k - 1, true);
+        out[j] = cur - prev;
+        prev = cur;
+    }
+}
+
+// f is the sum of values[i] times the hat function of knot i (flat beyond the first and last knots),
+// the partials are integrals of the hat functions, of 2 f times them for the square
+unsigned long ParametersPiecewiseLinear::gradient(double from_time, double to_time, bool square, unsigned long* knots, double* partials) const
+{
+    double sign = to_time < from_time ? -1.0 : 1.0;
+    double a = std::min(from_time, to_time), b = std::max(from_time, to_time);
+    unsigned long n = times.size();
+    unsigned long m = 0;
+    if(a < times[0]){
+        double overlap = sign * (std::min(b, times[0]) - a);
+        add_partial(0, square ? 2.0 * values[0] * overlap : overlap, knots, partials, m);
+    }
+    // segments between knots overlapping [a, b]
+    unsigned long first = a < times[0] ? 0 : segment(a);
+    unsigned long last = b > times[0] ? std::min(segment(b), n - 1) : 0;
+    for(unsigned long i=first; b > times[0] && i<=last && i+1<n; ++i){
+        double h = times[i+1] - times[i];
+        double ua = (std::max(a, times[i]) - times[i]) / h;
+        double ub = (std::min(b, times[i+1]) - times[i]) / h;
+        double i1 = sign * h * (ub - ua);
+        double iu = sign * h * (ub * ub - ua * ua) / 2.0;
+        double iuu = sign * h * (ub * ub * ub - ua * ua * ua) / 3.0;
+        if(square){
+            double va = values[i], vb = values[i+1];
+            add_partial(i, 2.0 * va * (i1 - 2.0 * iu + iuu) + 2.0 * vb * (iu - iuu), knots, partials, m);
+            add_partial(i+1, 2.0 * va * (iu - iuu) + 2.0 * vb * iuu, knots, partials, m);
+        }else{
+            add_partial(i, i1 - iu, knots, partials, m);
+            add_partial(i+1, iu, knots, partials, m);
+        }
+    }
+    if(b > times[n-1]){
+        double overlap = sign * (b - std::max(a, times[n-1]));
+        add_partial(n-1, square ? 2.0 * values[n-1] * overlap : overlap, knots, partials, m);
+    }
+    return m;
+}
+
+unsigned long ParametersPiecewiseLinear::integrate_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const
+{
+    return gradient(from_time, to_time, false, knots, partials);
+}
+
+unsigned long ParametersPiecewiseLinear::integrate_square_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const
+{
+    return gradient(from_time, to_time, true, knots, partials);
+}
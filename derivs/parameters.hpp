@@ -14,6 +14,12 @@
  */
 
 #include <cmath>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "wrapper.hpp"
+
+class Number; // AAD, aad.hpp
 
 // base class, define interface, keep only minimal and generic interfaces
 class ParametersInner{
@@ -21,11 +27,25 @@ public:
     // base class stub
     ParametersInner(){}
     virtual ParametersInner* clone() const=0;
+    // copy into a buffer of size bytes, nullptr if not supported or not fitting (see clone_in_place)
+    virtual ParametersInner* clone_into(void*, std::size_t) const {return nullptr;}
     virtual ~ParametersInner(){};
     
     // base class interfaces
     virtual double integrate(double from_time, double to_time) const=0;
     virtual double integrate_square(double from_time, double to_time) const=0;
+    // integrals over the steps of an ascending grid: out[j] over [grid[j-1], grid[j]], with grid[-1] = from_time.
+    // default calls integrate for every step, piecewise parameters walk their knots along the grid in one pass
+    virtual void integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const;
+    virtual void integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const;
+    
+    // AAD: knots are the numbers the parameter is built from, integrals are differentiated in them.
+    // the gradient of an integral is sparse, the nonzero entries go to knots[m], partials[m] for m < the returned count,
+    // both arrays hold num_knots() entries. a parameter without knots is a constant to AAD
+    virtual unsigned long num_knots() const {return 0;}
+    virtual void get_knots(double*) const {}
+    virtual unsigned long integrate_gradient(double, double, unsigned long*, double*) const {return 0;}
+    virtual unsigned long integrate_square_gradient(double, double, unsigned long*, double*) const {return 0;}
     
 private:
     // no data members, define only minimal interfaces
@@ -36,34 +56,48 @@ class Parameters{
 public:
     // bridge stub
     // stub-constructor
-    Parameters(const ParametersInner& param){p = param.clone();}
-    Parameters():p(nullptr){}
+    // small inner objects are copied into the buffer of the bridge, no heap allocation
+    Parameters(const ParametersInner& param){copy_from(&param);}
+    Parameters():p(nullptr), in_place(false){}
     // stub-copy
-    Parameters(const Parameters& rhs){p = rhs.p->clone();}
+    Parameters(const Parameters& rhs){copy_from(rhs.p);}
     Parameters& operator=(const Parameters& rhs){
         if(this != &rhs){
-            delete p;
-            p = rhs.p->clone();
+            release();
+            copy_from(rhs.p);
         }
         return *this;
     }
-    // stub-move
-    Parameters(Parameters&& rhs){
-        p = rhs.p;
-        rhs.p = nullptr;
-    }
+    // stub-move, an inner object held in place is copied, one on the heap is taken over
+    Parameters(Parameters&& rhs){take_from(rhs);}
     Parameters& operator=(Parameters&& rhs){
-        delete p;
-        p = rhs.p;
-        rhs.p = nullptr;
+        if(this != &rhs){
+            release();
+            take_from(rhs);
+        }
         return *this;
     }
     // stub-destructor
-    ~Parameters(){delete p;}
+    ~Parameters(){release();}
     
     // bridge interfaces
     double integrate(double from_time, double to_time) const {return p->integrate(from_time, to_time);}
     double integrate_square(double from_time, double to_time) const {return p->integrate_square(from_time, to_time);}
+    void integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const {
+        p->integrate_grid(from_time, grid, n, out);
+    }
+    void integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const {
+        p->integrate_square_grid(from_time, grid, n, out);
+    }
+    unsigned long num_knots() const {return p->num_knots();}
+    std::vector<double> get_knots() const {
+        std::vector<double> values(num_knots());
+        p->get_knots(values.data());
+        return values;
+    }
+    // integrals recorded on the AAD tape, knots are Numbers for the values of get_knots
+    Number integrate(double from_time, double to_time, const std::vector<Number>& knots) const;
+    Number integrate_square(double from_time, double to_time, const std::vector<Number>& knots) const;
     
     // additional interfaces
     double mean(double from_time, double to_time) const {
@@ -74,7 +108,35 @@ public:
     }
     
 private:
+    Number integral_number(double val, const std::vector<Number>& knots, bool square, double from_time, double to_time) const;
+    void copy_from(const ParametersInner* inner){
+        p = inner ? inner->clone_into(buffer, BUFFER_SIZE) : nullptr;
+        in_place = p != nullptr;
+        if(inner && !p)
+            p = inner->clone();
+    }
+    void take_from(Parameters& rhs){
+        if(rhs.in_place){
+            copy_from(rhs.p);
+        }else{
+            p = rhs.p;
+            in_place = false;
+            rhs.p = nullptr;
+        }
+    }
+    void release(){
+        if(in_place)
+            p->~ParametersInner();
+        else
+            delete p;
+        p = nullptr;
+        in_place = false;
+    }
+    
+    static const std::size_t BUFFER_SIZE = 48;
     ParametersInner* p;
+    bool in_place;  // p lives in buffer
+    alignas(std::max_align_t) unsigned char buffer[BUFFER_SIZE];
 };
 
 
@@ -85,12 +147,27 @@ public:
     ParametersInner* clone() const override {
         return new ParametersConstant(*this);
     }
+    ParametersInner* clone_into(void* buffer, std::size_t size) const override {
+        return clone_in_place(*this, buffer, size);
+    }
     double integrate(double from_time, double to_time) const override {
         return c * (to_time - from_time);
     }
     double integrate_square(double from_time, double to_time) const override {
         return c2 * (to_time - from_time);
     }
+    unsigned long num_knots() const override {return 1;}
+    void get_knots(double* values) const override {values[0] = c;}
+    unsigned long integrate_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override {
+        knots[0] = 0;
+        partials[0] = to_time - from_time;
+        return 1;
+    }
+    unsigned long integrate_square_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override {
+        knots[0] = 0;
+        partials[0] = 2.0 * c * (to_time - from_time);
+        return 1;
+    }
     
 private:
     double c;
@@ -98,5 +175,81 @@ private:
 };
 
 
+// values[i] on (times[i-1], times[i]], times[-1] = 0, and values[n-1] after times[n-1].
+// integrals to each knot are kept, so integrate is a binary search and a few operations,
+// the knots are the values
+class ParametersPiecewiseConstant: public ParametersInner{
+public:
+    ParametersPiecewiseConstant(const std::vector<double>& _times, const std::vector<double>& _values);
+    ParametersInner* clone() const override {
+        return new ParametersPiecewiseConstant(*this);
+    }
+    double integrate(double from_time, double to_time) const override {
+        return cumulative(to_time, segment(to_time)) - cumulative(from_time, segment(from_time));
+    }
+    double integrate_square(double from_time, double to_time) const override {
+        return cumulative_square(to_time, segment(to_time)) - cumulative_square(from_time, segment(from_time));
+    }
+    void integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const override;
+    void integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const override;
+    
+    unsigned long num_knots() const override {return values.size();}
+    void get_knots(double* knots) const override {std::copy(values.begin(), values.end(), knots);}
+    unsigned long integrate_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override;
+    unsigned long integrate_square_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override;
+    
+private:
+    unsigned long segment(double t) const; // index of the value at t
+    double cumulative(double t, unsigned long i) const {
+        return integrals[i] + values[i] * (t - start(i));
+    }
+    double cumulative_square(double t, unsigned long i) const {
+        return square_integrals[i] + values[i] * values[i] * (t - start(i));
+    }
+    double start(unsigned long i) const {return i ? times[i-1] : 0.0;}
+    unsigned long gradient(double from_time, double to_time, bool square, unsigned long* knots, double* partials) const;
+    
+    std::vector<double> times;
+    std::vector<double> values;
+    std::vector<double> integrals; // integrals from 0 to the start of each segment
+    std::vector<double> square_integrals;
+};
+
+// linear between the knots (times[i], values[i]), flat outside them,
+// integrals to each knot are kept as for ParametersPiecewiseConstant, the knots are the values
+class ParametersPiecewiseLinear: public ParametersInner{
+public:
+    ParametersPiecewiseLinear(const std::vector<double>& _times, const std::vector<double>& _values);
+    ParametersInner* clone() const override {
+        return new ParametersPiecewiseLinear(*this);
+    }
+    double integrate(double from_time, double to_time) const override {
+        return cumulative(to_time, segment(to_time), false) - cumulative(from_time, segment(from_time), false);
+    }
+    double integrate_square(double from_time, double to_time) const override {
+        return cumulative(to_time, segment(to_time), true) - cumulative(from_time, segment(from_time), true);
+    }
+    void integrate_grid(double from_time, const double* grid, unsigned long n, double* out) const override;
+    void integrate_square_grid(double from_time, const double* grid, unsigned long n, double* out) const override;
+    
+    unsigned long num_knots() const override {return values.size();}
+    void get_knots(double* knots) const override {std::copy(values.begin(), values.end(), knots);}
+    unsigned long integrate_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override;
+    unsigned long integrate_square_gradient(double from_time, double to_time, unsigned long* knots, double* partials) const override;
+    
+private:
+    // segment i covers [times[i], times[i+1]], segment n-1 the times after the last knot,
+    // the times before the first knot are segment NO_SEGMENT
+    static const unsigned long NO_SEGMENT = ~0ul;
+    unsigned long segment(double t) const;
+    double cumulative(double t, unsigned long i, bool square) const;
+    unsigned long gradient(double from_time, double to_time, bool square, unsigned long* knots, double* partials) const;
+    
+    std::vector<double> times;
+    std::vector<double> values;
+    std::vector<double> integrals; // integrals from 0 to each knot
+    std::vector<double> square_integrals;
+};
+
 
 #endif /* parameters_hpp */
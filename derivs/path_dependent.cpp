@@ -6,4 +6,67 @@
 //
 
 #include "path_dependent.hpp"
+#include "aad.hpp"
 
+unsigned long PathDependent::CashFlows(const Number*, const Number*, Number*, unsigned long*) const
+{
+    throw("product not available to AAD");
+}
+
+unsigned long PathDependentAsian::CashFlows(const Number* spot_values, const Number* parameters, Number* amounts, unsigned long* time_idx) const
+{
+    Number sum = spot_values[0];
+    for(unsigned long j=1; j<num_times; ++j)
+        sum += spot_values[j];
+    time_idx[0] = 0UL;
+    amounts[0] = payoff(sum / static_cast<double>(num_times), parameters);
+    return 1UL;
+}
+
+unsigned long PathDependentGeometricAsian::CashFlows(const Number* spot_values, const Number* parameters, Number* amounts, unsigned long* time_idx) const
+{
+    Number log_sum = log(spot_values[0]);
+    for(unsigned long j=1; j<num_times; ++j)
+        log_sum += log(spot_values[j]);
+    time_idx[0] = 0UL;
+    amounts[0] = payoff(exp(log_sum / static_cast<double>(num_times)), parameters);
+    return 1UL;
+}
+
+void PathDependent::CashFlowsBatch(const MJArray& spot_block, unsigned long num_paths,
+                                   std::vector<CashFlow>& generated_flows, std::vector<unsigned long>& num_flows) const
+{
+    unsigned long num_times = lookat_times.size();
+    unsigned long max_flows = max_num_cashflows();
+    generated_flows.resize(num_paths * max_flows);
+    num_flows.resize(num_paths);
+    spot_values.resize(num_times);
+    flows.resize(max_flows);
+    for(unsigned long p=0; p<num_paths; ++p){
+        for(unsigned long j=0; j<num_times; ++j)
+            spot_values[j] = spot_block[j * num_paths + p];
+        num_flows[p] = CashFlows(spot_values, flows);
+        for(unsigned long i=0; i<num_flows[p]; ++i)
+            generated_flows[p * max_flows + i] = flows[i];
+    }
+}
+
+void PathDependentAsian::CashFlowsBatch(const MJArray& spot_block, unsigned long num_paths,
+                                        std::vector<CashFlow>& generated_flows, std::vector<unsigned long>& num_flows) const
+{
+    generated_flows.resize(num_paths);
+    num_flows.resize(num_paths);
+    // running sums over lookat times, the inner loop runs across paths on contiguous memory
+    sums.resize(num_paths);
+    sums = 0.0;
+    for(unsigned long j=0; j<num_times; ++j){
+        unsigned long offset = j * num_paths;
+        for(unsigned long p=0; p<num_paths; ++p)
+            sums[p] += spot_block[offset + p];
+    }
+    for(unsigned long p=0; p<num_paths; ++p){
+        generated_flows[p].time_idx = 0UL;
+        generated_flows[p].amount = payoff(sums[p] / num_times);
+        num_flows[p] = 1UL;
+    }
+}
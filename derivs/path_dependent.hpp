@@ -10,6 +10,7 @@
 
 #include "mjarray.hpp"
 #include <vector>
+#include <cmath>
 #include "payoff.hpp"
 
 struct CashFlow{
@@ -36,9 +37,30 @@ public:
     virtual unsigned long CashFlows(const MJArray& spot_values, std::vector<CashFlow>& generated_flows) const=0;
     virtual PathDependent* clone() const=0;
     
+    // cash flows for a block of num_paths paths, spot_block is time-major: spot_block[j * num_paths + p] is the spot of path p at lookat time j
+    // path p generates num_flows[p] flows stored at generated_flows[p * max_num_cashflows() + i]
+    // default falls back to CashFlows path by path, override to work on the whole block
+    virtual void CashFlowsBatch(const MJArray& spot_block, unsigned long num_paths,
+                                std::vector<CashFlow>& generated_flows, std::vector<unsigned long>& num_flows) const;
+    
+    // pathwise Greeks: derivatives of the flows CashFlows generates on spot_values, gradients[i * n + j] is
+    // d amount of flow i / d spot at lookat time j for n lookat times, gradients holds max_num_cashflows() * n values.
+    // products without them keep the defaults and get likelihood ratio Greeks
+    virtual bool has_cash_flow_gradients() const {return false;}
+    virtual void CashFlowGradients(const MJArray&, MJArray&) const {
+        throw("CashFlowGradients not provided by the product");
+    }
+    // AAD: the parameters of the product (strikes of its payoffs) and CashFlows on active spots and parameters,
+    // amounts[i] is paid at time_idx[i], both hold max_num_cashflows() entries
+    virtual unsigned long num_parameters() const {return 0;}
+    virtual void get_parameters(double*) const {}
+    virtual unsigned long CashFlows(const Number* spot_values, const Number* parameters, Number* amounts, unsigned long* time_idx) const; // throws unless overridden
+    
     virtual ~PathDependent(){}
 private:
     MJArray lookat_times;
+    mutable MJArray spot_values; // workspaces for CashFlowsBatch
+    mutable std::vector<CashFlow> flows;
 };
 
 class PathDependentAsian: public PathDependent{
@@ -58,15 +80,66 @@ public:
         generated_flows[0].amount = payoff(mean);
         return 1UL;
     }
+    void CashFlowsBatch(const MJArray& spot_block, unsigned long num_paths,
+                        std::vector<CashFlow>& generated_flows, std::vector<unsigned long>& num_flows) const override;
+    bool has_cash_flow_gradients() const override {return payoff.has_derivative();}
+    void CashFlowGradients(const MJArray& spot_values, MJArray& gradients) const override{
+        gradients = payoff.derivative(spot_values.sum() / num_times) / num_times;
+    }
+    unsigned long num_parameters() const override {return payoff.num_parameters();}
+    void get_parameters(double* values) const override {payoff.get_parameters(values);}
+    unsigned long CashFlows(const Number* spot_values, const Number* parameters, Number* amounts, unsigned long* time_idx) const override;
     PathDependent* clone() const override {return new PathDependentAsian(*this);}
     
 private:
     double delivery_time;
     PayoffBridge payoff;
     unsigned long num_times;
-    
+    mutable MJArray sums; // workspace for CashFlowsBatch
 };
 
 
+// geometric average, exp of the mean log spot; its call and put have closed forms (geometric_asian_call/put in BlackScholes.hpp),
+// which makes it a control variate for PathDependentAsian
+class PathDependentGeometricAsian: public PathDependent{
+public:
+    PathDependentGeometricAsian(const MJArray& _lookat_times, double _delivery_time, const PayoffBridge& _payoff): PathDependent(_lookat_times),
+    delivery_time(_delivery_time), payoff(_payoff), num_times(_lookat_times.size()){}
+    
+    unsigned long max_num_cashflows() const override {return 1UL;}
+    MJArray all_possible_times() const override {
+        MJArray tmp(1UL);
+        tmp[0] = delivery_time;
+        return tmp;
+    }
+    unsigned long CashFlows(const MJArray& spot_values, std::vector<CashFlow>& generated_flows) const override{
+        double log_sum = 0.0;
+        for(unsigned long j=0; j<num_times; ++j)
+            log_sum += std::log(spot_values[j]);
+        generated_flows[0].time_idx = 0UL;
+        generated_flows[0].amount = payoff(std::exp(log_sum / num_times));
+        return 1UL;
+    }
+    bool has_cash_flow_gradients() const override {return payoff.has_derivative();}
+    void CashFlowGradients(const MJArray& spot_values, MJArray& gradients) const override{
+        double log_sum = 0.0;
+        for(unsigned long j=0; j<num_times; ++j)
+            log_sum += std::log(spot_values[j]);
+        double average = std::exp(log_sum / num_times);
+        double slope = payoff.derivative(average) * average / num_times;
+        for(unsigned long j=0; j<num_times; ++j)
+            gradients[j] = slope / spot_values[j];
+    }
+    unsigned long num_parameters() const override {return payoff.num_parameters();}
+    void get_parameters(double* values) const override {payoff.get_parameters(values);}
+    unsigned long CashFlows(const Number* spot_values, const Number* parameters, Number* amounts, unsigned long* time_idx) const override;
+    PathDependent* clone() const override {return new PathDependentGeometricAsian(*this);}
+    
+private:
+    double delivery_time;
+    PayoffBridge payoff;
+    unsigned long num_times;
+};
+
 
 #endif /* path_dependent_hpp */
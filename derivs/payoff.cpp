@@ -6,3 +6,39 @@
 //
 
 #include "payoff.hpp"
+#include "aad.hpp"
+
+Number Payoff::operator()(const Number&, const Number*) const
+{
+    throw("payoff not available to AAD");
+}
+
+Number PayoffBridge::operator()(const Number& spot, const Number* parameters) const
+{
+    return (*payoffptr)(spot, parameters);
+}
+
+Number CallPayoff::operator()(const Number& spot, const Number* parameters) const
+{
+    return spot > parameters[0] ? spot - parameters[0] : Number(0.0);
+}
+
+Number PutPayoff::operator()(const Number& spot, const Number* parameters) const
+{
+    return spot < parameters[0] ? parameters[0] - spot : Number(0.0);
+}
+
+Number ForwardPayoff::operator()(const Number& spot, const Number* parameters) const
+{
+    return spot - parameters[0];
+}
+
+Number DigitalCallPayoff::operator()(const Number& spot, const Number* parameters) const
+{
+    return Number(spot > parameters[0] ? 1.0 : 0.0);
+}
+
+Number SpreadPayoff::operator()(const Number& spot, const Number* parameters) const
+{
+    return volume1 * (*opt1)(spot, parameters) + volume2 * (*opt2)(spot, parameters + opt1->num_parameters());
+}
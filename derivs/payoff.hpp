@@ -9,10 +9,13 @@
 #define payoff_hpp
 
 #include <utility>
+#include <cstddef>
 #include "arglist.hpp"
 #include "wrapper.hpp"
 #include "factory.hpp"
 
+class Number; // AAD, aad.hpp
+
 /* Payoff is a function of spot at expiry, may depend on other paramters like strikes, barrier levels,
  Payoff does not know any concepts of time, discounting, etc. It only factors out functional forms
  */
@@ -22,8 +25,23 @@ class Payoff {
 public:
     Payoff(){};
     virtual double operator()(double spot) const=0;
+    // payoffs of n spots in one call, for lattices that value a whole row of nodes at once
+    virtual void values(const double* spots, unsigned long n, double* out) const {
+        for(unsigned long i=0; i<n; ++i)
+            out[i] = (*this)(spots[i]);
+    }
+    // derivative in spot for pathwise Greeks, only needed almost everywhere so kinks are fine,
+    // payoffs with jumps keep the default and are left to likelihood ratio Greeks
+    virtual bool has_derivative() const {return false;}
+    virtual double derivative(double) const {return 0.0;}
+    // AAD: parameters are the numbers the payoff is built from (strikes), the active payoff takes them as Numbers
+    virtual unsigned long num_parameters() const {return 0;}
+    virtual void get_parameters(double*) const {}
+    virtual Number operator()(const Number& spot, const Number* parameters) const; // throws unless overridden
     
     virtual Payoff* clone() const=0;
+    // copy into a buffer of size bytes, nullptr if not supported or not fitting (see clone_in_place)
+    virtual Payoff* clone_into(void*, std::size_t) const {return nullptr;}
     virtual ~Payoff(){};
 };
 
@@ -31,40 +49,70 @@ public:
 // Payoff bridge, factor out memory handling (big fives) codes for external classes, so any class using Payoff* can move/copy around its concrete derived Payoff classes. Memory management of entire concrete Payoff classes
 class PayoffBridge {
 public:
-    PayoffBridge(const Payoff& payoff){payoffptr = payoff.clone();}  // implicitly convert from Payoff class
-    PayoffBridge():payoffptr(nullptr){} // default constructor
+    // small payoffs are copied into the buffer of the bridge, no heap allocation
+    PayoffBridge(const Payoff& payoff){copy_from(&payoff);}  // implicitly convert from Payoff class
+    PayoffBridge():payoffptr(nullptr), in_place(false){} // default constructor
     // copy
-    PayoffBridge(const PayoffBridge& rhs){payoffptr = rhs.payoffptr->clone();}
+    PayoffBridge(const PayoffBridge& rhs){copy_from(rhs.payoffptr);}
     PayoffBridge& operator=(const PayoffBridge& rhs){
         if(this != &rhs){
-            delete payoffptr;
-            payoffptr = rhs.payoffptr->clone();
+            release();
+            copy_from(rhs.payoffptr);
         }
         return *this;
     }
-    // move
-    PayoffBridge(PayoffBridge&& rhs){
-        payoffptr = rhs.payoffptr;
-        rhs.payoffptr = nullptr;
-    }
+    // move, a payoff held in place is copied, one on the heap is taken over
+    PayoffBridge(PayoffBridge&& rhs){take_from(rhs);}
     PayoffBridge& operator=(PayoffBridge&& rhs){
-        PayoffBridge tmp;
-        std::swap<PayoffBridge>(*this, tmp);
-        this->payoffptr = rhs.payoffptr;
-        rhs.payoffptr = nullptr;
+        if(this != &rhs){
+            release();
+            take_from(rhs);
+        }
         return *this;
     }
     // destructor
-    ~PayoffBridge(){delete payoffptr;};
+    ~PayoffBridge(){release();};
     
     double operator()(double spot) const {return (*payoffptr)(spot);}
+    void values(const double* spots, unsigned long n, double* out) const {payoffptr->values(spots, n, out);}
+    bool has_derivative() const {return payoffptr->has_derivative();}
+    double derivative(double spot) const {return payoffptr->derivative(spot);}
+    unsigned long num_parameters() const {return payoffptr->num_parameters();}
+    void get_parameters(double* values) const {payoffptr->get_parameters(values);}
+    Number operator()(const Number& spot, const Number* parameters) const;
     
 private:
+    void copy_from(const Payoff* payoff){
+        payoffptr = payoff ? payoff->clone_into(buffer, BUFFER_SIZE) : nullptr;
+        in_place = payoffptr != nullptr;
+        if(payoff && !payoffptr)
+            payoffptr = payoff->clone();
+    }
+    void take_from(PayoffBridge& rhs){
+        if(rhs.in_place){
+            copy_from(rhs.payoffptr);
+        }else{
+            payoffptr = rhs.payoffptr;
+            in_place = false;
+            rhs.payoffptr = nullptr;
+        }
+    }
+    void release(){
+        if(in_place)
+            payoffptr->~Payoff();
+        else
+            delete payoffptr;
+        payoffptr = nullptr;
+        in_place = false;
+    }
+    
+    static const std::size_t BUFFER_SIZE = 32;
     Payoff* payoffptr;
+    bool in_place;  // payoffptr lives in buffer
+    alignas(std::max_align_t) unsigned char buffer[BUFFER_SIZE];
 };
 
 
-
 // derived classes, strictly speaking base and derived classes are still different types
 class CallPayoff: public Payoff {
 public:
@@ -78,13 +126,26 @@ public:
         args.check_all_used("CallPayoff");
     }
     CallPayoff(double strike):k(strike){}
-    double operator()(double spot) const override {
+    double operator()(double spot) const final {
         return spot > k ? spot - k : 0.0;
     }
+    void values(const double* spots, unsigned long n, double* out) const override {
+        for(unsigned long i=0; i<n; ++i)
+            out[i] = spots[i] > k ? spots[i] - k : 0.0;
+    }
+    bool has_derivative() const override {return true;}
+    double derivative(double spot) const override {return spot > k ? 1.0 : 0.0;}
+    
+    unsigned long num_parameters() const override {return 1;}
+    void get_parameters(double* values) const override {values[0] = k;}
+    Number operator()(const Number& spot, const Number* parameters) const override;
     
     Payoff* clone() const override {
         return new CallPayoff(*this);
     }
+    Payoff* clone_into(void* buffer, std::size_t size) const override {
+        return clone_in_place(*this, buffer, size);
+    }
     
     double get_strike() const {return k;}
     void set_strike(double strike) {k = strike;}
@@ -103,13 +164,26 @@ public:
         args.check_all_used("PutPayoff");
     }
     PutPayoff(double strike):k(strike){}
-    double operator()(double spot) const override{
+    double operator()(double spot) const final {
         return spot < k ? k - spot : 0.0;
     }
+    void values(const double* spots, unsigned long n, double* out) const override {
+        for(unsigned long i=0; i<n; ++i)
+            out[i] = spots[i] < k ? k - spots[i] : 0.0;
+    }
+    bool has_derivative() const override {return true;}
+    double derivative(double spot) const override {return spot < k ? -1.0 : 0.0;}
+    
+    unsigned long num_parameters() const override {return 1;}
+    void get_parameters(double* values) const override {values[0] = k;}
+    Number operator()(const Number& spot, const Number* parameters) const override;
     
     Payoff* clone() const override {
         return new PutPayoff(*this);
     }
+    Payoff* clone_into(void* buffer, std::size_t size) const override {
+        return clone_in_place(*this, buffer, size);
+    }
     
     double get_strike() const {return k;}
     void set_strike(double strike){k = strike;}
@@ -129,12 +203,59 @@ public:
         args.check_all_used("ForwardPayoff");
     }
     ForwardPayoff(double strike):k(strike){}
-    double operator()(double spot) const override{
+    double operator()(double spot) const final {
         return spot - k;
     }
+    void values(const double* spots, unsigned long n, double* out) const override {
+        for(unsigned long i=0; i<n; ++i)
+            out[i] = spots[i] - k;
+    }
+    bool has_derivative() const override {return true;}
+    double derivative(double) const override {return 1.0;}
+    unsigned long num_parameters() const override {return 1;}
+    void get_parameters(double* values) const override {values[0] = k;}
+    Number operator()(const Number& spot, const Number* parameters) const override;
+    
     Payoff* clone() const override{
         return new ForwardPayoff(*this);
     }
+    Payoff* clone_into(void* buffer, std::size_t size) const override {
+        return clone_in_place(*this, buffer, size);
+    }
+    
+    double get_strike() const {return k;}
+    
+private:
+    double k;
+};
+
+
+// pays 1 above the strike, the jump leaves it without a usable derivative
+class DigitalCallPayoff: public Payoff {
+public:
+    DigitalCallPayoff(ArgumentList args){
+        if(args.get_struct_name() != "payoff")
+            throw("payoff structure expected in DigitalCallPayoff class");
+        if(args.get_str_arg_val("name") != "digitalcall")
+            throw("payoff list not for digital call passed to DigitalCallPayoff : got " + args.get_str_arg_val("name"));
+        k = args.get_double_arg_val("strike");
+        args.check_all_used("DigitalCallPayoff");
+    }
+    DigitalCallPayoff(double strike):k(strike){}
+    double operator()(double spot) const final {
+        return spot > k ? 1.0 : 0.0;
+    }
+    unsigned long num_parameters() const override {return 1;}
+    void get_parameters(double* values) const override {values[0] = k;}
+    // the jump is invisible to AAD, its derivatives are 0 (likelihood ratio Greeks handle it, see run_simulation_greeks)
+    Number operator()(const Number& spot, const Number* parameters) const override;
+    
+    Payoff* clone() const override{
+        return new DigitalCallPayoff(*this);
+    }
+    Payoff* clone_into(void* buffer, std::size_t size) const override {
+        return clone_in_place(*this, buffer, size);
+    }
     
     double get_strike() const {return k;}
     
@@ -170,6 +291,17 @@ public:
     double operator()(double spot) const override{
         return volume1 * (*opt1)(spot) + volume2 * (*opt2)(spot);
     }
+    bool has_derivative() const override {return opt1->has_derivative() && opt2->has_derivative();}
+    double derivative(double spot) const override {
+        return volume1 * opt1->derivative(spot) + volume2 * opt2->derivative(spot);
+    }
+    // the parameters of the first payoff followed by those of the second
+    unsigned long num_parameters() const override {return opt1->num_parameters() + opt2->num_parameters();}
+    void get_parameters(double* values) const override {
+        opt1->get_parameters(values);
+        opt2->get_parameters(values + opt1->num_parameters());
+    }
+    Number operator()(const Number& spot, const Number* parameters) const override;
     Payoff* clone() const override{
         return new SpreadPayoff(*this);
     }
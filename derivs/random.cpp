@@ -13,9 +13,26 @@
 
 void RandomBase::get_gaussians(MJArray &variates){
     get_uniforms(variates);
-    for(unsigned long i=0; i<dim; ++i){
-        double x = variates[i];
-        variates[i] = inv_cum_norm(x);
+    inv_cum_norm(&variates[0], &variates[0], dim, accuracy);
+}
+
+void RandomBase::get_gaussian_block(MJArray& variates, unsigned long num_paths){
+    // same stream as num_paths calls to get_gaussians, only re-arranged,
+    // paths are drawn a few at a time so that each time row is written in contiguous pieces
+    const unsigned long tile = 8;
+    variates.resize(dim * num_paths);
+    one_path.resize(dim);
+    tile_paths.resize(dim * tile);
+    for(unsigned long p0=0; p0<num_paths; p0+=tile){
+        unsigned long n = num_paths - p0 < tile ? num_paths - p0 : tile;
+        for(unsigned long q=0; q<n; ++q){
+            get_gaussians(one_path);
+            for(unsigned long j=0; j<dim; ++j)
+                tile_paths[j * tile + q] = one_path[j];
+        }
+        for(unsigned long j=0; j<dim; ++j)
+            for(unsigned long q=0; q<n; ++q)
+                variates[j * num_paths + p0 + q] = tile_paths[j * tile + q];
     }
 }
 
@@ -46,6 +63,19 @@ long ParkMiller::get_one_integer(){
     return seed;
 }
 
+// seed after n draws is A^n * seed mod M, A^n by repeated squaring, products of two numbers below 2^31 fit in 64 bits
+void ParkMiller::skip(unsigned long num_draws){
+    unsigned long long result = static_cast<unsigned long long>(seed);
+    unsigned long long base = PM_A;
+    while(num_draws > 0){
+        if(num_draws & 1)
+            result = result * base % PM_M;
+        base = base * base % PM_M;
+        num_draws >>= 1;
+    }
+    seed = static_cast<long>(result);
+}
+
 
 
 double get_one_uniform(double lower, double upper){
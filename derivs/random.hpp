@@ -17,10 +17,11 @@
  */
 
 #include "mjarray.hpp"
+#include "normals.hpp"
 
 class RandomBase{
 public:
-    RandomBase(unsigned long _dim):dim(_dim){};
+    RandomBase(unsigned long _dim):dim(_dim), accuracy(NormalAccuracy::fast){};
     virtual ~RandomBase(){};
     
     // must implement
@@ -32,14 +33,22 @@ public:
     
     // provide sensible defaults
     virtual void get_gaussians(MJArray& variates);
+    // draws for num_paths paths in one go, laid out time-major: variates[j * num_paths + p] is variate j of path p
+    virtual void get_gaussian_block(MJArray& variates, unsigned long num_paths);
     virtual void reset_dim(unsigned long new_dim){dim = new_dim;}
     
     unsigned long get_dim() const {return dim;}
+    // accuracy of the inverse normal used by get_gaussians
+    virtual void set_normal_accuracy(NormalAccuracy _accuracy){accuracy = _accuracy;}
+    NormalAccuracy get_normal_accuracy() const {return accuracy;}
     
     
     
 private:
     unsigned long dim; // the number of independent random numbers needed for one-go (i.e., simulating one-path)
+    NormalAccuracy accuracy;
+    MJArray one_path;   // workspaces for get_gaussian_block
+    MJArray tile_paths;
 };
 
 //Park Miller the minimal standard generator, a linear congruential generator and adapter pattern
@@ -48,6 +57,7 @@ public:
     ParkMiller(long _seed=1);
     long get_one_integer();
     void set_seed(long _seed);
+    void skip(unsigned long num_draws); // same as num_draws calls to get_one_integer, in O(log num_draws)
     
     static unsigned long Max();
     static unsigned long Min();
@@ -65,15 +75,13 @@ public:
         reciprocal = 1 / (1.0 + inner_generator.Max());
     }
     RandomBase* clone() const override {return new RandomParkMiller(*this);}
-    void get_uniforms(MJArray& variates) override {
+    void get_uniforms(MJArray& variates) final {
         for(unsigned long i=0; i<get_dim(); ++i)
             variates[i] = inner_generator.get_one_integer() * reciprocal;
     }
     
     void skip(unsigned long num_of_paths) override {
-        // draw num of runs, and throw them away
-        MJArray tmp(get_dim());
-        for(unsigned long i=0; i<num_of_paths; ++i) get_uniforms(tmp);
+        inner_generator.skip(num_of_paths * get_dim());
     }
     void set_seed(unsigned long _seed) override {
         init_seed = _seed;
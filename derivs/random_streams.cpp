@@ -0,0 +1,245 @@
+//
+//  random_streams.cpp
+//  derivs
+//
+//  Created by Xin Li on 3/27/22.
+//
+
+#include "random_streams.hpp"
+
+namespace {
+
+// expands one seed into well mixed words, used to fill generator states from a single seed
+std::uint64_t splitmix64(std::uint64_t& x)
+{
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Philox constants
+constexpr std::uint32_t PHILOX_M0 = 0xD2511F53;
+constexpr std::uint32_t PHILOX_M1 = 0xCD9E8D57;
+constexpr std::uint32_t PHILOX_W0 = 0x9E3779B9;
+constexpr std::uint32_t PHILOX_W1 = 0xBB67AE85;
+constexpr double TWO_POW_M32 = 1.0 / 4294967296.0;
+
+// MRG32k3a constants
+constexpr std::uint64_t MRG_M1 = 4294967087ULL;
+constexpr std::uint64_t MRG_M2 = 4294944443ULL;
+constexpr std::uint64_t MRG_A12 = 1403580ULL;
+constexpr std::uint64_t MRG_A13N = 810728ULL;
+constexpr std::uint64_t MRG_A21 = 527612ULL;
+constexpr std::uint64_t MRG_A23N = 1370589ULL;
+constexpr double MRG_NORM = 1.0 / (MRG_M1 + 1.0);
+
+typedef std::uint64_t Matrix3[3][3];
+
+// entries are below m < 2^32, so a product fits in 64 bits
+void mat_mult_mod(const Matrix3& a, const Matrix3& b, std::uint64_t m, Matrix3& c)
+{
+    Matrix3 tmp;
+    for(int i=0; i<3; ++i)
+        for(int j=0; j<3; ++j){
+            std::uint64_t sum = 0;
+            for(int k=0; k<3; ++k)
+                sum = (sum + (a[i][k] * b[k][j]) % m) % m;
+            tmp[i][j] = sum;
+        }
+    for(int i=0; i<3; ++i)
+        for(int j=0; j<3; ++j)
+            c[i][j] = tmp[i][j];
+}
+
+void mat_vec_mod(const Matrix3& a, std::uint64_t v[3], std::uint64_t m)
+{
+    std::uint64_t tmp[3];
+    for(int i=0; i<3; ++i){
+        std::uint64_t sum = 0;
+        for(int k=0; k<3; ++k)
+            sum = (sum + (a[i][k] * v[k]) % m) % m;
+        tmp[i] = sum;
+    }
+    for(int i=0; i<3; ++i)
+        v[i] = tmp[i];
+}
+
+// a^n mod m by repeated squaring
+void mat_pow_mod(const Matrix3& a, std::uint64_t n, std::uint64_t m, Matrix3& result)
+{
+    Matrix3 base;
+    for(int i=0; i<3; ++i)
+        for(int j=0; j<3; ++j){
+            base[i][j] = a[i][j];
+            result[i][j] = (i == j) ? 1 : 0;
+        }
+    while(n > 0){
+        if(n & 1)
+            mat_mult_mod(result, base, m, result);
+        mat_mult_mod(base, base, m, base);
+        n >>= 1;
+    }
+}
+
+// one step of each recursion as a matrix acting on the state (x_{n-3}, x_{n-2}, x_{n-1})
+const Matrix3 MRG_A1 = {
+    {0, 1, 0},
+    {0, 0, 1},
+    {MRG_M1 - MRG_A13N, MRG_A12, 0}
+};
+const Matrix3 MRG_A2 = {
+    {0, 1, 0},
+    {0, 0, 1},
+    {MRG_M2 - MRG_A23N, 0, MRG_A21}
+};
+
+}
+
+void Philox4x32::generate(const Block& counter, std::uint32_t key0, std::uint32_t key1, Block& out)
+{
+    std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    for(int round=0; round<10; ++round){
+        std::uint64_t p0 = static_cast<std::uint64_t>(PHILOX_M0) * c0;
+        std::uint64_t p1 = static_cast<std::uint64_t>(PHILOX_M1) * c2;
+        std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32), lo0 = static_cast<std::uint32_t>(p0);
+        std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32), lo1 = static_cast<std::uint32_t>(p1);
+        c0 = hi1 ^ c1 ^ key0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ key1;
+        c3 = lo0;
+        key0 += PHILOX_W0;
+        key1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+RandomPhilox::RandomPhilox(unsigned long _dim, unsigned long _seed, unsigned long _stream)
+: RandomBase(_dim), seed(_seed), stream(_stream), path(0)
+{
+}
+
+void RandomPhilox::get_uniforms(MJArray& variates)
+{
+    // key: (seed low word, stream), counter: (path low word, path high word, block of 4 draws, seed high word)
+    std::uint32_t key0 = static_cast<std::uint32_t>(seed);
+    std::uint32_t key1 = static_cast<std::uint32_t>(stream);
+    Philox4x32::Block counter = {
+        static_cast<std::uint32_t>(path),
+        static_cast<std::uint32_t>(path >> 32),
+        0,
+        static_cast<std::uint32_t>(static_cast<std::uint64_t>(seed) >> 32)
+    };
+    Philox4x32::Block out;
+    unsigned long dim = get_dim();
+    for(unsigned long i=0; i<dim; i+=4){
+        Philox4x32::generate(counter, key0, key1, out);
+        for(unsigned long k=0; k<4 && i+k<dim; ++k)
+            variates[i+k] = (out[k] + 0.5) * TWO_POW_M32; // open interval (0, 1)
+        counter[2]++;
+    }
+    path++;
+}
+
+void RandomPhilox::set_seed(unsigned long _seed)
+{
+    seed = _seed;
+    reset();
+}
+
+void RandomPhilox::set_stream(unsigned long _stream)
+{
+    stream = _stream;
+    reset();
+}
+
+MRG32k3a::MRG32k3a(unsigned long _seed)
+{
+    set_seed(_seed);
+}
+
+void MRG32k3a::set_seed(unsigned long _seed)
+{
+    // each component state must be below its modulus and not all zero
+    std::uint64_t x = _seed;
+    do{
+        for(int i=0; i<3; ++i)
+            s1[i] = splitmix64(x) % MRG_M1;
+    }while(s1[0] == 0 && s1[1] == 0 && s1[2] == 0);
+    do{
+        for(int i=0; i<3; ++i)
+            s2[i] = splitmix64(x) % MRG_M2;
+    }while(s2[0] == 0 && s2[1] == 0 && s2[2] == 0);
+}
+
+double MRG32k3a::get_one_uniform()
+{
+    // differences of products below 2^53 in magnitude, exact in signed 64 bits
+    std::int64_t q1 = static_cast<std::int64_t>(MRG_A12 * s1[1]) - static_cast<std::int64_t>(MRG_A13N * s1[0]);
+    q1 %= static_cast<std::int64_t>(MRG_M1);
+    std::uint64_t p1 = q1 < 0 ? q1 + MRG_M1 : q1;
+    s1[0] = s1[1];
+    s1[1] = s1[2];
+    s1[2] = p1;
+    std::int64_t q2 = static_cast<std::int64_t>(MRG_A21 * s2[2]) - static_cast<std::int64_t>(MRG_A23N * s2[0]);
+    q2 %= static_cast<std::int64_t>(MRG_M2);
+    std::uint64_t p2 = q2 < 0 ? q2 + MRG_M2 : q2;
+    s2[0] = s2[1];
+    s2[1] = s2[2];
+    s2[2] = p2;
+    // p1 == p2 would give 0, map it to m1 as in L'Ecuyer's reference implementation, so draws stay in (0, 1)
+    return (p1 > p2 ? (p1 - p2) : (p1 + MRG_M1 - p2)) * MRG_NORM;
+}
+
+void MRG32k3a::skip(std::uint64_t num_draws)
+{
+    if(num_draws == 0) return;
+    Matrix3 a1, a2;
+    mat_pow_mod(MRG_A1, num_draws, MRG_M1, a1);
+    mat_pow_mod(MRG_A2, num_draws, MRG_M2, a2);
+    mat_vec_mod(a1, s1, MRG_M1);
+    mat_vec_mod(a2, s2, MRG_M2);
+}
+
+void MRG32k3a::skip_streams(std::uint64_t num_streams)
+{
+    if(num_streams == 0) return;
+    // A^(2^127) by 127 squarings, then raised to num_streams
+    Matrix3 a1, a2;
+    mat_pow_mod(MRG_A1, 1, MRG_M1, a1);
+    mat_pow_mod(MRG_A2, 1, MRG_M2, a2);
+    for(int i=0; i<127; ++i){
+        mat_mult_mod(a1, a1, MRG_M1, a1);
+        mat_mult_mod(a2, a2, MRG_M2, a2);
+    }
+    mat_pow_mod(a1, num_streams, MRG_M1, a1);
+    mat_pow_mod(a2, num_streams, MRG_M2, a2);
+    mat_vec_mod(a1, s1, MRG_M1);
+    mat_vec_mod(a2, s2, MRG_M2);
+}
+
+RandomMRG32k3a::RandomMRG32k3a(unsigned long _dim, unsigned long _seed, unsigned long _stream)
+: RandomBase(_dim), inner_generator(_seed), stream_start(_seed), seed(_seed), stream(_stream)
+{
+    stream_start.skip_streams(stream);
+    inner_generator = stream_start;
+}
+
+void RandomMRG32k3a::set_seed(unsigned long _seed)
+{
+    seed = _seed;
+    stream_start.set_seed(seed);
+    stream_start.skip_streams(stream);
+    inner_generator = stream_start;
+}
+
+void RandomMRG32k3a::set_stream(unsigned long _stream)
+{
+    stream = _stream;
+    stream_start.set_seed(seed);
+    stream_start.skip_streams(stream);
+    inner_generator = stream_start;
+}
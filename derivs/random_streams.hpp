@@ -0,0 +1,96 @@
+//
+//  random_streams.hpp
+//  derivs
+//
+//  Created by Xin Li on 3/27/22.
+//
+
+#ifndef random_streams_hpp
+#define random_streams_hpp
+
+/*random number generators with cheap skip-ahead and independent streams keyed by (seed, stream id),
+ so that parallel or distributed runs can jump straight to their own substream:
+ 1) Philox4x32-10, a counter-based generator: the draws are a keyed bijection of a counter, skip is O(1)
+ 2) MRG32k3a, L'Ecuyer's combined multiple recursive generator: skip by powers of its transition matrices, O(log n),
+    streams start 2^127 draws apart, period about 2^191
+ */
+
+#include <cstdint>
+#include "random.hpp"
+
+// Philox4x32 with 10 rounds (Salmon, Moraes, Dror, Shaw, "Parallel random numbers: as easy as 1, 2, 3")
+class Philox4x32{
+public:
+    typedef std::uint32_t Block[4];
+    // 4 random words from a 4-word counter and a 2-word key
+    static void generate(const Block& counter, std::uint32_t key0, std::uint32_t key1, Block& out);
+};
+
+// adapt Philox4x32 to RandomBase, path i of stream (seed, stream) is drawn from counters (i, block, seed_high),
+// so any path can be drawn without touching the ones before it
+class RandomPhilox: public RandomBase{
+public:
+    RandomPhilox(unsigned long _dim, unsigned long _seed=1, unsigned long _stream=0);
+    RandomBase* clone() const override {return new RandomPhilox(*this);}
+    void get_uniforms(MJArray& variates) override;
+    void skip(unsigned long num_of_paths) override {path += num_of_paths;}
+    void set_seed(unsigned long _seed) override;
+    void reset() override {path = 0;}
+    void reset_dim(unsigned long new_dim) override {
+        RandomBase::reset_dim(new_dim);
+        reset();
+    }
+    
+    void set_stream(unsigned long _stream);
+    unsigned long get_stream() const {return stream;}
+    
+private:
+    unsigned long seed;
+    unsigned long stream;
+    std::uint64_t path; // index of the next path in the stream
+};
+
+// MRG32k3a, two 3rd order recursions modulo m1 and m2 combined
+class MRG32k3a{
+public:
+    MRG32k3a(unsigned long _seed=1);
+    double get_one_uniform();  // in (0, 1)
+    void set_seed(unsigned long _seed);
+    void skip(std::uint64_t num_draws);  // O(log num_draws)
+    void skip_streams(std::uint64_t num_streams);  // num_streams * 2^127 draws
+    
+private:
+    std::uint64_t s1[3];
+    std::uint64_t s2[3];
+};
+
+// adapt MRG32k3a to RandomBase, stream k of a seed starts k * 2^127 draws into the sequence
+class RandomMRG32k3a: public RandomBase{
+public:
+    RandomMRG32k3a(unsigned long _dim, unsigned long _seed=1, unsigned long _stream=0);
+    RandomBase* clone() const override {return new RandomMRG32k3a(*this);}
+    void get_uniforms(MJArray& variates) override {
+        for(unsigned long i=0; i<get_dim(); ++i)
+            variates[i] = inner_generator.get_one_uniform();
+    }
+    void skip(unsigned long num_of_paths) override {
+        inner_generator.skip(static_cast<std::uint64_t>(num_of_paths) * get_dim());
+    }
+    void set_seed(unsigned long _seed) override;
+    void reset() override {inner_generator = stream_start;}
+    void reset_dim(unsigned long new_dim) override {
+        RandomBase::reset_dim(new_dim);
+        reset();
+    }
+    
+    void set_stream(unsigned long _stream);
+    unsigned long get_stream() const {return stream;}
+    
+private:
+    MRG32k3a inner_generator;
+    MRG32k3a stream_start;
+    unsigned long seed;
+    unsigned long stream;
+};
+
+#endif /* random_streams_hpp */
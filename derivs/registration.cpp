@@ -13,6 +13,7 @@ namespace {
 FactoryHelper<Payoff, CallPayoff> RegisterCall("call");
 FactoryHelper<Payoff, PutPayoff> RegisterPut("put");
 FactoryHelper<Payoff, SpreadPayoff> RegisterSpread("spread");
+FactoryHelper<Payoff, DigitalCallPayoff> RegisterDigitalCall("digitalcall");
 
 /*
 PayoffHelper<CallPayoff> RegisterCall("call");
@@ -0,0 +1,148 @@
+//
+//  sobol.cpp
+//  derivs
+//
+//  Created by Xin Li on 3/28/22.
+//
+
+#include "sobol.hpp"
+#include <ql/math/randomnumbers/primitivepolynomials.hpp>
+
+namespace {
+constexpr double TWO_POW_M32 = 1.0 / 4294967296.0;
+constexpr long DIRECTION_SEED = 20220328;  // fixed, the direction numbers are part of the definition of the sequence
+
+// index of the lowest zero bit
+int lowest_zero_bit(std::uint64_t n)
+{
+    int c = 0;
+    while(n & 1){
+        n >>= 1;
+        ++c;
+    }
+    return c;
+}
+}
+
+RandomSobol::RandomSobol(unsigned long _dim, unsigned long _seed)
+: RandomBase(_dim), seed(_seed), index(0)
+{
+    init_direction_numbers();
+    init_shift();
+    reset();
+}
+
+unsigned long RandomSobol::max_dim()
+{
+    return PPMT_MAX_DIM + 1;
+}
+
+void RandomSobol::init_direction_numbers()
+{
+    unsigned long dim = get_dim();
+    if(dim > max_dim())
+        throw("RandomSobol: dimension is larger than the number of primitive polynomials available");
+    direction.assign(dim * BITS, 0);
+    integers.assign(dim, 0);
+    
+    // van der Corput in the first dimension
+    for(int b=0; b<BITS; ++b)
+        direction[b] = 1u << (BITS - 1 - b);
+    
+    ParkMiller init_generator(DIRECTION_SEED);
+    int degree = 1;
+    unsigned long poly_idx = 0;
+    for(unsigned long d=1; d<dim; ++d){
+        // next primitive polynomial, tables of each degree end with -1
+        if(PrimitivePolynomials[degree-1][poly_idx] < 0){
+            ++degree;
+            poly_idx = 0;
+        }
+        long poly = PrimitivePolynomials[degree-1][poly_idx++];
+        
+        // m_k, k = 1..degree: random odd integers below 2^k
+        std::vector<std::uint32_t> m(BITS + 1);
+        for(int k=1; k<=degree && k<=BITS; ++k){
+            std::uint32_t r = static_cast<std::uint32_t>(init_generator.get_one_integer());
+            m[k] = k == 1 ? 1u : ((r % (1u << (k - 1))) << 1) | 1u;
+        }
+        // m_k = 2 a_1 m_{k-1} ^ 4 a_2 m_{k-2} ^ ... ^ 2^(s-1) a_{s-1} m_{k-s+1} ^ 2^s m_{k-s} ^ m_{k-s}
+        // a_i is bit (s-1-i) of the encoded polynomial
+        for(int k=degree+1; k<=BITS; ++k){
+            std::uint32_t mk = m[k - degree] ^ (m[k - degree] << degree);
+            for(int i=1; i<degree; ++i)
+                if((poly >> (degree - 1 - i)) & 1)
+                    mk ^= m[k - i] << i;
+            m[k] = mk;
+        }
+        for(int k=1; k<=BITS; ++k)
+            direction[d * BITS + k - 1] = m[k] << (BITS - k);
+    }
+}
+
+void RandomSobol::init_shift()
+{
+    unsigned long dim = get_dim();
+    shift.assign(dim, 0);
+    if(seed == 0) return;
+    ParkMiller shift_generator(static_cast<long>(seed % ParkMiller::Max()) + 1);
+    for(unsigned long d=0; d<dim; ++d){
+        // ParkMiller gives 31 random bits, combine two draws for 32
+        std::uint32_t hi = static_cast<std::uint32_t>(shift_generator.get_one_integer());
+        std::uint32_t lo = static_cast<std::uint32_t>(shift_generator.get_one_integer());
+        shift[d] = (hi << 16) ^ lo;
+    }
+}
+
+void RandomSobol::get_uniforms(MJArray& variates)
+{
+    // Gray code order: point n+1 differs from point n by the direction number of the lowest zero bit of n
+    // the all-zero point 0 is never returned
+    unsigned long dim = get_dim();
+    int c = lowest_zero_bit(index);
+    if(c >= BITS)
+        throw("RandomSobol: sequence exhausted");
+    const std::uint32_t* v = &direction[c];
+    for(unsigned long d=0; d<dim; ++d){
+        integers[d] ^= v[d * BITS];
+        variates[d] = ((integers[d] ^ shift[d]) + 0.5) * TWO_POW_M32;
+    }
+    ++index;
+}
+
+void RandomSobol::skip(unsigned long num_of_paths)
+{
+    // point n in Gray code order is the XOR of the direction numbers picked by the bits of n ^ (n >> 1)
+    index += num_of_paths;
+    std::uint64_t gray = index ^ (index >> 1);
+    unsigned long dim = get_dim();
+    for(unsigned long d=0; d<dim; ++d){
+        std::uint32_t x = 0;
+        for(int b=0; b<BITS; ++b)
+            if((gray >> b) & 1)
+                x ^= direction[d * BITS + b];
+        integers[d] = x;
+    }
+}
+
+void RandomSobol::set_seed(unsigned long _seed)
+{
+    seed = _seed;
+    init_shift();
+    reset();
+}
+
+void RandomSobol::reset()
+{
+    index = 0;
+    for(auto& x: integers)
+        x = 0;
+}
+
+void RandomSobol::reset_dim(unsigned long new_dim)
+{
+    RandomBase::reset_dim(new_dim);
+    init_direction_numbers();
+    init_shift();
+    reset();
+}
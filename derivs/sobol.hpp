@@ -0,0 +1,49 @@
+//
+//  sobol.hpp
+//  derivs
+//
+//  Created by Xin Li on 3/28/22.
+//
+
+#ifndef sobol_hpp
+#define sobol_hpp
+
+/*Sobol low-discrepancy sequence as a RandomBase, one point of the sequence per path (dim coordinates).
+ - primitive polynomials modulo two from QuantLib's table, up to 21201 dimensions
+ - initial direction numbers drawn as random odd integers by ParkMiller with a fixed seed (Jaeckel's initialisation),
+   the first dimension is the van der Corput sequence
+ - points generated incrementally in Gray code order (Antonov-Saleev), one XOR per coordinate
+ - skip jumps straight to any point in O(32 * dim)
+ - seed 0 gives the plain sequence, any other seed applies a random digital shift (XOR of every coordinate with
+   a random word), different seeds give independent randomizations of the same sequence
+ */
+
+#include <cstdint>
+#include <vector>
+#include "random.hpp"
+
+class RandomSobol: public RandomBase{
+public:
+    RandomSobol(unsigned long _dim, unsigned long _seed=0);
+    RandomBase* clone() const override {return new RandomSobol(*this);}
+    void get_uniforms(MJArray& variates) override;
+    void skip(unsigned long num_of_paths) override;
+    void set_seed(unsigned long _seed) override;
+    void reset() override;
+    void reset_dim(unsigned long new_dim) override;
+    
+    static unsigned long max_dim();
+    
+private:
+    void init_direction_numbers();
+    void init_shift();
+    
+    static const int BITS = 32;
+    unsigned long seed;
+    std::uint64_t index; // number of points drawn so far
+    std::vector<std::uint32_t> direction; // direction[d * BITS + b], b-th direction number of dimension d
+    std::vector<std::uint32_t> integers;  // current point
+    std::vector<std::uint32_t> shift;     // digital shift
+};
+
+#endif /* sobol_hpp */
@@ -6,3 +6,185 @@
 //
 
 #include "solver.hpp"
+#include <limits>
+#include "normals.hpp"
+#include "fast_math.hpp"
+
+/*batch implied vol
+ A quote is mapped to a normalized out-of-the-money Black call, x = ln(F/K) <= 0, beta = undiscounted price / sqrt(F*K),
+ b(s) = exp(x/2) N(x/s + s/2) - exp(-x/2) N(x/s - s/2), s = vol * sqrt(ttx) the total vol.
+ b is convex below s_c = sqrt(-2x) and concave above, so each quote stays on one side of s_c:
+ above, solve b(s) = beta; below, b is exponentially flat, solve (-2 ln b(s))^(-1/2) = (-2 ln beta)^(-1/2) instead,
+ which is close to linear in s as -2 ln b ~ x^2 / s^2 for small s.
+ Quotes are processed in tiles, a mask marks the quotes still to solve, every step packs them and evaluates b and
+ its derivatives with the array kernels. A step leaving the bracket of a quote is replaced by bisection.
+ */
+namespace {
+const unsigned long IMPLIED_VOL_TILE = 64;
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+const double Infinity = std::numeric_limits<double>::infinity();
+const double InvRoot2Pi = 0.398942280401433;
+const double Epsilon = std::numeric_limits<double>::epsilon();
+
+// b, db/ds and d2b/ds2 for m quotes, eh = exp(x/2), s > 0
+// d1 and d2 are built in b1 and b2, each is read back before it is overwritten
+void normalized_black(const double* x, const double* eh, const double* s, unsigned long m, double* b, double* b1, double* b2)
+{
+    double n1[IMPLIED_VOL_TILE], n2[IMPLIED_VOL_TILE], e[IMPLIED_VOL_TILE];
+    for(unsigned long k=0; k<m; ++k){
+        double d1 = x[k] / s[k] + 0.5 * s[k];
+        b1[k] = d1;
+        b2[k] = d1 - s[k];
+        e[k] = 0.5 * x[k] - 0.5 * d1 * d1; // exp(x/2) phi(d1) up to 1/sqrt(2 pi)
+    }
+    cum_norm(b1, n1, m, NormalAccuracy::full);
+    cum_norm(b2, n2, m, NormalAccuracy::full);
+    exp_array(e, e, m);
+    for(unsigned long k=0; k<m; ++k){
+        double d1 = b1[k];
+        b[k] = eh[k] * n1[k] - n2[k] / eh[k];
+        b1[k] = InvRoot2Pi * e[k];
+        b2[k] = -b1[k] * d1 * (0.5 - x[k] / (s[k] * s[k]));
+    }
+}
+}
+
+unsigned long implied_vol(const double* spot, const double* strike, const double* r, const double* d,
+                          const double* ttx, const double* price, const bool* is_call,
+                          double* vol, unsigned long n, double tol, bool* converged)
+{
+    double x[IMPLIED_VOL_TILE], beta[IMPLIED_VOL_TILE], target[IMPLIED_VOL_TILE], root_t[IMPLIED_VOL_TILE];
+    double s[IMPLIED_VOL_TILE], lo[IMPLIED_VOL_TILE], hi[IMPLIED_VOL_TILE];
+    double eh[IMPLIED_VOL_TILE], b[IMPLIED_VOL_TILE], b1[IMPLIED_VOL_TILE], b2[IMPLIED_VOL_TILE], u[IMPLIED_VOL_TILE];
+    // the quotes still active in a step, packed
+    unsigned long idx[IMPLIED_VOL_TILE];
+    double xa[IMPLIED_VOL_TILE], eha[IMPLIED_VOL_TILE], sa[IMPLIED_VOL_TILE];
+    bool valid[IMPLIED_VOL_TILE], lower[IMPLIED_VOL_TILE], active[IMPLIED_VOL_TILE];
+    unsigned long failed = 0;
+    double cubic_tol = std::sqrt(tol);
+
+    for(unsigned long i0=0; i0<n; i0+=IMPLIED_VOL_TILE){
+        unsigned long m = n - i0 < IMPLIED_VOL_TILE ? n - i0 : IMPLIED_VOL_TILE;
+        double* res = vol + i0;
+
+        // normalize, quotes without a solution get their result here and stay inactive
+        unsigned long num_active = 0;
+        for(unsigned long k=0; k<m; ++k){
+            unsigned long i = i0 + k;
+            double t = ttx[i];
+            double fwd = spot[i] * std::exp((r[i] - d[i]) * t);
+            double c = price[i] * std::exp(r[i] * t);
+            if(is_call && !is_call[i])
+                c += fwd - strike[i]; // put-call parity
+            double root_fk = std::sqrt(fwd * strike[i]);
+            double xk = std::log(fwd / strike[i]);
+            double bk = c / root_fk;
+            if(xk > 0.0){ // in the money call, take the out of the money put
+                bk -= std::exp(0.5 * xk) - std::exp(-0.5 * xk);
+                xk = -xk;
+            }
+            root_t[k] = std::sqrt(t);
+            valid[k] = active[k] = bk > 0.0 && bk < std::exp(0.5 * xk) && t > 0.0;
+            if(valid[k]){
+                x[k] = xk;
+                beta[k] = bk;
+                ++num_active;
+            }else{
+                x[k] = 0.0;
+                beta[k] = 0.5;
+                res[k] = bk == 0.0 && t > 0.0 ? 0.0 : NaN;
+            }
+            eh[k] = std::exp(0.5 * x[k]);
+            s[k] = x[k] < 0.0 ? std::sqrt(-2.0 * x[k]) : 1.0;
+        }
+
+        // side of the inflection point, and the initial guess there
+        normalized_black(x, eh, s, m, b, b1, b2);
+        for(unsigned long k=0; k<m; ++k){
+            lower[k] = x[k] < 0.0 && beta[k] < b[k];
+            u[k] = (eh[k] - beta[k]) / (eh[k] + 1.0 / eh[k]);
+        }
+        inv_cum_norm(u, u, m, NormalAccuracy::fast);
+        for(unsigned long k=0; k<m; ++k){
+            double s_c = x[k] < 0.0 ? s[k] : 0.0;
+            if(lower[k]){
+                // s as a cubic in the objective g, matching s = -x g as g -> 0 and value and slope at s_c
+                target[k] = 1.0 / std::sqrt(-2.0 * std::log(beta[k]));
+                double w_c = -2.0 * std::log(b[k]);
+                double g_c = 1.0 / std::sqrt(w_c);
+                double ds_c = w_c * b[k] / (g_c * b1[k]); // 1 / g'(s_c)
+                double t = target[k] / g_c;
+                s[k] = (t * (1.0 - t) * (1.0 - t) * (-x[k]) + t * t * (t - 1.0) * ds_c) * g_c + t * t * (3.0 - 2.0 * t) * s_c;
+                if(!(s[k] < s_c)) s[k] = std::fmin(-x[k] * target[k], s_c);
+                lo[k] = 0.0;
+                hi[k] = s_c;
+            }else{
+                // b ~ exp(x/2) - (exp(x/2) + exp(-x/2)) N(-s/2), exact for x = 0
+                target[k] = beta[k];
+                s[k] = std::fmax(-2.0 * u[k], s_c);
+                lo[k] = s_c;
+                hi[k] = Infinity;
+            }
+            if(!(s[k] > 0.0)) s[k] = x[k] < 0.0 ? 0.5 * s_c : 1.0;
+        }
+
+        // Halley steps on the objective of each side, both objectives increase with s
+        for(unsigned long step=0; step<IMPLIED_VOL_STEPS && num_active; ++step){
+            unsigned long m_active = 0;
+            for(unsigned long k=0; k<m; ++k){
+                idx[m_active] = k;
+                m_active += active[k];
+            }
+            for(unsigned long j=0; j<m_active; ++j){
+                xa[j] = x[idx[j]];
+                eha[j] = eh[idx[j]];
+                sa[j] = s[idx[j]];
+            }
+            normalized_black(xa, eha, sa, m_active, b, b1, b2);
+            num_active = 0;
+            for(unsigned long j=0; j<m_active; ++j){
+                unsigned long k = idx[j];
+                double f, f1, f2;
+                if(lower[k]){
+                    double q = b1[j] / b[j];
+                    double w = -2.0 * std::log(b[j]);
+                    double g = 1.0 / std::sqrt(w);
+                    double g3 = g / w;
+                    f = g - target[k];
+                    f1 = g3 * q;
+                    f2 = 3.0 * g3 / w * q * q + g3 * (b2[j] / b[j] - q * q);
+                }else{
+                    f = b[j] - target[k];
+                    f1 = b1[j];
+                    f2 = b2[j];
+                }
+                // a residual at the rounding of the objective cannot be improved on, s is kept
+                if(std::fabs(f) <= 4.0 * Epsilon * std::fabs(target[k])){
+                    active[k] = false;
+                    continue;
+                }
+                if(f < 0.0) lo[k] = std::fmax(lo[k], s[k]);
+                if(f > 0.0) hi[k] = std::fmin(hi[k], s[k]);
+                double newton = -f / f1;
+                double halley = 1.0 + 0.5 * newton * f2 / f1;
+                bool cubic = halley > 0.5;
+                double next = s[k] + (cubic ? newton / halley : newton);
+                if(!(next > lo[k] && next < hi[k])){ // also catches NaN from underflowed b
+                    next = hi[k] < Infinity ? 0.5 * (lo[k] + hi[k]) : 2.0 * s[k];
+                    cubic = false;
+                }
+                // the error after a Halley step is of the order of the step cubed
+                active[k] = std::fabs(next - s[k]) > (cubic ? cubic_tol : tol);
+                s[k] = next;
+                num_active += active[k];
+            }
+        }
+
+        failed += num_active;
+        for(unsigned long k=0; k<m; ++k){
+            if(valid[k]) res[k] = s[k] / root_t[k];
+            if(converged) converged[i0 + k] = valid[k] ? !active[k] : res[k] == 0.0;
+        }
+    }
+    return failed;
+}
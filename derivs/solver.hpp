@@ -47,6 +47,18 @@ double newton(double target, double start, double tol, const T& obj){
     return x;
 }
 
+// Black-Scholes implied vols of a chain of European options, element-wise over n quotes.
+// is_call[i] picks a call or a put, nullptr means all calls.
+// Each quote is solved in normalized Black units, started from a closed-form guess on either side
+// of the inflection point of the price in total vol, then refined by at most IMPLIED_VOL_STEPS Halley steps.
+// A quote stops once its step in total vol (vol * sqrt(ttx)) is below tol, or once its price is matched to rounding.
+// Prices outside the no-arbitrage bounds give NaN vols, prices at the intrinsic value give 0.
+// converged[i], unless nullptr, tells whether quote i was solved: false for NaN vols and quotes still moving after the last step.
+// returns the number of quotes with a solution that did not converge
+const unsigned long IMPLIED_VOL_STEPS = 12;
+unsigned long implied_vol(const double* spot, const double* strike, const double* r, const double* d,
+                          const double* ttx, const double* price, const bool* is_call,
+                          double* vol, unsigned long n, double tol=1e-10, bool* converged=nullptr);
 
 
 #endif /* solver_hpp */
@@ -18,14 +18,27 @@
 #include "wrapper.hpp"
 #include "convergence_tab.hpp"
 #include "anti_thetic.hpp"
+#include "random_streams.hpp"
+#include "sobol.hpp"
+#include "brownian_bridge.hpp"
 #include "path_dependent.hpp"
 #include "exotic_engine.hpp"
 #include "tree_product.hpp"
 #include "tree.hpp"
+#include "finite_difference.hpp"
 #include "BlackScholes.hpp"
+#include "normals.hpp"
 #include "func_obj.hpp"
 #include "solver.hpp"
 #include "factory.hpp"
+#include "alloc_audit.hpp"
+#include "vanilla_mc.hpp"
+#include "control_variate.hpp"
+#include "aad.hpp"
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <cstdint>
 
 /* Identify opportunities to refactor/improve codes
  1. be able to change to different types of payoff, call, put, digital, double digital, etc. --> Payoff class
@@ -42,6 +55,7 @@
 // a generic function that depends on abstract base classes
 // extensibility or flexibility is achieved by supplying different concrete derived classes to the function,
 // not by changing the script of the function
+// the pricing itself is VanillaMC instantiated with the base classes, one path per draw so any generator can be supplied
 void simpleMC(const VanillaOption& opt,
               double spot,
               const Parameters& vol,
@@ -54,19 +68,9 @@ void simpleMC(const VanillaOption& opt,
     // MC pricer
     // the process: dS = r * S * dt + vol * S * dW
     // terminal S(T) = S * exp( (r - vol*vol/2) * t + vol * sqrt(t) * random_normal(0,1) )
-    double ttx = opt.get_time_to_exp();
-    double var = vol.integrate_square(0.0, ttx);
-    double sqrvar = std::sqrt(var);
-    double s0 = spot * std::exp(r.integrate(0.0, ttx) - var / 2);
-    double discounting = std::exp(-r.integrate(0.0, ttx));
-    generator.reset_dim(1); // every function call has the same init_seed with the supplied generator
-    MJArray variate(1);
-    for(unsigned long i = 0; i < num_paths; ++i){
-        //double gau = get_one_gaussian_by_BoxMuller();
-        generator.get_gaussians(variate);
-        double s = s0 * std::exp(sqrvar * variate[0]);
-        gatherer.dump_one_result(discounting * opt.payoff(s));
-    }
+    // every function call has the same init_seed with the supplied generator
+    VanillaMC<PayoffBridge, RandomBase, StatsMC> engine(opt.get_payoff(), opt.get_time_to_exp(), spot, vol, r, 1);
+    engine.run_simulation(gatherer, generator, num_paths);
 }
 
 // output std::vector<std::vector<double>>
@@ -189,6 +193,725 @@ void test_exoticEngine(){
     return;
 }
 
+void test_exoticEngine_parallel(){
+    double ttx, strike, spot, vol, r, div;
+    unsigned long num_paths, num_dates, num_threads;
+    
+    std::cout <<"pricing an Asian call option, serial vs. parallel run\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    read_input<unsigned long>("number of threads (0 for all hardware threads): ", num_threads);
+    
+    CallPayoff payoff(strike);
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    ParametersConstant vol_param(vol), rate_param(r), div_param(div);
+    PathDependentAsian opt(times, ttx, payoff);
+    RandomParkMiller generator(num_dates);
+    
+    // same seed for both engines, each path gets the same variates in either mode
+    ExoticBSEngine serial_engine(opt, rate_param, div_param, vol_param, generator, spot);
+    ExoticBSEngine parallel_engine(opt, rate_param, div_param, vol_param, generator, spot);
+    StatsMean serial_gatherer, parallel_gatherer;
+    
+    auto start = std::chrono::steady_clock::now();
+    serial_engine.run_simulation(serial_gatherer, num_paths);
+    auto mid = std::chrono::steady_clock::now();
+    unsigned long parallel_paths = parallel_engine.run_simulation_parallel(parallel_gatherer, num_paths, num_threads);
+    auto end = std::chrono::steady_clock::now();
+    
+    std::cout << "serial price: " << serial_gatherer.get_results_sofar()[0][0]
+              << ", time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "parallel price: " << parallel_gatherer.get_results_sofar()[0][0]
+              << ", paths: " << parallel_paths
+              << ", time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    return;
+}
+
+void test_convergence_stop(){
+    double ttx, strike, spot, vol, r, div, target_error;
+    unsigned long max_paths, num_dates;
+    
+    std::cout << "pricing an Asian call option, stopping at a target standard error\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("maximum number of paths: ", max_paths);
+    read_input<double>("target standard error: ", target_error);
+    
+    CallPayoff payoff(strike);
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    ParametersConstant vol_param(vol), rate_param(r), div_param(div);
+    PathDependentAsian opt(times, ttx, payoff);
+    RandomParkMiller generator(num_dates);
+    
+    StatsMean mean;
+    ConvergenceStop stopper(mean, target_error);
+    ExoticBSEngine engine(opt, rate_param, div_param, vol_param, generator, spot);
+    auto start = std::chrono::steady_clock::now();
+    unsigned long paths_used = engine.run_simulation(stopper, max_paths);
+    auto mid = std::chrono::steady_clock::now();
+    
+    // the same generator from the start, run to the end
+    StatsVariance full_run;
+    ExoticBSEngine full_engine(opt, rate_param, div_param, vol_param, generator, spot);
+    full_engine.run_simulation(full_run, max_paths);
+    auto end = std::chrono::steady_clock::now();
+    
+    // the batch run checks at the end of the batch crossing each check interval
+    ConvergenceStop batch_stopper(mean, target_error);
+    ExoticBSEngine batch_engine(opt, rate_param, div_param, vol_param, generator, spot);
+    unsigned long batch_paths_used = batch_engine.run_simulation_batch(batch_stopper, max_paths);
+    
+    // four workers each stop on their share, held to the target of the merged result
+    ConvergenceStop parallel_stopper(mean, target_error);
+    ExoticBSEngine parallel_engine(opt, rate_param, div_param, vol_param, generator, spot);
+    unsigned long parallel_paths_used = parallel_engine.run_simulation_parallel(parallel_stopper, max_paths, 4);
+    
+    std::cout << "stopped: price, standard error, paths: " << stopper.get_results_sofar();
+    std::cout << "paths used: " << paths_used << ", time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "batch run stopped: " << batch_stopper.get_results_sofar();
+    std::cout << "batch paths used: " << batch_paths_used << "\n";
+    std::cout << "parallel run (4 threads) stopped: " << parallel_stopper.get_results_sofar();
+    std::cout << "parallel paths used: " << parallel_paths_used << "\n";
+    std::cout << "full run: price, variance, standard error: " << full_run.get_results_sofar();
+    std::cout << "paths used: " << max_paths << ", time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+}
+
+void test_control_variate(){
+    double ttx, strike, spot, vol, r, div;
+    unsigned long num_paths, num_dates;
+    
+    std::cout << "pricing an Asian call option, geometric Asian call as control variate\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    
+    CallPayoff payoff(strike);
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    ParametersConstant vol_param(vol), rate_param(r), div_param(div);
+    PathDependentAsian opt(times, ttx, payoff);
+    PathDependentGeometricAsian control(times, ttx, payoff);
+    double control_price = geometric_asian_call(spot, strike, times, ttx, rate_param, div_param, vol_param);
+    RandomParkMiller generator(num_dates);
+    
+    // the analytic price against a plain simulation of the control
+    StatsVariance control_stats;
+    ExoticBSEngine control_engine(control, rate_param, div_param, vol_param, generator, spot);
+    control_engine.run_simulation(control_stats, num_paths);
+    std::cout << "geometric Asian call, closed form: " << control_price
+              << ", MC (mean, variance, standard error): " << control_stats.get_results_sofar();
+    
+    ExoticBSEngine engine(opt, rate_param, div_param, vol_param, generator, spot);
+    StatsControlVariate gatherer(control_price);
+    ControlVariateEngine cv_engine(engine, control, rate_param);
+    cv_engine.run_simulation(gatherer, num_paths);
+    std::vector<std::vector<double>> res = gatherer.get_results_sofar();
+    std::cout << "adjusted price, standard error, beta, plain price, standard error:\n" << res;
+    std::cout << "variance reduction: " << res[0][4] * res[0][4] / (res[0][1] * res[0][1]) << "\n";
+    
+    // the same pairs through dump_results, a path without its control is rejected
+    StatsControlVariate by_pairs(control_price), by_results(control_price);
+    for(double y: {1.0, 3.0, 2.5, 0.0}){
+        double pair[2] = {y, 0.5 * y + 1.0};
+        by_pairs.dump_controlled_result(pair[0], pair[1]);
+        by_results.dump_results(pair, 2);
+    }
+    if(by_pairs.get_state() != by_results.get_state())
+        throw("dump_results and dump_controlled_result disagree");
+    bool single_rejected = false, triple_rejected = false;
+    try{
+        by_results.dump_one_result(1.0);
+    }catch(const char*){
+        single_rejected = true;
+    }
+    double triple[3] = {1.0, 2.0, 3.0};
+    try{
+        by_results.dump_results(triple, 3);
+    }catch(const char*){
+        triple_rejected = true;
+    }
+    if(!single_rejected || !triple_rejected)
+        throw("StatsControlVariate accepted a path without exactly one control");
+    std::cout << "dump_results gives the same state, a result alone and three results are rejected\n";
+}
+
+void test_greeks(){
+    double ttx, strike, spot, vol, r, div;
+    unsigned long num_paths, num_dates;
+    
+    std::cout << "price and Greeks of Asian options in one pass, against bump and revalue on the same paths\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    CallPayoff call(strike);
+    DigitalCallPayoff digital(strike);
+    PathDependentAsian call_opt(times, ttx, call);     // pathwise
+    PathDependentAsian digital_opt(times, ttx, digital); // likelihood ratio
+    const char* names[] = {"price", "delta", "vega", "rho"};
+    
+    for(const PathDependentAsian* opt: {&call_opt, &digital_opt}){
+        std::cout << (opt == &call_opt ? "Asian call, pathwise\n" : "Asian digital call, likelihood ratio\n");
+        RandomParkMiller generator(num_dates);
+        ExoticBSEngine engine(*opt, ParametersConstant(r), ParametersConstant(div), ParametersConstant(vol), generator, spot);
+        StatsMultiVariance greeks(ExoticEngine::NUM_GREEKS + 1);
+        auto start = std::chrono::steady_clock::now();
+        engine.run_simulation_greeks(greeks, num_paths);
+        double one_pass = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        // central differences with the same variates, bumps wide enough for the jump of the digital
+        auto price = [&](double s, double v, double rate){
+            RandomParkMiller gen(num_dates);
+            ExoticBSEngine bumped(*opt, ParametersConstant(rate), ParametersConstant(div), ParametersConstant(v), gen, s);
+            StatsMean mean;
+            bumped.run_simulation(mean, num_paths);
+            return mean.get_results_sofar()[0][0];
+        };
+        start = std::chrono::steady_clock::now();
+        double b = 1e-2;
+        double bumps[4] = {price(spot, vol, r),
+            (price(spot * (1 + b), vol, r) - price(spot * (1 - b), vol, r)) / (2 * spot * b),
+            (price(spot, vol + b, r) - price(spot, vol - b, r)) / (2 * b),
+            (price(spot, vol, r + b) - price(spot, vol, r - b)) / (2 * b)};
+        double bumping = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        for(unsigned long g=0; g<=ExoticEngine::NUM_GREEKS; ++g)
+            std::cout << names[g] << ": " << greeks.get_mean(g) << " (standard error " << greeks.get_standard_error(g)
+                      << "), bump and revalue " << bumps[g] << "\n";
+        if(num_dates == 1){
+            double h = 1e-4;
+            double ref[4];
+            if(opt == &call_opt){
+                ref[0] = bs_call(spot, strike, r, div, vol, ttx);
+                ref[1] = (bs_call(spot * (1 + h), strike, r, div, vol, ttx) - bs_call(spot * (1 - h), strike, r, div, vol, ttx)) / (2 * spot * h);
+                ref[2] = bs_vega(spot, strike, r, div, vol, ttx);
+                ref[3] = (bs_call(spot, strike, r + h, div, vol, ttx) - bs_call(spot, strike, r - h, div, vol, ttx)) / (2 * h);
+            }else{
+                ref[0] = bs_digital_call(spot, strike, r, div, vol, ttx);
+                ref[1] = (bs_digital_call(spot * (1 + h), strike, r, div, vol, ttx) - bs_digital_call(spot * (1 - h), strike, r, div, vol, ttx)) / (2 * spot * h);
+                ref[2] = (bs_digital_call(spot, strike, r, div, vol + h, ttx) - bs_digital_call(spot, strike, r, div, vol - h, ttx)) / (2 * h);
+                ref[3] = (bs_digital_call(spot, strike, r + h, div, vol, ttx) - bs_digital_call(spot, strike, r - h, div, vol, ttx)) / (2 * h);
+            }
+            std::cout << "closed form:";
+            for(unsigned long g=0; g<=ExoticEngine::NUM_GREEKS; ++g)
+                std::cout << " " << names[g] << " " << ref[g];
+            std::cout << "\n";
+        }
+        std::cout << "one pass: " << one_pass << " ms, bump and revalue (7 runs): " << bumping << " ms\n";
+    }
+}
+
+void test_aad(){
+    double ttx, strike, spot, vol, r, div;
+    unsigned long num_paths, num_dates, steps;
+    
+    std::cout << "price and gradient by AAD, against bump and revalue on the same paths / tree\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    read_input<unsigned long>("number of tree steps: ", steps);
+    const char* names[] = {"spot", "r", "d", "vol", "strike"};
+    double h = 1e-5;
+    
+    // Asian call on the Monte Carlo engine
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    auto mc_price = [&](double s, double rate, double dv, double v, double k){
+        RandomParkMiller generator(num_dates);
+        ExoticBSEngine engine(PathDependentAsian(times, ttx, CallPayoff(k)), ParametersConstant(rate), ParametersConstant(dv),
+                              ParametersConstant(v), generator, s);
+        StatsMean mean;
+        engine.run_simulation(mean, num_paths);
+        return mean.get_results_sofar()[0][0];
+    };
+    RandomParkMiller generator(num_dates);
+    ExoticBSEngine engine(PathDependentAsian(times, ttx, CallPayoff(strike)), ParametersConstant(r), ParametersConstant(div),
+                          ParametersConstant(vol), generator, spot);
+    PriceGradient gradient;
+    auto start = std::chrono::steady_clock::now();
+    engine.run_simulation_aad(num_paths, gradient);
+    double aad_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    double price = mc_price(spot, r, div, vol, strike);
+    double price_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double mc_aad[5] = {gradient.spot, gradient.r[0], gradient.d[0], gradient.vol[0], gradient.payoff[0]};
+    double mc_bump[5] = {
+        (mc_price(spot + h, r, div, vol, strike) - mc_price(spot - h, r, div, vol, strike)) / (2 * h),
+        (mc_price(spot, r + h, div, vol, strike) - mc_price(spot, r - h, div, vol, strike)) / (2 * h),
+        (mc_price(spot, r, div + h, vol, strike) - mc_price(spot, r, div - h, vol, strike)) / (2 * h),
+        (mc_price(spot, r, div, vol + h, strike) - mc_price(spot, r, div, vol - h, strike)) / (2 * h),
+        (mc_price(spot, r, div, vol, strike + h) - mc_price(spot, r, div, vol, strike - h)) / (2 * h)};
+    std::cout << "Asian call, MC price: " << gradient.price << " (plain run " << price << ")\n";
+    for(unsigned long i=0; i<5; ++i)
+        std::cout << "d price / d " << names[i] << ": AAD " << mc_aad[i] << ", bump and revalue " << mc_bump[i] << "\n";
+    std::cout << "AAD time / pricing time: " << aad_time / price_time << "\n";
+    
+    // American put on the tree
+    auto tree_price = [&](double s, double rate, double dv, double v, double k){
+        BinomialTree tree(s, ParametersConstant(rate), ParametersConstant(dv), v, steps, ttx);
+        return tree.get_price(TreeAmerican(ttx, PutPayoff(k)));
+    };
+    BinomialTree tree(spot, ParametersConstant(r), ParametersConstant(div), vol, steps, ttx);
+    start = std::chrono::steady_clock::now();
+    tree.get_price(TreeAmerican(ttx, PutPayoff(strike)), gradient);
+    double cold_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // the tape keeps its blocks, a second gradient records without allocating
+    start = std::chrono::steady_clock::now();
+    tree.get_price(TreeAmerican(ttx, PutPayoff(strike)), gradient);
+    aad_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    price = tree_price(spot, r, div, vol, strike);
+    price_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double tree_aad[5] = {gradient.spot, gradient.r[0], gradient.d[0], gradient.vol[0], gradient.payoff[0]};
+    double tree_bump[5] = {
+        (tree_price(spot + h, r, div, vol, strike) - tree_price(spot - h, r, div, vol, strike)) / (2 * h),
+        (tree_price(spot, r + h, div, vol, strike) - tree_price(spot, r - h, div, vol, strike)) / (2 * h),
+        (tree_price(spot, r, div + h, vol, strike) - tree_price(spot, r, div - h, vol, strike)) / (2 * h),
+        (tree_price(spot, r, div, vol + h, strike) - tree_price(spot, r, div, vol - h, strike)) / (2 * h),
+        (tree_price(spot, r, div, vol, strike + h) - tree_price(spot, r, div, vol, strike - h)) / (2 * h)};
+    std::cout << "American put, tree price: " << gradient.price << " (plain run " << price << ")\n";
+    for(unsigned long i=0; i<5; ++i)
+        std::cout << "d price / d " << names[i] << ": AAD " << tree_aad[i] << ", bump and revalue " << tree_bump[i] << "\n";
+    std::cout << "AAD time / pricing time: " << aad_time / price_time << ", first gradient on a new tape: " << cold_time / price_time << "\n";
+}
+
+void test_parameters_piecewise(){
+    unsigned long num_knots, num_dates;
+    
+    std::cout << "piecewise constant and linear parameters: integrals, grid integrals, knot gradients\n";
+    read_input<unsigned long>("number of knots: ", num_knots);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    
+    // knots over 10 years, dates over 12 years to run past the last knot
+    std::vector<double> knot_times(num_knots), knot_values(num_knots);
+    for(unsigned long i=0; i<num_knots; ++i){
+        knot_times[i] = 10.0 * (i + 1.0) / num_knots;
+        knot_values[i] = 0.2 + 0.05 * std::sin(0.7 * i);
+    }
+    MJArray dates(num_dates);
+    for(unsigned long j=0; j<num_dates; ++j)
+        dates[j] = 12.0 * (j + 1.0) / num_dates;
+    ParametersPiecewiseConstant constant_inner(knot_times, knot_values);
+    ParametersPiecewiseLinear linear_inner(knot_times, knot_values);
+    
+    for(const ParametersInner* inner: {static_cast<const ParametersInner*>(&constant_inner), static_cast<const ParametersInner*>(&linear_inner)}){
+        Parameters param(*inner);
+        std::cout << (inner == &constant_inner ? "piecewise constant\n" : "piecewise linear\n");
+        
+        // against a midpoint rule on [0.3, 11]
+        unsigned long num_points = 1000000;
+        double h = (11.0 - 0.3) / num_points, sum = 0.0, sum_square = 0.0;
+        for(unsigned long k=0; k<num_points; ++k){
+            double t = 0.3 + (k + 0.5) * h;
+            double v = param.integrate(t - 1e-9, t + 1e-9) / 2e-9;
+            sum += v * h;
+            sum_square += v * v * h;
+        }
+        std::cout << "integral on [0.3, 11]: " << param.integrate(0.3, 11.0) << ", difference to midpoint rule "
+                  << param.integrate(0.3, 11.0) - sum << "\n";
+        std::cout << "square integral on [0.3, 11]: " << param.integrate_square(0.3, 11.0) << ", difference to midpoint rule "
+                  << param.integrate_square(0.3, 11.0) - sum_square << "\n";
+        
+        // grid against one integrate per step
+        MJArray by_step(num_dates), by_grid(num_dates);
+        auto start = std::chrono::steady_clock::now();
+        for(unsigned long j=0; j<num_dates; ++j)
+            by_step[j] = param.integrate_square(j ? dates[j-1] : 0.0, dates[j]);
+        auto mid = std::chrono::steady_clock::now();
+        param.integrate_square_grid(0.0, dates.data(), num_dates, by_grid.data());
+        auto end = std::chrono::steady_clock::now();
+        double max_diff = 0.0;
+        for(unsigned long j=0; j<num_dates; ++j)
+            max_diff = std::fmax(max_diff, std::fabs(by_step[j] - by_grid[j]));
+        std::cout << "square integrals per step (ms): " << std::chrono::duration<double, std::milli>(mid - start).count()
+                  << ", over the grid (ms): " << std::chrono::duration<double, std::milli>(end - mid).count()
+                  << ", max difference " << max_diff << "\n";
+        
+        // knot gradients against central differences
+        std::vector<unsigned long> knots(num_knots);
+        std::vector<double> partials(num_knots);
+        unsigned long m = inner->integrate_square_gradient(0.3, 7.55, knots.data(), partials.data());
+        double max_error = 0.0;
+        for(unsigned long i=0; i<m; ++i){
+            std::vector<double> up(knot_values), down(knot_values);
+            up[knots[i]] += 1e-6;
+            down[knots[i]] -= 1e-6;
+            double fd = inner == &constant_inner
+            ? (ParametersPiecewiseConstant(knot_times, up).integrate_square(0.3, 7.55) - ParametersPiecewiseConstant(knot_times, down).integrate_square(0.3, 7.55)) / 2e-6
+            : (ParametersPiecewiseLinear(knot_times, up).integrate_square(0.3, 7.55) - ParametersPiecewiseLinear(knot_times, down).integrate_square(0.3, 7.55)) / 2e-6;
+            max_error = std::fmax(max_error, std::fabs(fd - partials[i]));
+        }
+        std::cout << "square integral on [0.3, 7.55]: " << m << " knots with partials, max error against finite differences " << max_error << "\n";
+        
+        // engine setup over all dates
+        RandomParkMiller generator(num_dates);
+        start = std::chrono::steady_clock::now();
+        ExoticBSEngine engine(PathDependentAsian(dates, 12.0, CallPayoff(100.0)), param, ParametersConstant(0.0), param, generator, 100.0);
+        end = std::chrono::steady_clock::now();
+        std::cout << "ExoticBSEngine setup (ms): " << std::chrono::duration<double, std::milli>(end - start).count() << "\n";
+    }
+}
+
+void test_stats_merge(){
+    double ttx, strike, spot, vol, r;
+    unsigned long num_paths;
+    long num_parts;
+    
+    std::cout << "pricing a call option in separate parts, reduce the parts by their serialized states\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    read_input<long>("number of parts: ", num_parts);
+    if(num_parts <= 0)
+        throw("the number of parts must be positive");
+    
+    CallPayoff payoff(strike);
+    VanillaOption opt(payoff, ttx);
+    ParametersConstant param_vol(vol), param_r(r);
+    
+    // one run over all paths
+    StatsMoments all_paths;
+    RandomParkMiller generator(1, 1);
+    simpleMC(opt, spot, param_vol, param_r, num_paths, all_paths, generator);
+    
+    // every part could run in its own process, only the serialized state is passed to the driver
+    std::stringstream channel;
+    unsigned long paths_per_part = num_paths / num_parts;
+    for(long i = 0; i < num_parts; ++i){
+        StatsMoments part;
+        RandomParkMiller part_generator(1, 1);
+        part_generator.skip(i * paths_per_part);
+        unsigned long part_paths = i + 1 < num_parts ? paths_per_part : num_paths - i * paths_per_part;
+        // simpleMC resets the generator, draw the paths of the part directly
+        MJArray variate(1);
+        double var = param_vol.integrate_square(0.0, ttx);
+        double s0 = spot * std::exp(param_r.integrate(0.0, ttx) - var / 2);
+        double discounting = std::exp(-param_r.integrate(0.0, ttx));
+        for(unsigned long j = 0; j < part_paths; ++j){
+            part_generator.get_gaussians(variate);
+            part.dump_one_result(discounting * opt.payoff(s0 * std::exp(std::sqrt(var) * variate[0])));
+        }
+        write_state(channel, part);
+    }
+    StatsMoments reduced;
+    for(long i = 0; i < num_parts; ++i)
+        merge_state(channel, reduced);
+    
+    std::cout << "mean, variance, skewness, excess kurtosis\n";
+    std::cout << "single run: " << all_paths.get_results_sofar();
+    std::cout << "reduced:    " << reduced.get_results_sofar();
+    
+    // a state of another gatherer, and a state cut short, are rejected
+    bool wrong_size_rejected = false, short_state_rejected = false;
+    std::stringstream moments_state;
+    write_state(moments_state, reduced);
+    StatsVariance variance;
+    try{
+        merge_state(moments_state, variance);
+    }catch(const char*){
+        wrong_size_rejected = true;
+    }
+    std::stringstream short_channel(channel.str().substr(0, sizeof(std::uint64_t) + 3 * sizeof(double)));
+    try{
+        merge_state(short_channel, reduced);
+    }catch(const char*){
+        short_state_rejected = true;
+    }
+    std::cout << "state of another gatherer rejected: " << wrong_size_rejected
+              << ", state cut short rejected: " << short_state_rejected << "\n";
+}
+
+void test_random_streams(){
+    std::cout << "check generators with skip-ahead\n";
+    // Philox4x32-10 known answers from the Random123 distribution
+    Philox4x32::Block counter = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, out;
+    Philox4x32::generate(counter, 0xa4093822, 0x299f31d0, out);
+    std::cout << "Philox4x32-10 known answer: " << std::hex
+              << out[0] << " " << out[1] << " " << out[2] << " " << out[3]
+              << " (expected d16cfe09 94fdcceb 5001e420 24126ea1)\n" << std::dec;
+    if(out[0] != 0xd16cfe09 || out[1] != 0x94fdcceb || out[2] != 0x5001e420 || out[3] != 0x24126ea1)
+        throw("Philox4x32-10 does not reproduce the known answer");
+    
+    // skip must land where drawing and discarding lands
+    unsigned long dim, num_paths;
+    read_input<unsigned long>("dimension: ", dim);
+    read_input<unsigned long>("number of paths to skip: ", num_paths);
+    RandomParkMiller park_miller(dim, 7);
+    RandomPhilox philox(dim, 7, 3);
+    RandomMRG32k3a mrg(dim, 7, 3);
+    std::vector<Wrapper<RandomBase>> generators{Wrapper<RandomBase>(park_miller), Wrapper<RandomBase>(philox), Wrapper<RandomBase>(mrg)};
+    std::vector<std::string> names{"ParkMiller", "Philox4x32", "MRG32k3a"};
+    MJArray drawn(dim), skipped(dim);
+    for(unsigned long g = 0; g < generators.size(); ++g){
+        Wrapper<RandomBase> copy(generators[g]);
+        auto start = std::chrono::steady_clock::now();
+        for(unsigned long i = 0; i < num_paths; ++i)
+            generators[g]->get_uniforms(drawn);
+        auto mid = std::chrono::steady_clock::now();
+        copy->skip(num_paths);
+        auto end = std::chrono::steady_clock::now();
+        generators[g]->get_uniforms(drawn);
+        copy->get_uniforms(skipped);
+        double diff = 0.0;
+        for(unsigned long j = 0; j < dim; ++j)
+            diff += std::fabs(drawn[j] - skipped[j]);
+        std::cout << names[g] << ": difference " << diff
+                  << ", draw time(us) " << std::chrono::duration<double, std::micro>(mid - start).count()
+                  << ", skip time(us) " << std::chrono::duration<double, std::micro>(end - mid).count() << "\n";
+        if(diff != 0.0)
+            throw("skip does not land where drawing and discarding lands");
+    }
+}
+
+void test_sobol(){
+    double ttx, strike, spot, vol, r, div;
+    unsigned long num_paths, num_dates, num_runs;
+    
+    std::cout <<"pricing an Asian call option, pseudo-random vs. Sobol vs. Sobol with Brownian bridge\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of dates: ", num_dates);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    read_input<unsigned long>("number of independent runs: ", num_runs);
+    
+    CallPayoff payoff(strike);
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    ParametersConstant vol_param(vol), rate_param(r), div_param(div);
+    PathDependentAsian opt(times, ttx, payoff);
+    
+    // each run uses another seed, for Sobol another random digital shift,
+    // the spread of the prices over the runs measures the error of each method
+    std::vector<std::string> names{"ParkMiller", "Sobol", "Sobol + Brownian bridge"};
+    for(unsigned long m=0; m<names.size(); ++m){
+        StatsVariance runs;
+        MJArray price(1);
+        for(unsigned long k=0; k<num_runs; ++k){
+            RandomParkMiller park_miller(num_dates, k + 1);
+            RandomSobol sobol(num_dates, k + 1);
+            Wrapper<RandomBase> generator(park_miller);
+            if(m == 1) generator = Wrapper<RandomBase>(sobol);
+            if(m == 2) generator = Wrapper<RandomBase>(BrownianBridge(sobol, times));
+            ExoticBSEngine engine(opt, rate_param, div_param, vol_param, generator, spot);
+            StatsMean gatherer;
+            engine.run_simulation(gatherer, num_paths);
+            runs.dump_one_result(gatherer.get_results_sofar()[0][0]);
+        }
+        std::cout << names[m] << ": mean price " << runs.get_mean()
+                  << ", std dev over runs " << std::sqrt(runs.get_variance()) << "\n";
+    }
+}
+
+void test_normals(){
+    unsigned long n;
+    std::cout << "array normal kernels vs. scalar functions\n";
+    read_input<unsigned long>("number of values: ", n);
+    
+    RandomParkMiller generator(n);
+    MJArray u(n), scalar(n), fast(n), full(n);
+    generator.get_uniforms(u);
+    
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<n; ++i)
+        scalar[i] = inv_cum_norm(u[i]);
+    auto mid = std::chrono::steady_clock::now();
+    inv_cum_norm(&u[0], &fast[0], n, NormalAccuracy::fast);
+    auto end = std::chrono::steady_clock::now();
+    inv_cum_norm(&u[0], &full[0], n, NormalAccuracy::full);
+    
+    unsigned long mismatches = 0;
+    double diff = 0.0, roundtrip = 0.0;
+    for(unsigned long i=0; i<n; ++i){
+        if(scalar[i] != fast[i]) ++mismatches;
+        diff = std::fmax(diff, std::fabs(fast[i] - full[i]));
+        roundtrip = std::fmax(roundtrip, std::fabs(0.5 * std::erfc(-full[i] / std::sqrt(2.0)) - u[i]));
+    }
+    std::cout << "inv_cum_norm fast: " << mismatches << " values differ from scalar (expected 0)"
+              << ", scalar time(ms) " << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", array time(ms) " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    std::cout << "inv_cum_norm max |fast - full|: " << diff << ", full round trip error: " << roundtrip << "\n";
+    
+    start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<n; ++i)
+        scalar[i] = cum_norm(full[i]);
+    mid = std::chrono::steady_clock::now();
+    cum_norm(&full[0], &fast[0], n);
+    end = std::chrono::steady_clock::now();
+    diff = 0.0;
+    for(unsigned long i=0; i<n; ++i)
+        diff = std::fmax(diff, std::fabs(fast[i] - scalar[i]));
+    std::cout << "cum_norm max |array - scalar|: " << diff
+              << ", scalar time(ms) " << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", array time(ms) " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+}
+
+void test_mjarray(){
+    unsigned long n, repeats;
+    std::cout << "array expressions, fused loop vs. one pass per operation\n";
+    read_input<unsigned long>("array size: ", n);
+    read_input<unsigned long>("number of repeats: ", repeats);
+    
+    MJArray a(n), b(n), c(n), d(n);
+    b = 1.0;
+    c = 2.0;
+    d = 3.0;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long k=0; k<repeats; ++k)
+        a = b * c + d; // one loop, no temporaries
+    auto mid = std::chrono::steady_clock::now();
+    for(unsigned long k=0; k<repeats; ++k){
+        a = b;
+        a *= c;
+        a += d;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "a[0] = " << a[0] << " (expected 5)"
+              << ", fused time(ms) " << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", separate passes time(ms) " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    
+    // short arrays are stored in the object, moving them copies the values
+    MJArray small(3);
+    small = 1.5;
+    MJArray moved(std::move(small));
+    std::cout << "moved short array: size " << moved.size() << ", sum " << moved.sum()
+              << ", source size " << small.size() << "\n";
+}
+
+void test_alloc_audit(){
+    std::cout << "heap allocations in the pricing loops after warm-up\n";
+    if(!alloc_audit_enabled()){
+        std::cout << "compile with ALLOC_AUDIT defined to count allocations\n";
+        return;
+    }
+    double ttx = 1.0, strike = 100.0, spot = 100.0, vol = 0.2, r = 0.05, div = 0.01;
+    unsigned long num_dates = 24, num_paths = 10000, steps = 200;
+    
+    CallPayoff payoff(strike);
+    ParametersConstant vol_param(vol), rate_param(r), div_param(div);
+    MJArray times(num_dates);
+    for(unsigned long i=0; i<num_dates; ++i)
+        times[i] = (i + 1.0) * ttx / num_dates;
+    PathDependentAsian asian(times, ttx, payoff);
+    RandomParkMiller park_miller(num_dates);
+    AntiThetic anti_thetic(park_miller);
+    RandomSobol sobol(num_dates);
+    std::vector<std::string> names{"ParkMiller", "AntiThetic", "Sobol + Brownian bridge"};
+    std::vector<Wrapper<RandomBase>> generators{Wrapper<RandomBase>(park_miller), Wrapper<RandomBase>(anti_thetic),
+                                                Wrapper<RandomBase>(BrownianBridge(sobol, times))};
+    unsigned long failures = 0;
+    auto report = [&failures](const std::string& name, unsigned long count){
+        std::cout << name << ": " << count << " allocations" << (count == 0 ? "" : "  <-- FAILED") << "\n";
+        if(count != 0) ++failures;
+    };
+    
+    for(unsigned long g=0; g<generators.size(); ++g){
+        ExoticBSEngine engine(asian, rate_param, div_param, vol_param, generators[g], spot);
+        StatsMean gatherer;
+        engine.run_simulation(gatherer, 10); // warm-up, workspaces are sized here
+        engine.run_simulation_batch(gatherer, 256); // one full batch
+        AllocationCounter counter;
+        engine.run_simulation(gatherer, num_paths);
+        report("run_simulation, " + names[g], counter.count());
+        AllocationCounter batch_counter;
+        engine.run_simulation_batch(gatherer, num_paths);
+        engine.skip_paths(num_paths + 1);
+        report("run_simulation_batch and skip_paths, " + names[g], batch_counter.count());
+    }
+    
+    VanillaOption call(payoff, ttx);
+    StatsMean gatherer;
+    RandomParkMiller generator(1);
+    simpleMC(call, spot, vol_param, rate_param, 10, gatherer, generator);
+    AllocationCounter mc_counter;
+    simpleMC(call, spot, vol_param, rate_param, num_paths, gatherer, generator);
+    report("simpleMC", mc_counter.count());
+    
+    TreeAmerican american(ttx, payoff);
+    BinomialTree tree(spot, rate_param, div_param, vol, steps, ttx);
+    tree.get_price(american); // builds the tree
+    AllocationCounter tree_counter;
+    tree.get_price(american);
+    report("BinomialTree::get_price", tree_counter.count());
+    if(failures != 0)
+        throw("pricing loops allocate after warm-up");
+}
+
+void test_vanilla_mc(){
+    double ttx, strike, spot, vol, r;
+    unsigned long num_paths;
+    std::cout << "pricing a call option, virtual calls (simpleMC) vs. static types (VanillaMC)\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<unsigned long>("number of paths: ", num_paths);
+    
+    CallPayoff payoff(strike);
+    VanillaOption opt(payoff, ttx);
+    ParametersConstant vol_param(vol), rate_param(r);
+    // the same ParkMiller stream in both, prices agree up to the rounding of the vectorized exp
+    RandomParkMiller generator(1);
+    StatsMean virtual_gatherer, static_gatherer;
+    
+    auto start = std::chrono::steady_clock::now();
+    simpleMC(opt, spot, vol_param, rate_param, num_paths, virtual_gatherer, generator);
+    auto mid = std::chrono::steady_clock::now();
+    VanillaMC<CallPayoff, RandomParkMiller, StatsMean> engine(payoff, ttx, spot, vol_param, rate_param);
+    engine.run_simulation(static_gatherer, generator, num_paths);
+    auto end = std::chrono::steady_clock::now();
+    
+    double virtual_time = std::chrono::duration<double, std::milli>(mid - start).count();
+    double static_time = std::chrono::duration<double, std::milli>(end - mid).count();
+    std::cout << "virtual price: " << virtual_gatherer.get_results_sofar()[0][0] << ", time(ms): " << virtual_time << "\n";
+    std::cout << "static price:  " << static_gatherer.get_results_sofar()[0][0] << ", time(ms): " << static_time << "\n";
+    std::cout << "speed-up: " << virtual_time / static_time << "\n";
+    std::cout << "BS formula price: " << bs_call(spot, strike, r, 0.0, vol, ttx) << "\n";
+}
+
 void test_tree(){
     double ttx, strike, spot, vol, r, div;
     unsigned long steps;
@@ -238,6 +961,108 @@ void test_tree(){
     std::cout << "forward avg price: " << fwd_avg << "\n";
 }
 
+void test_tree_batch(){
+    double ttx, spot, vol, r, div;
+    unsigned long steps, num_strikes;
+    
+    std::cout << "pricing a strip of American calls on one tree\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    read_input<unsigned long>("number of steps: ", steps);
+    read_input<unsigned long>("number of strikes: ", num_strikes);
+    
+    ParametersConstant r_param(r);
+    ParametersConstant div_param(div);
+    // strikes from 50% to 150% of spot
+    std::vector<TreeAmerican> options;
+    for(unsigned long i=0; i<num_strikes; ++i){
+        double strike = spot * (0.5 + i / std::fmax(num_strikes - 1.0, 1.0));
+        options.emplace_back(ttx, CallPayoff(strike));
+    }
+    std::vector<const TreeProduct*> products;
+    for(const TreeAmerican& opt : options)
+        products.push_back(&opt);
+    
+    BinomialTree tree(spot, r_param, div_param, vol, steps, ttx);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<double> batch_prices = tree.get_prices(products);
+    auto mid = std::chrono::steady_clock::now();
+    double max_diff = 0.0;
+    for(unsigned long i=0; i<num_strikes; ++i)
+        max_diff = std::fmax(max_diff, std::fabs(batch_prices[i] - tree.get_price(*products[i])));
+    auto end = std::chrono::steady_clock::now();
+    
+    std::cout << "batch time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "one by one time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    std::cout << "max difference: " << max_diff << "\n";
+    std::cout << "ATM-most price: " << batch_prices[num_strikes / 2] << "\n";
+}
+
+void test_lattices(){
+    double ttx, strike, spot, vol, r, div;
+    
+    std::cout << "American put on binomial, trinomial and Crank-Nicolson lattices against a binomial Black-Scholes reference\n";
+    read_input<double>("Enter time to expiry: ", ttx);
+    read_input<double>("Strike: ", strike);
+    read_input<double>("Spot: ", spot);
+    read_input<double>("vol: ", vol);
+    read_input<double>("r: ", r);
+    read_input<double>("dividend: ", div);
+    
+    TreeAmerican put(ttx, PutPayoff(strike));
+    ParametersConstant r_param(r), div_param(div);
+    // reference independent of the lattices tested: binomial trees whose last step is the Black-Scholes put over one step,
+    // which takes the kink of the payoff out of the tree and leaves an error of order 1 / steps, extrapolated on 4000 and 8000 steps
+    class BinomialBSPut: public TreeProduct{
+    public:
+        BinomialBSPut(double _final_time, double _strike, double _r, double _d, double _vol, unsigned long steps)
+        : TreeProduct(_final_time), strike(_strike), r(_r), d(_d), vol(_vol), dt(_final_time / steps){}
+        double final_payoff(double spot) const override {return std::fmax(strike - spot, 0.0);}
+        double pre_final_value(double spot, double time, double disc_fut_val) const override {
+            if(time > get_final_time() - 1.5 * dt)
+                disc_fut_val = bs_put(spot, strike, r, d, vol, dt);
+            return std::fmax(strike - spot, disc_fut_val);
+        }
+        TreeProduct* clone() const override {return new BinomialBSPut(*this);}
+    private:
+        double strike, r, d, vol, dt;
+    };
+    double bbs[3];
+    for(unsigned long j=0; j<3; ++j){
+        unsigned long steps = 2000ul << j;
+        BinomialTree tree(spot, r_param, div_param, vol, steps, ttx);
+        bbs[j] = tree.get_price(BinomialBSPut(ttx, strike, r, div, vol, steps));
+    }
+    double reference = 2.0 * bbs[2] - bbs[1];
+    std::cout << "reference: " << reference << ", change from the 2000 / 4000 steps extrapolation: " << reference - (2.0 * bbs[1] - bbs[0]) << "\n";
+    
+    std::cout << "steps, error and time(ms) of: binomial, trinomial, trinomial extrapolated, CN, CN extrapolated\n";
+    for(unsigned long steps=25; steps<=800; steps*=2){
+        double price[5], elapsed[5];
+        for(unsigned long m=0; m<5; ++m){
+            auto start = std::chrono::steady_clock::now();
+            if(m == 0){
+                BinomialTree tree(spot, r_param, div_param, vol, steps, ttx);
+                price[m] = tree.get_price(put);
+            }else if(m < 3){
+                TrinomialTree tree(spot, r_param, div_param, vol, steps, ttx, strike);
+                price[m] = m == 1 ? tree.get_price(put) : tree.get_price_extrapolated(put);
+            }else{
+                FiniteDifferenceCN grid(spot, r_param, div_param, vol, steps, steps, ttx);
+                price[m] = m == 3 ? grid.get_price(put) : grid.get_price_extrapolated(put);
+            }
+            elapsed[m] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << steps;
+        for(unsigned long m=0; m<5; ++m)
+            std::cout << "\t" << price[m] - reference << " (" << elapsed[m] << ")";
+        std::cout << "\n";
+    }
+}
+
 void test_solver(){
     double ttx, strike, spot, vol, r, div, price;
     
@@ -270,6 +1095,227 @@ void test_solver(){
     
 }
 
+void test_implied_vol_batch(){
+    unsigned long num_quotes;
+    std::cout << "implied vols of a surface of calls and puts, batch solver vs. Newton-Raphson one by one\n";
+    read_input<unsigned long>("number of quotes: ", num_quotes);
+    
+    // expiries from 1 month to 3 years, strikes from 60% to 160% of spot, vols from 10% to 80%
+    double spot = 100.0, r = 0.03, div = 0.01;
+    std::vector<double> spots(num_quotes, spot), rs(num_quotes, r), divs(num_quotes, div);
+    std::vector<double> strikes(num_quotes), ttxs(num_quotes), prices(num_quotes), vols(num_quotes), solved(num_quotes);
+    std::unique_ptr<bool[]> is_call(new bool[num_quotes]), converged(new bool[num_quotes]);
+    RandomParkMiller generator(3);
+    MJArray u(3);
+    for(unsigned long i=0; i<num_quotes; ++i){
+        generator.get_uniforms(u);
+        ttxs[i] = 1.0 / 12 + u[0] * 3.0;
+        strikes[i] = spot * (0.6 + u[1]);
+        vols[i] = 0.1 + 0.7 * u[2];
+        is_call[i] = strikes[i] > spot;
+        prices[i] = is_call[i] ? bs_call(spot, strikes[i], r, div, vols[i], ttxs[i])
+                               : bs_put(spot, strikes[i], r, div, vols[i], ttxs[i]);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    unsigned long failed = implied_vol(spots.data(), strikes.data(), rs.data(), divs.data(), ttxs.data(),
+                                       prices.data(), is_call.get(), solved.data(), num_quotes, 1e-10, converged.get());
+    auto mid = std::chrono::steady_clock::now();
+    double max_scalar_diff = 0.0;
+    for(unsigned long i=0; i<num_quotes; ++i){
+        // puts as calls by parity, started from the inflection point so Newton-Raphson converges monotonically
+        double call_price = prices[i];
+        if(!is_call[i])
+            call_price += spot * std::exp(-div * ttxs[i]) - strikes[i] * std::exp(-r * ttxs[i]);
+        double log_moneyness = std::log(spot / strikes[i]) + (r - div) * ttxs[i];
+        double init_vol = std::fmax(std::sqrt(2.0 * std::fabs(log_moneyness) / ttxs[i]), 0.1);
+        BSCall2 call_func(r, div, ttxs[i], spot, strikes[i]);
+        double vol = newton<BSCall2, &BSCall2::price, &BSCall2::vega>(call_price, init_vol, 1e-8, call_func);
+        if(prices[i] > 1e-4)
+            max_scalar_diff = std::fmax(max_scalar_diff, std::fabs(vol - solved[i]));
+    }
+    auto end = std::chrono::steady_clock::now();
+    
+    // bs_call uses the Abramowitz-Stegun cum_norm, accurate to about 7.5e-8, so the vols are only recovered to a few digits
+    // and far out of the money prices are mostly approximation error, those are left out
+    double max_vol_err = 0.0;
+    for(unsigned long i=0; i<num_quotes; ++i)
+        if(prices[i] > 1e-4)
+            max_vol_err = std::fmax(max_vol_err, std::fabs(solved[i] - vols[i]));
+    // the mask is false for quotes without a solution too: far out of the money puts whose approximate prices
+    // fall outside the no-arbitrage bounds
+    unsigned long not_converged = 0, no_solution = 0;
+    for(unsigned long i=0; i<num_quotes; ++i){
+        no_solution += std::isnan(solved[i]);
+        not_converged += !converged[i] && !std::isnan(solved[i]);
+    }
+    std::cout << "not converged: " << failed << " (" << not_converged << " in the mask), without a solution: "
+              << no_solution << ", max vol error: " << max_vol_err
+              << ", max difference to Newton-Raphson: " << max_scalar_diff << "\n";
+    std::cout << "batch time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count() << "\n";
+    std::cout << "Newton-Raphson time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+}
+
+void test_bs_batch(){
+    unsigned long num_contracts;
+    std::cout << "Black-Scholes price and Greeks, batch kernel vs. scalar functions\n";
+    read_input<unsigned long>("number of contracts: ", num_contracts);
+    
+    std::vector<double> spots(num_contracts), strikes(num_contracts), rs(num_contracts), divs(num_contracts);
+    std::vector<double> vols(num_contracts), ttxs(num_contracts);
+    std::unique_ptr<bool[]> is_call(new bool[num_contracts]);
+    RandomParkMiller generator(5);
+    MJArray u(5);
+    for(unsigned long i=0; i<num_contracts; ++i){
+        generator.get_uniforms(u);
+        spots[i] = 80.0 + 40.0 * u[0];
+        strikes[i] = 100.0 * (0.6 + u[1]);
+        vols[i] = 0.1 + 0.7 * u[2];
+        ttxs[i] = 1.0 / 12 + 3.0 * u[3];
+        rs[i] = 0.05 * u[4];
+        divs[i] = 0.02;
+        is_call[i] = i % 2 == 0;
+    }
+    std::vector<double> price(num_contracts), delta(num_contracts), gamma(num_contracts), vega(num_contracts),
+                        theta(num_contracts), rho(num_contracts), scalar_price(num_contracts), scalar_vega(num_contracts);
+    BSBatchOutputs outputs;
+    outputs.price = price.data();
+    outputs.delta = delta.data();
+    outputs.gamma = gamma.data();
+    outputs.vega = vega.data();
+    outputs.theta = theta.data();
+    outputs.rho = rho.data();
+    
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_contracts; ++i){
+        scalar_price[i] = is_call[i] ? bs_call(spots[i], strikes[i], rs[i], divs[i], vols[i], ttxs[i])
+                                     : bs_put(spots[i], strikes[i], rs[i], divs[i], vols[i], ttxs[i]);
+        scalar_vega[i] = bs_vega(spots[i], strikes[i], rs[i], divs[i], vols[i], ttxs[i]);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    bs_batch(spots.data(), strikes.data(), rs.data(), divs.data(), vols.data(), ttxs.data(), is_call.get(),
+             num_contracts, outputs);
+    auto end = std::chrono::steady_clock::now();
+    
+    double price_diff = 0.0, vega_diff = 0.0;
+    for(unsigned long i=0; i<num_contracts; ++i){
+        price_diff = std::fmax(price_diff, std::fabs(price[i] - scalar_price[i]));
+        vega_diff = std::fmax(vega_diff, std::fabs(vega[i] - scalar_vega[i]));
+    }
+    std::cout << "max |batch - scalar| price: " << price_diff << ", vega: " << vega_diff << "\n";
+    std::cout << "scalar price and vega time(ms): " << std::chrono::duration<double, std::milli>(mid - start).count()
+              << ", batch price and all Greeks time(ms): " << std::chrono::duration<double, std::milli>(end - mid).count() << "\n";
+    
+    // the other Greeks against central differences, on the first contracts at full accuracy
+    unsigned long m = std::min(num_contracts, 1000ul);
+    bs_batch(spots.data(), strikes.data(), rs.data(), divs.data(), vols.data(), ttxs.data(), is_call.get(),
+             m, outputs, NormalAccuracy::full);
+    const double h = 1e-4;
+    std::vector<double> centre(m), up(m), down(m);
+    // prices with one input shifted for all contracts
+    auto bumped_price = [&](std::vector<double>& input, double shift, std::vector<double>& result){
+        for(unsigned long i=0; i<m; ++i) input[i] += shift;
+        BSBatchOutputs price_only;
+        price_only.price = result.data();
+        bs_batch(spots.data(), strikes.data(), rs.data(), divs.data(), vols.data(), ttxs.data(), is_call.get(),
+                 m, price_only, NormalAccuracy::full);
+        for(unsigned long i=0; i<m; ++i) input[i] -= shift;
+    };
+    double delta_err = 0.0, gamma_err = 0.0, theta_err = 0.0, rho_err = 0.0;
+    bumped_price(spots, 0.0, centre);
+    bumped_price(spots, h, up);
+    bumped_price(spots, -h, down);
+    for(unsigned long i=0; i<m; ++i){
+        delta_err = std::fmax(delta_err, std::fabs((up[i] - down[i]) / (2 * h) - delta[i]));
+        gamma_err = std::fmax(gamma_err, std::fabs((up[i] - 2 * centre[i] + down[i]) / (h * h) - gamma[i]));
+    }
+    bumped_price(ttxs, h, up);
+    bumped_price(ttxs, -h, down);
+    for(unsigned long i=0; i<m; ++i)
+        theta_err = std::fmax(theta_err, std::fabs(-(up[i] - down[i]) / (2 * h) - theta[i]));
+    bumped_price(rs, h, up);
+    bumped_price(rs, -h, down);
+    for(unsigned long i=0; i<m; ++i)
+        rho_err = std::fmax(rho_err, std::fabs((up[i] - down[i]) / (2 * h) - rho[i]));
+    std::cout << "max |Greek - finite difference| delta: " << delta_err << ", gamma: " << gamma_err
+              << ", theta: " << theta_err << ", rho: " << rho_err << "\n";
+}
+
+// spreadsheet input of a payoff, see ArgumentList(xlw::CellMatrix, std::string) for the layout
+xlw::CellMatrix payoff_cells(unsigned long kind, double strike){
+    if(kind < 2){
+        xlw::CellMatrix cells(3, 2);
+        cells(0, 0) = "Payoff";
+        cells(1, 0) = "Name";
+        cells(1, 1) = "Strike";
+        cells(2, 0) = kind == 0 ? "Call" : "Put";
+        cells(2, 1) = strike;
+        return cells;
+    }
+    xlw::CellMatrix cells(7, 6);
+    cells(0, 0) = "Payoff";
+    cells(1, 0) = "Name";
+    cells(2, 0) = "Spread";
+    cells(1, 1) = "Volume1";
+    cells(2, 1) = 2.0;
+    const char* legs[2] = {"OptionOne", "OptionTwo"};
+    for(unsigned long leg=0; leg<2; ++leg){
+        unsigned long column = 2 + 2 * leg;
+        cells(1, column) = legs[leg];
+        cells(2, column) = "List";
+        cells(3, column) = 3.0;
+        cells(3, column + 1) = 2.0;
+        xlw::CellMatrix nested(payoff_cells(leg, strike * (1.0 + 0.1 * leg)));
+        for(unsigned long i=0; i<3; ++i)
+            for(unsigned long j=0; j<2; ++j)
+                cells(4 + i, column + j) = nested(i, j);
+    }
+    return cells;
+}
+
+ArgumentList payoff_args(unsigned long kind, double strike){
+    ArgumentList args("payoff");
+    if(kind < 2){
+        args.add("name", kind == 0 ? "call" : "put");
+        args.add("strike", strike);
+        return args;
+    }
+    args.add("name", "spread");
+    args.add("volume1", 2.0);
+    args.add("optionone", payoff_args(0, strike));
+    args.add("optiontwo", payoff_args(1, strike * 1.1));
+    return args;
+}
+
+void test_factory_throughput(){
+    unsigned long num_trades;
+    std::cout << "payoffs built by the factory from argument lists, calls, puts and spreads of both\n";
+    read_input<unsigned long>("number of trades: ", num_trades);
+    
+    std::vector<xlw::CellMatrix> inputs;
+    inputs.reserve(num_trades);
+    for(unsigned long i=0; i<num_trades; ++i)
+        inputs.push_back(payoff_cells(i % 3, 80.0 + i % 41));
+    
+    double sum_cells = 0.0, sum_args = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_trades; ++i){
+        std::unique_ptr<Payoff> payoff(get_from_factory<Payoff>(ArgumentList(std::move(inputs[i]), "test_factory_throughput")));
+        sum_cells += (*payoff)(100.0);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<num_trades; ++i){
+        std::unique_ptr<Payoff> payoff(get_from_factory<Payoff>(payoff_args(i % 3, 80.0 + i % 41)));
+        sum_args += (*payoff)(100.0);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double cells_time = std::chrono::duration<double, std::milli>(mid - start).count();
+    double args_time = std::chrono::duration<double, std::milli>(end - mid).count();
+    std::cout << "from cells, time(ms): " << cells_time << ", trades per second: " << num_trades / cells_time * 1000.0 << "\n";
+    std::cout << "from add(), time(ms): " << args_time << ", trades per second: " << num_trades / args_time * 1000.0 << "\n";
+    std::cout << "sum of payoffs at spot 100, from cells: " << sum_cells << ", from add(): " << sum_args << "\n";
+}
+
 void test_factory(){
     std::cout << "test payoff factory\n";
     
@@ -11,9 +11,27 @@
 
 void test_simpleMC();
 void test_exoticEngine();
+void test_exoticEngine_parallel();
+void test_convergence_stop();
+void test_control_variate();
+void test_greeks();
+void test_aad();
+void test_parameters_piecewise();
+void test_lattices();
+void test_stats_merge();
+void test_random_streams();
+void test_sobol();
+void test_normals();
+void test_mjarray();
+void test_alloc_audit();
+void test_vanilla_mc();
 void test_tree();
+void test_tree_batch();
 void test_solver();
+void test_implied_vol_batch();
+void test_bs_batch();
 void test_factory();
+void test_factory_throughput();
 
 
 #endif /* test_hpp */
@@ -23,25 +23,33 @@ BinomialTree::BinomialTree(double _spot,
 void BinomialTree::build_tree()
 {
     tree_built = true;
-    tree.resize(steps+1);
+    base_spots.resize(steps+1);
     
     double init_log_spot = std::log(spot);
-    // populate spot prices
+    double sd = vol * std::sqrt(time / steps);
+    up = std::exp(2.0 * sd);
+    // integrals of r and d over the steps in one pass over their knots
+    MJArray step_times(steps), r_steps(steps), d_steps(steps);
+    for(unsigned long l=0; l<steps; ++l)
+        step_times[l] = ((l+1) * time) / steps;
+    r.integrate_grid(0.0, step_times.data(), steps, r_steps.data());
+    d.integrate_grid(0.0, step_times.data(), steps, d_steps.data());
+    // lowest spot price at each step, the others are multiples of up
+    double r_integral = 0.0, d_integral = 0.0;
     for(unsigned long i=0; i<=steps; ++i){
-        tree[i].resize(i+1);
         double ti = (i * time) / steps;
+        if(i){
+            r_integral += r_steps[i-1];
+            d_integral += d_steps[i-1];
+        }
         double drift_log_spot =
-        init_log_spot + r.integrate(0.0, ti) - d.integrate(0.0, ti)
+        init_log_spot + r_integral - d_integral
         - 0.5 * vol * vol * ti;
-        double sd = vol * std::sqrt(time / steps);
-        for(long j=-static_cast<long>(i), k=0;
-            j <= static_cast<long>(i); j += 2, k++)
-            tree[i][k].first = std::exp(drift_log_spot + j * sd);
+        base_spots[i] = std::exp(drift_log_spot - static_cast<double>(i) * sd);
     }
     // compute discount factor for each tree step
     for(unsigned long l=0; l<steps; l++)
-        discounts[l] =
-        std::exp(-r.integrate(l * time / steps, (l+1) * time / steps));
+        discounts[l] = std::exp(-r_steps[l]);
 }
 
 // use underlying spot tree to price TreeProduct
@@ -51,21 +59,213 @@ double BinomialTree::get_price(const TreeProduct& product)
     
     if(product.get_final_time() != time)
         throw("Mismatched product and binomial tree time!");
-    // populate final payoff at tree[steps]
-    for(long j = -static_cast<long>(steps), k=0;
-        j <= static_cast<long>(steps); j+=2, k++)
-        tree[steps][k].second = product.final_payoff(tree[steps][k].first);
-    // back propagate fair values
+    values.resize(steps+1);
+    // populate final payoff at the last step
+    fill_row_spots(steps);
+    product.final_payoffs(row_spots.data(), steps+1, values.data());
+    // back propagate fair values, node k only reads nodes k and k+1 of the step after
+    for(unsigned long i=1; i<= steps; ++i){
+        unsigned long idx = steps - i;
+        double ti = idx * time / steps;
+        double half_disc = 0.5 * discounts[idx];
+        fill_row_spots(idx);
+        for(unsigned long k=0; k<=idx; ++k)
+            values[k] = half_disc * (values[k] + values[k+1]);
+        product.pre_final_values(row_spots.data(), idx+1, ti, values.data());
+    }
+    return values[0];
+}
+
+// one backward sweep for all products, the spots of each step are computed once and shared
+std::vector<double> BinomialTree::get_prices(const std::vector<const TreeProduct*>& products)
+{
+    if(!tree_built) build_tree();
+    
+    unsigned long n = products.size();
+    for(unsigned long p=0; p<n; ++p)
+        if(products[p]->get_final_time() != time)
+            throw("Mismatched product and binomial tree time!");
+    values.resize((steps+1) * n);
+    
+    fill_row_spots(steps);
+    for(unsigned long p=0; p<n; ++p)
+        products[p]->final_payoffs(row_spots.data(), steps+1, values.data() + p * (steps+1));
     for(unsigned long i=1; i<= steps; ++i){
         unsigned long idx = steps - i;
         double ti = idx * time / steps;
-        for(long j=-static_cast<long>(idx), k=0;
-            j <= static_cast<long>(idx); j+=2, k++){
-            double s = tree[idx][k].first;
-            double val = discounts[idx]
-            * 0.5 * (tree[idx+1][k].second + tree[idx+1][k+1].second);
-            tree[idx][k].second = product.pre_final_value(s, ti, val);
+        double half_disc = 0.5 * discounts[idx];
+        fill_row_spots(idx);
+        for(unsigned long p=0; p<n; ++p){
+            double* row = values.data() + p * (steps+1);
+            for(unsigned long k=0; k<=idx; ++k)
+                row[k] = half_disc * (row[k] + row[k+1]);
+            products[p]->pre_final_values(row_spots.data(), idx+1, ti, row);
         }
     }
-    return tree[0][0].second;
+    std::vector<double> prices(n);
+    for(unsigned long p=0; p<n; ++p)
+        prices[p] = values[p * (steps+1)];
+    return prices;
+}
+
+void BinomialTree::fill_row_spots(unsigned long i)
+{
+    row_spots.resize(steps+1);
+    double s = base_spots[i];
+    for(unsigned long k=0; k<=i; ++k, s *= up)
+        row_spots[k] = s;
+}
+
+double BinomialTree::get_price(const TreeProduct& product, PriceGradient& gradient)
+{
+    if(!tree_built) build_tree();
+    if(product.get_final_time() != time)
+        throw("Mismatched product and binomial tree time!");
+    Tape& tape = Tape::get_tape();
+    tape.rewind();
+    
+    std::vector<Number> r_knots, d_knots, parameters;
+    Number spot_number = Number::leaf(spot);
+    Number vol_number = Number::leaf(vol);
+    make_leaves(r.get_knots(), r_knots);
+    make_leaves(d.get_knots(), d_knots);
+    std::vector<double> parameter_values(product.num_parameters());
+    product.get_parameters(parameter_values.data());
+    make_leaves(parameter_values, parameters);
+    
+    // the tree, as build_tree
+    Number init_log_spot = log(spot_number);
+    Number sd = vol_number * std::sqrt(time / steps);
+    std::vector<Number> spots(steps+1), half_discounts(steps), node_values(steps+1), next_values(steps+1);
+    for(unsigned long i=0; i<=steps; ++i){
+        double ti = (i * time) / steps;
+        Number drift_log_spot = init_log_spot + r.integrate(0.0, ti, r_knots) - d.integrate(0.0, ti, d_knots)
+        - 0.5 * vol_number * vol_number * ti;
+        spots[i] = exp(drift_log_spot - static_cast<double>(i) * sd);
+    }
+    for(unsigned long l=0; l<steps; l++)
+        half_discounts[l] = 0.5 * exp(-r.integrate(l * time / steps, (l+1) * time / steps, r_knots));
+    
+    // spot of node k of step i, s = spots[i] * exp(2 k sd) as in fill_row_spots, one node on the tape, recorded only where the product reads it
+    auto node_spot = [&](unsigned long i, unsigned long k, double s){
+        return binary(s, spots[i], s / spots[i].value(), sd, 2.0 * k * s);
+    };
+    // backward induction as get_price, the values of a row in double decide which branch each node records:
+    // where the product keeps the discounted value only that is recorded (one node, none for a constant such as 0 out of the money),
+    // elsewhere (exercise) the product's value is recorded from the spot and the discounted value enters as a constant
+    fill_row_spots(steps);
+    for(unsigned long k=0; k<=steps; ++k)
+        node_values[k] = product.final_payoff(node_spot(steps, k, row_spots[k]), parameters.data());
+    values.resize(steps+1);
+    MJArray disc_fut_vals(steps+1);
+    for(unsigned long i=1; i<= steps; ++i){
+        unsigned long idx = steps - i;
+        double ti = idx * time / steps;
+        const Number& half_disc = half_discounts[idx];
+        std::swap(node_values, next_values);
+        fill_row_spots(idx);
+        for(unsigned long k=0; k<=idx; ++k)
+            values[k] = disc_fut_vals[k] = half_disc.value() * (next_values[k].value() + next_values[k+1].value());
+        product.pre_final_values(row_spots.data(), idx+1, ti, values.data());
+        for(unsigned long k=0; k<=idx; ++k){
+            const Number& a = next_values[k];
+            const Number& b = next_values[k+1];
+            if(values[k] != disc_fut_vals[k])
+                node_values[k] = product.pre_final_value(node_spot(idx, k, row_spots[k]), ti, Number(disc_fut_vals[k]), parameters.data());
+            else if(!a.is_active() && !b.is_active() && a.value() + b.value() == 0.0)
+                node_values[k] = Number(0.0);
+            else
+                node_values[k] = Number(disc_fut_vals[k], tape.record(half_disc.get_node(), a.value() + b.value(),
+                                                                     a.get_node(), half_disc.value(),
+                                                                     b.get_node(), half_disc.value()));
+        }
+    }
+    
+    if(node_values[0].is_active()){
+        tape.add_adjoint(node_values[0].get_node(), 1.0);
+        tape.propagate(node_values[0].get_node());
+    }
+    gradient.price = node_values[0].value();
+    gradient.spot = spot_number.get_adjoint();
+    get_adjoints(r_knots, gradient.r);
+    get_adjoints(d_knots, gradient.d);
+    gradient.vol.assign(1, vol_number.get_adjoint());
+    get_adjoints(parameters, gradient.payoff);
+    return gradient.price;
+}
+
+TrinomialTree::TrinomialTree(double _spot,
+                             const Parameters& _r,
+                             const Parameters& _d,
+                             double _vol,
+                             unsigned long _steps,
+                             double _time,
+                             double _strike
+                             )
+: spot(_spot), r(_r), d(_d), vol(_vol), steps(_steps), time(_time), strike(_strike > 0.0 ? _strike : _spot), tree_built(false)
+{
+}
+
+// the log spot moves by dx, 0, -dx with mean nu dt and variance vol^2 dt of the step.
+// the nodes are log strike + j dx, step 1 is centred on the node nearest to the mean of the spot after the first step
+// and the first step moves by centre - log spot + dx, 0, -dx: its mean is offset by at most dx / 2 and the probabilities stay positive
+void TrinomialTree::build_tree()
+{
+    tree_built = true;
+    double dt = time / steps;
+    dx = vol * std::sqrt(3.0 * dt);
+    p_down.resize(steps);
+    p_middle.resize(steps);
+    p_up.resize(steps);
+    MJArray step_times(steps), r_steps(steps), d_steps(steps);
+    for(unsigned long l=0; l<steps; ++l)
+        step_times[l] = ((l+1) * time) / steps;
+    r.integrate_grid(0.0, step_times.data(), steps, r_steps.data());
+    d.integrate_grid(0.0, step_times.data(), steps, d_steps.data());
+    double var = vol * vol * dt;
+    double log_spot = std::log(spot), log_strike = std::log(strike);
+    double first_mean = r_steps[0] - d_steps[0] - 0.5 * var;
+    centre = log_strike + std::round((log_spot + first_mean - log_strike) / dx) * dx;
+    for(unsigned long l=0; l<steps; ++l){
+        double mean = r_steps[l] - d_steps[l] - 0.5 * var;
+        if(l == 0)
+            mean += log_spot - centre;
+        double second = (var + mean * mean) / (dx * dx);
+        double disc = std::exp(-r_steps[l]);
+        p_up[l] = disc * 0.5 * (second + mean / dx);
+        p_down[l] = disc * 0.5 * (second - mean / dx);
+        p_middle[l] = disc * (1.0 - second);
+    }
+}
+
+double TrinomialTree::get_price(const TreeProduct& product)
+{
+    if(!tree_built) build_tree();
+    
+    if(product.get_final_time() != time)
+        throw("Mismatched product and trinomial tree time!");
+    values.resize(2 * steps + 1);
+    for(unsigned long k=0; k<=2*steps; ++k)
+        values[k] = cell_average_payoff(product, centre + (static_cast<double>(k) - steps) * dx, dx);
+    // node k of step idx reads nodes k, k+1, k+2 of the step after
+    double up = std::exp(dx);
+    for(unsigned long i=1; i<steps; ++i){
+        unsigned long idx = steps - i;
+        double ti = idx * time / steps;
+        double pd = p_down[idx], pm = p_middle[idx], pu = p_up[idx];
+        double s = std::exp(centre - static_cast<double>(idx) * dx);
+        for(unsigned long k=0; k<=2*idx; ++k, s *= up){
+            double val = pd * values[k] + pm * values[k+1] + pu * values[k+2];
+            values[k] = product.pre_final_value(s, ti, val);
+        }
+    }
+    // the first step, from the spot
+    double val = p_down[0] * values[0] + p_middle[0] * values[1] + p_up[0] * values[2];
+    return product.pre_final_value(spot, 0.0, val);
+}
+
+double TrinomialTree::get_price_extrapolated(const TreeProduct& product)
+{
+    TrinomialTree fine(spot, r, d, vol, 2 * steps, time, strike);
+    return 2.0 * fine.get_price(product) - get_price(product);
 }
@@ -10,11 +10,15 @@
 
 /*Tree is used as a discrete approximation of continuous stochastic price evolution, it is not a non-arbitrage tree, the non-arbitrage price is justified by its continuous version. One consequence is that the forward price is no longer exact but only approximated
  Price multiple products with same expiry, call methods many times but only build the tree once
+ The lattice is never stored: node k at step i has spot base_spots[i] * up^k, so building the tree is O(steps) and
+ backward induction rolls over one value array. Products value a whole step (row of nodes) per call,
+ get_prices backs out many products in the same sweep and computes the spots of each step once for all of them.
  */
 #include <vector>
 #include "mjarray.hpp"
 #include "parameters.hpp"
 #include "tree_product.hpp"
+#include "aad.hpp"
 
 
 class BinomialTree{
@@ -27,10 +31,19 @@ public:
                  double _time
                  );
     double get_price(const TreeProduct& product);
+    // all products must expire at the tree time, prices are returned in the same order
+    std::vector<double> get_prices(const std::vector<const TreeProduct*>& products);
+    // price and its gradient in spot, the knots of r and d, vol (one entry) and the parameters of the product by AAD,
+    // the tree and the backward induction are recorded and swept back once, a node records only the branch it takes.
+    // costs about 8 prices; the first call on a thread costs about 20, it allocates the blocks of the thread's tape,
+    // which later calls rewind and record into again
+    double get_price(const TreeProduct& product, PriceGradient& gradient);
     
 protected:
     void build_tree();
 private:
+    void fill_row_spots(unsigned long i); // spots of step i into row_spots
+    
     double spot;
     Parameters r;
     Parameters d;
@@ -39,8 +52,51 @@ private:
     double time;
     bool tree_built;
     
-    std::vector<std::vector<std::pair<double, double>>> tree;
+    double up; // ratio of neighbouring spots at the same step
+    MJArray base_spots; // lowest spot at each step
     MJArray discounts;
+    MJArray row_spots; // spots of the step being rolled back
+    MJArray values; // rolling values, one row of steps + 1 per product: values[p * (steps + 1) + k]
+};
+
+
+/*Trinomial tree in log spot: the nodes are spaced by dx = vol * sqrt(3 dt) and one of them is the strike, so the kink of
+ the payoff and the exercise boundary near expiry sit on the same nodes whatever the number of steps. The spot branches
+ to the three nodes of step 1 around its mean, the offset from the node grid goes into the mean of the first step.
+ The drift of each step goes into its branch probabilities, the final payoff is averaged over the cell of each node.
+ */
+class TrinomialTree{
+public:
+    TrinomialTree(double _spot,
+                  const Parameters& _r,
+                  const Parameters& _d,
+                  double _vol, // constant vol
+                  unsigned long _steps,
+                  double _time,
+                  double _strike=0.0 // put on a node, 0 for the spot
+                  );
+    double get_price(const TreeProduct& product);
+    // 2 * price on 2 * steps - price on steps
+    double get_price_extrapolated(const TreeProduct& product);
+    
+protected:
+    void build_tree();
+private:
+    double spot;
+    Parameters r;
+    Parameters d;
+    double vol;
+    unsigned long steps;
+    double time;
+    double strike;
+    bool tree_built;
+    
+    double dx;
+    double centre; // log spot of the middle node from step 1 on
+    MJArray p_down; // branch probabilities times the discount factor of each step, the first from the spot
+    MJArray p_middle;
+    MJArray p_up;
+    MJArray values;
 };
 
 
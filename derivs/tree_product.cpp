@@ -6,16 +6,70 @@
 //
 
 #include "tree_product.hpp"
+#include "aad.hpp"
 #include <cmath>
 
+Number TreeProduct::final_payoff(const Number&, const Number*) const
+{
+    throw("tree product not available to AAD");
+}
+
+Number TreeProduct::pre_final_value(const Number&, double, const Number&, const Number*) const
+{
+    throw("tree product not available to AAD");
+}
+
 double TreeAmerican::pre_final_value(double spot, double time, double disc_fut_val) const
 {
     return std::fmax(payoff(spot), disc_fut_val);
 }
 
+void TreeAmerican::pre_final_values(const double* spots, unsigned long n, double, double* values) const
+{
+    exercise.resize(n);
+    payoff.values(spots, n, exercise.data());
+    // fmax without its NaN handling, so the loop vectorises
+    for(unsigned long k=0; k<n; ++k)
+        values[k] = exercise[k] > values[k] ? exercise[k] : values[k];
+}
+
+Number TreeAmerican::final_payoff(const Number& spot, const Number* parameters) const
+{
+    return payoff(spot, parameters);
+}
+
+Number TreeAmerican::pre_final_value(const Number& spot, double, const Number& disc_fut_val, const Number* parameters) const
+{
+    return fmax(payoff(spot, parameters), disc_fut_val);
+}
+
 double TreeEuropean::pre_final_value(double spot, double time, double disc_fut_val) const
 {
     return disc_fut_val;
 }
 
+Number TreeEuropean::final_payoff(const Number& spot, const Number* parameters) const
+{
+    return payoff(spot, parameters);
+}
+
+Number TreeEuropean::pre_final_value(const Number&, double, const Number& disc_fut_val, const Number*) const
+{
+    return disc_fut_val;
+}
+
 
+
+double cell_average_payoff(const TreeProduct& product, double log_spot, double width)
+{
+    static const double nodes[4] = {-0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526};
+    static const double weights[4] = {0.3478548451374538, 0.6521451548625461, 0.6521451548625461, 0.3478548451374538};
+    double h = width / CELL_AVERAGE_PIECES;
+    double sum = 0.0;
+    for(unsigned long j=0; j<CELL_AVERAGE_PIECES; ++j){
+        double centre = log_spot - 0.5 * width + (j + 0.5) * h;
+        for(unsigned long i=0; i<4; ++i)
+            sum += weights[i] * product.final_payoff(std::exp(centre + 0.5 * h * nodes[i]));
+    }
+    return 0.5 * sum / CELL_AVERAGE_PIECES;
+}
@@ -9,6 +9,7 @@
 #define tree_product_hpp
 
 #include "payoff.hpp"
+#include "mjarray.hpp"
 
 /*derivative products that can be priced on a tree*/
 
@@ -19,6 +20,22 @@ public:
     
     virtual double final_payoff(double spot) const=0;
     virtual double pre_final_value(double spot, double time, double disc_fut_val) const=0;
+    // a row of n nodes in one call: final payoffs of the spots, and values of the spots from their discounted
+    // future values, which values holds on entry
+    virtual void final_payoffs(const double* spots, unsigned long n, double* values) const {
+        for(unsigned long k=0; k<n; ++k)
+            values[k] = final_payoff(spots[k]);
+    }
+    virtual void pre_final_values(const double* spots, unsigned long n, double time, double* values) const {
+        for(unsigned long k=0; k<n; ++k)
+            values[k] = pre_final_value(spots[k], time, values[k]);
+    }
+    // AAD: the parameters of the product (strikes of its payoff), and the values above on active numbers.
+    // the tree records pre_final_value only where it differs from disc_fut_val, and there it must not depend on disc_fut_val
+    virtual unsigned long num_parameters() const {return 0;}
+    virtual void get_parameters(double*) const {}
+    virtual Number final_payoff(const Number& spot, const Number* parameters) const; // both throw unless overridden
+    virtual Number pre_final_value(const Number& spot, double time, const Number& disc_fut_val, const Number* parameters) const;
     
     virtual ~TreeProduct(){}
     virtual TreeProduct* clone() const=0;
@@ -34,10 +51,18 @@ public:
     
     double final_payoff(double spot) const override {return payoff(spot);}
     double pre_final_value(double spot, double time, double disc_fut_val) const override;
+    void final_payoffs(const double* spots, unsigned long n, double* values) const override {payoff.values(spots, n, values);}
+    void pre_final_values(const double* spots, unsigned long n, double time, double* values) const override;
+    
+    unsigned long num_parameters() const override {return payoff.num_parameters();}
+    void get_parameters(double* values) const override {payoff.get_parameters(values);}
+    Number final_payoff(const Number& spot, const Number* parameters) const override;
+    Number pre_final_value(const Number& spot, double time, const Number& disc_fut_val, const Number* parameters) const override;
     
     TreeProduct* clone() const override {return new TreeAmerican(*this);}
 private:
     PayoffBridge payoff;
+    mutable MJArray exercise; // workspace for pre_final_values
 };
 
 // European option priced on a tree
@@ -47,10 +72,23 @@ public:
     
     double final_payoff(double spot) const override {return payoff(spot);}
     double pre_final_value(double spot, double time, double disc_fut_val) const override;
+    void final_payoffs(const double* spots, unsigned long n, double* values) const override {payoff.values(spots, n, values);}
+    void pre_final_values(const double*, unsigned long, double, double*) const override {} // the values are the discounted ones
+    
+    unsigned long num_parameters() const override {return payoff.num_parameters();}
+    void get_parameters(double* values) const override {payoff.get_parameters(values);}
+    Number final_payoff(const Number& spot, const Number* parameters) const override;
+    Number pre_final_value(const Number& spot, double time, const Number& disc_fut_val, const Number* parameters) const override;
     
     TreeProduct* clone() const override {return new TreeEuropean(*this);}
 private:
     PayoffBridge payoff;
 };
 
+// smoothed final payoff: the average of final_payoff over the log-spot cell [log_spot - width/2, log_spot + width/2]
+// (4 point Gauss-Legendre on each of CELL_AVERAGE_PIECES pieces, a kink costs little wherever it falls in the cell),
+// so the error of a lattice on a European product no longer oscillates with where the strike falls between nodes
+const unsigned long CELL_AVERAGE_PIECES = 16;
+double cell_average_payoff(const TreeProduct& product, double log_spot, double width);
+
 #endif /* tree_product_hpp */
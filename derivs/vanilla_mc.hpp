@@ -0,0 +1,68 @@
+//
+//  vanilla_mc.hpp
+//  derivs
+//
+//  Created by Xin Li on 4/2/22.
+//
+
+#ifndef vanilla_mc_hpp
+#define vanilla_mc_hpp
+
+/*MC pricer of a vanilla option under Black-Scholes, templated on the payoff, generator and statistics gatherer types (static polymorphism).
+ With concrete types whose per-path methods are final (CallPayoff, PutPayoff, ForwardPayoff, StatsMean, ...) the compiler
+ resolves the payoff and gatherer calls at compile time and inlines them into the path loop, the variates are drawn,
+ transformed and exponentiated a block of paths at a time with array kernels.
+ With the base types (PayoffBridge, RandomBase, StatsMC) the same code is the usual virtual pricer, simpleMC is such an adapter.
+ 
+ The generator is reset to block_size dimensions: one draw covers a block of paths. This is the same stream as
+ one path per draw for sequential pseudo-random generators (ParkMiller), use block_size 1 for generators where
+ the dimensions of a draw are not interchangeable (low-discrepancy sequences, anti-thetic pairs).
+ Only the variates of the paths asked for are used, a partial last block leaves the rest of its draw unused.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "mjarray.hpp"
+#include "parameters.hpp"
+#include "random.hpp"
+#include "normals.hpp"
+#include "fast_math.hpp"
+
+template<typename PayoffT, typename GeneratorT, typename StatsT>
+class VanillaMC{
+public:
+    VanillaMC(const PayoffT& _payoff, double _time_to_exp, double _spot,
+              const Parameters& _vol, const Parameters& _r, unsigned long _block_size=256)
+    : payoff(_payoff), block_size(std::max(1ul, _block_size)), variates(block_size)
+    {
+        // terminal S(T) = S * exp( int r - var/2 + sqrt(var) * gaussian )
+        double var = _vol.integrate_square(0.0, _time_to_exp);
+        sqrvar = std::sqrt(var);
+        s0 = _spot * std::exp(_r.integrate(0.0, _time_to_exp) - 0.5 * var);
+        discounting = std::exp(-_r.integrate(0.0, _time_to_exp));
+    }
+    
+    void run_simulation(StatsT& gatherer, GeneratorT& generator, unsigned long num_paths){
+        generator.reset_dim(block_size);
+        for(unsigned long done=0; done<num_paths; done+=block_size){
+            unsigned long n = std::min(block_size, num_paths - done);
+            generator.get_gaussians(variates);
+            double* x = variates.data();
+            for(unsigned long i=0; i<n; ++i)
+                x[i] *= sqrvar;
+            exp_array(x, x, n);
+            for(unsigned long i=0; i<n; ++i)
+                gatherer.dump_one_result(discounting * payoff(s0 * x[i]));
+        }
+    }
+    
+private:
+    PayoffT payoff;
+    unsigned long block_size;
+    MJArray variates; // workspace
+    double sqrvar;
+    double s0;
+    double discounting;
+};
+
+#endif /* vanilla_mc_hpp */
@@ -14,6 +14,9 @@
  The Wrapper is around base clase which allows polymorphism, it also requires clone method
  */
 
+#include <cstddef>
+#include <new>
+
 template<typename T>
 class Wrapper{
 public:
@@ -60,4 +63,15 @@ private:
 };
 
 
+/*small-object optimization for the bridges (Parameters, PayoffBridge): a class overrides clone_into by
+ return clone_in_place(*this, buffer, size); to be copied into the bridge's own buffer instead of the heap,
+ nullptr when it does not fit, the bridge then falls back to clone()
+ */
+template<typename T>
+T* clone_in_place(const T& obj, void* buffer, std::size_t size){
+    if(sizeof(T) <= size && alignof(T) <= alignof(std::max_align_t))
+        return new(buffer) T(obj);
+    return nullptr;
+}
+
 #endif /* wrapper_hpp */